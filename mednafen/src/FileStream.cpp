@@ -214,6 +214,16 @@ uint64 FileStream::attributes(void)
 }
 
 uint8 *FileStream::map(void) noexcept
+{
+ return map_sub(false);
+}
+
+uint8 *FileStream::map_random(void) noexcept
+{
+ return map_sub(true);
+}
+
+uint8 *FileStream::map_sub(const bool random_access) noexcept
 {
  if(!mapping)
  {
@@ -244,8 +254,7 @@ uint8 *FileStream::map(void) noexcept
    mapping_size = length;
 
    #ifdef HAVE_MADVISE
-   // Should probably make this controllable via flag or somesuch.
-   madvise(mapping, mapping_size, MADV_SEQUENTIAL | MADV_WILLNEED);
+   madvise(mapping, mapping_size, random_access ? MADV_RANDOM : (MADV_SEQUENTIAL | MADV_WILLNEED));
    #endif
   }
 #endif
@@ -68,6 +68,10 @@ class FileStream : public Stream
  virtual uint64 map_size(void) noexcept override;
  virtual void unmap(void) noexcept override;
 
+ // Like map(), but madvise()'s a new mapping as randomly accessed instead of sequential and prefetched, for users that
+ // issue their own read-ahead hints.
+ uint8 *map_random(void) noexcept;
+
  virtual uint64 read(void *data, uint64 count, bool error_on_eos = true) override;
  virtual void write(const void *data, uint64 count) override;
  virtual void truncate(uint64 length) override;
@@ -135,6 +139,8 @@ class FileStream : public Stream
 
  uint64 locked;
 
+ uint8 *map_sub(const bool random_access) noexcept;
+
  void* mapping;
  uint64 mapping_size;
 
@@ -0,0 +1,502 @@
+/******************************************************************************/
+/* Mednafen - Multi-system Emulator                                           */
+/******************************************************************************/
+/* CDAFCache.cpp - Decoded CD-DA cache for compressed audio tracks
+**  Copyright (C) 2021 Mednafen Team
+**
+** This program is free software; you can redistribute it and/or
+** modify it under the terms of the GNU General Public License
+** as published by the Free Software Foundation; either version 2
+** of the License, or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <mednafen/mednafen.h>
+#include <mednafen/general.h>
+#include <mednafen/NativeVFS.h>
+#include "CDAFCache.h"
+
+namespace Mednafen
+{
+
+class CDAFReader_Cached final : public CDAFReader
+{
+ public:
+
+ CDAFReader_Cached(CDAFCache* c, const uint32 s, const uint64 fc) : cache(c), source(s), frame_count(fc), pos(0)
+ {
+
+ }
+
+ uint64 Read_(int16* buffer, uint64 frames) override
+ {
+  const uint64 ret = cache->Read(source, pos, buffer, frames);
+
+  pos += ret;
+
+  return ret;
+ }
+
+ bool Seek_(uint64 frame_offset) override
+ {
+  pos = frame_offset;
+
+  return true;
+ }
+
+ uint64 FrameCount(void) override
+ {
+  return frame_count;
+ }
+
+ void HintRead(uint64 frame_offset, uint64 frames) override
+ {
+  cache->Hint(source, frame_offset, frames);
+ }
+
+ private:
+
+ CDAFCache* const cache;
+ const uint32 source;
+ const uint64 frame_count;
+ uint64 pos;
+};
+
+CDAFCache::Source::~Source()
+{
+ delete reader;
+}
+
+CDAFCache::CDAFCache(const uint32 size_mb, const bool persist) : Persist(persist), CacheMutex(nullptr), ThreadCond(nullptr), BlockCond(nullptr), CacheThread(nullptr), ThreadExit(false)
+{
+ // Enough blocks that a block just decoded for a waiting reader can't be evicted by the read-ahead
+ // decoded right after it.
+ BlockCapacity = std::max<size_t>(ReadAheadBlocks * 2 + 2, ((uint64)size_mb << 20) / sizeof(Block));
+ LRUHead.prev = LRUHead.next = &LRUHead;
+
+ try
+ {
+  CacheMutex = MThreading::Mutex_Create();
+  ThreadCond = MThreading::Cond_Create();
+  BlockCond = MThreading::Cond_Create();
+  CacheThread = MThreading::Thread_Create(ThreadStart_C, this, "CD Audio Decode");
+ }
+ catch(...)
+ {
+  if(BlockCond)
+   MThreading::Cond_Destroy(BlockCond);
+
+  if(ThreadCond)
+   MThreading::Cond_Destroy(ThreadCond);
+
+  if(CacheMutex)
+   MThreading::Mutex_Destroy(CacheMutex);
+
+  throw;
+ }
+}
+
+CDAFCache::~CDAFCache()
+{
+ MThreading::Mutex_Lock(CacheMutex);
+ ThreadExit = true;
+ MThreading::Cond_Signal(ThreadCond);
+ MThreading::Mutex_Unlock(CacheMutex);
+
+ MThreading::Thread_Wait(CacheThread, nullptr);
+
+ MThreading::Cond_Destroy(BlockCond);
+ MThreading::Cond_Destroy(ThreadCond);
+ MThreading::Mutex_Destroy(CacheMutex);
+
+ // Unfinished sidecar files are left as-is(with their temporary name), and overwritten next time.
+}
+
+CDAFReader* CDAFCache::Wrap(CDAFReader* reader, Stream* fp)
+{
+ const uint64 frame_count = reader->FrameCount();
+ std::unique_ptr<Source> src(new Source());
+
+ src->reader = nullptr;
+ src->frame_count = frame_count;
+ src->hash_fp = Persist ? fp : nullptr;
+ src->hash_pos = 0;
+ src->sidecar_out_pos = 0;
+ src->persist_pending = Persist;
+
+ std::unique_ptr<CDAFReader_Cached> ret(new CDAFReader_Cached(this, Sources.size(), frame_count));
+
+ MThreading::Mutex_Lock(CacheMutex);
+ try
+ {
+  Sources.reserve(Sources.size() + 1);
+ }
+ catch(...)
+ {
+  MThreading::Mutex_Unlock(CacheMutex);
+  throw;
+ }
+ src->reader = reader;
+ Sources.push_back(std::move(src));
+ MThreading::Cond_Signal(ThreadCond);	// For persistence.
+ MThreading::Mutex_Unlock(CacheMutex);
+
+ return ret.release();
+}
+
+//
+// Must be called with CacheMutex held.
+//
+CDAFCache::Block* CDAFCache::Lookup(const uint64 key)
+{
+ auto it = BlockMap.find(key);
+
+ return (it != BlockMap.end()) ? it->second : nullptr;
+}
+
+void CDAFCache::Unlink(Block* b)
+{
+ b->prev->next = b->next;
+ b->next->prev = b->prev;
+}
+
+void CDAFCache::LinkMRU(Block* b)
+{
+ b->prev = &LRUHead;
+ b->next = LRUHead.next;
+ LRUHead.next->prev = b;
+ LRUHead.next = b;
+}
+
+//
+// Moves "b" out of the map, to the LRU end of the list, so that it'll be decoded again when next needed.
+//
+void CDAFCache::Evict(Block* b)
+{
+ Unlink(b);
+ BlockMap.erase(b->key);
+ b->key = NoKey;
+
+ b->prev = LRUHead.prev;
+ b->next = &LRUHead;
+ LRUHead.prev->next = b;
+ LRUHead.prev = b;
+}
+
+void CDAFCache::Request(const uint64 key, const bool urgent)
+{
+ for(auto it = Requests.begin(); it != Requests.end(); ++it)
+ {
+  if(*it == key)
+  {
+   if(!urgent)
+    return;
+
+   Requests.erase(it);
+   break;
+  }
+ }
+
+ if(urgent)
+  Requests.push_front(key);
+ else
+  Requests.push_back(key);
+
+ MThreading::Cond_Signal(ThreadCond);
+}
+
+//
+// Called from the CD read thread.
+//
+uint64 CDAFCache::Read(const uint32 source, uint64 frame_offset, int16* buffer, const uint64 frames)
+{
+ uint64 ret = 0;
+
+ MThreading::Mutex_Lock(CacheMutex);
+
+ const uint64 frame_count = Sources[source]->frame_count;
+
+ while(ret < frames && frame_offset < frame_count)
+ {
+  const uint64 key = MakeKey(source, frame_offset / BlockFrames);
+  Block* b = Lookup(key);
+
+  if(!b)
+  {
+   Request(key, true);
+   MThreading::Cond_Wait(BlockCond, CacheMutex);
+   continue;
+  }
+
+  const uint32 offs = frame_offset % BlockFrames;
+
+  if(offs >= b->frames)	// Decoding error, or end of data.
+  {
+   // Errors may be transient(e.g. a file on a network share), so don't keep the short block.
+   if(b->frames < std::min<uint64>(BlockFrames, frame_count - (frame_offset - offs)))
+    Evict(b);
+
+   break;
+  }
+
+  const uint32 count = std::min<uint64>(frames - ret, b->frames - offs);
+
+  memcpy(buffer + ret * 2, b->data + offs * 2, count * 2 * sizeof(int16));
+  ret += count;
+  frame_offset += count;
+
+  Unlink(b);
+  LinkMRU(b);
+ }
+
+ for(uint64 block = frame_offset / BlockFrames, n = 0; n < ReadAheadBlocks && (block * BlockFrames) < frame_count; block++, n++)
+ {
+  const uint64 key = MakeKey(source, block);
+
+  if(!Lookup(key))
+   Request(key, false);
+ }
+
+ MThreading::Mutex_Unlock(CacheMutex);
+
+ return ret;
+}
+
+void CDAFCache::Hint(const uint32 source, const uint64 frame_offset, const uint64 frames)
+{
+ MThreading::Mutex_Lock(CacheMutex);
+
+ const uint64 bound = std::min<uint64>(Sources[source]->frame_count, frame_offset + std::min<uint64>(frames, (uint64)ReadAheadBlocks * BlockFrames));
+
+ for(uint64 block = frame_offset / BlockFrames; (block * BlockFrames) < bound; block++)
+ {
+  const uint64 key = MakeKey(source, block);
+
+  if(!Lookup(key))
+   Request(key, false);
+ }
+
+ MThreading::Mutex_Unlock(CacheMutex);
+}
+
+//
+// Called from the cache thread, with CacheMutex held; the returned block is in neither the map nor the LRU list.
+//
+CDAFCache::Block* CDAFCache::AllocBlock(void)
+{
+ if(BlockStorage.size() < BlockCapacity)
+ {
+  BlockStorage.emplace_back(new Block());
+
+  return BlockStorage.back().get();
+ }
+
+ Block* b = LRUHead.prev;
+
+ Unlink(b);
+
+ if(b->key != NoKey)
+  BlockMap.erase(b->key);
+
+ return b;
+}
+
+//
+// Called from the cache thread, without CacheMutex held.
+//
+uint32 CDAFCache::Decode(Source* src, const uint64 frame_offset, int16* buffer, const uint32 frames)
+{
+ uint32 ret = 0;
+
+ if(frame_offset >= src->frame_count)
+  return 0;
+
+ try
+ {
+  const uint32 count = std::min<uint64>(frames, src->frame_count - frame_offset);
+
+  if(src->sidecar)
+  {
+   src->sidecar->seek(frame_offset * 4, SEEK_SET);
+   ret = src->sidecar->read(buffer, count * 4, false) / 4;
+   Endian_A16_NE_LE(buffer, ret * 2);
+  }
+  else
+   ret = src->reader->Read(frame_offset, buffer, count);
+ }
+ catch(std::exception&)
+ {
+  ret = 0;
+ }
+
+ return ret;
+}
+
+//
+// Hashes the next piece of a compressed file, or decodes the next piece of a sidecar file, if any; returns
+// false if there's nothing left to do.
+//
+// Called from the cache thread, without CacheMutex held.
+//
+bool CDAFCache::PersistStep(void)
+{
+ Source* src = nullptr;
+
+ MThreading::Mutex_Lock(CacheMutex);
+ for(auto& s : Sources)
+ {
+  if(s->persist_pending)
+  {
+   src = s.get();
+   break;
+  }
+ }
+ MThreading::Mutex_Unlock(CacheMutex);
+
+ if(!src)
+  return false;
+
+ try
+ {
+  if(src->hash_fp)
+  {
+   const uint64 fp_pos = src->hash_fp->tell();
+   std::unique_ptr<uint8[]> buf(new uint8[65536]);
+   uint64 count;
+
+   src->hash_fp->seek(src->hash_pos, SEEK_SET);
+   count = src->hash_fp->read(buf.get(), 65536, false);
+   src->hash_fp->seek(fp_pos, SEEK_SET);
+
+   src->hasher.process(buf.get(), count);
+   src->hash_pos += count;
+
+   if(!count)
+   {
+    std::unique_ptr<Stream> sc;
+
+    src->hash_fp = nullptr;
+    src->sidecar_path = MDFN_MakeFName(MDFNMKF_CDAUDIO_CACHE, 0, md5_context::asciistr(&src->hasher.digest()[0], false) + ".pcm");
+    sc.reset(NVFS.open(src->sidecar_path, VirtualFS::MODE_READ, false, false));
+
+    if(sc && sc->size() == src->frame_count * 4)
+    {
+     src->sidecar = std::move(sc);
+
+     MThreading::Mutex_Lock(CacheMutex);
+     src->persist_pending = false;
+     MThreading::Mutex_Unlock(CacheMutex);
+    }
+   }
+
+   return true;
+  }
+
+  const std::string tmp_path = src->sidecar_path + ".tmp";
+
+  if(!src->sidecar_out)
+  {
+   NVFS.create_missing_dirs(tmp_path);
+   src->sidecar_out.reset(NVFS.open(tmp_path, VirtualFS::MODE_WRITE));
+  }
+
+  if(src->sidecar_out_pos < src->frame_count)
+  {
+   std::unique_ptr<int16[]> buf(new int16[BlockFrames * 2]);
+   const uint32 count = std::min<uint64>(BlockFrames, src->frame_count - src->sidecar_out_pos);
+
+   if(Decode(src, src->sidecar_out_pos, buf.get(), count) != count)
+    throw MDFN_Error(0, _("Error decoding audio."));
+
+   Endian_A16_NE_LE(buf.get(), count * 2);
+   src->sidecar_out->write(buf.get(), count * 4);
+   src->sidecar_out_pos += count;
+  }
+  else
+  {
+   src->sidecar_out->close();
+   src->sidecar_out.reset();
+   NVFS.rename(tmp_path, src->sidecar_path);
+   src->sidecar.reset(NVFS.open(src->sidecar_path, VirtualFS::MODE_READ));
+
+   MThreading::Mutex_Lock(CacheMutex);
+   src->persist_pending = false;
+   MThreading::Mutex_Unlock(CacheMutex);
+  }
+ }
+ catch(std::exception&)
+ {
+  src->sidecar_out.reset();
+
+  MThreading::Mutex_Lock(CacheMutex);
+  src->persist_pending = false;
+  MThreading::Mutex_Unlock(CacheMutex);
+ }
+
+ return true;
+}
+
+int CDAFCache::ThreadStart_C(void* v)
+{
+ ((CDAFCache*)v)->Thread();
+
+ return 0;
+}
+
+void CDAFCache::Thread(void)
+{
+ MThreading::Mutex_Lock(CacheMutex);
+
+ for(;;)
+ {
+  if(ThreadExit)
+   break;
+
+  if(Requests.empty())
+  {
+   bool persist_work;
+
+   // Background persistence only runs while there are no requests.
+   MThreading::Mutex_Unlock(CacheMutex);
+   persist_work = PersistStep();
+   MThreading::Mutex_Lock(CacheMutex);
+
+   if(!persist_work && Requests.empty() && !ThreadExit)
+    MThreading::Cond_Wait(ThreadCond, CacheMutex);
+
+   continue;
+  }
+
+  const uint64 key = Requests.front();
+
+  Requests.pop_front();
+
+  if(Lookup(key))
+   continue;
+
+  Source* src = Sources[key >> 40].get();
+  Block* b = AllocBlock();
+
+  MThreading::Mutex_Unlock(CacheMutex);
+  b->frames = Decode(src, (key & (((uint64)1 << 40) - 1)) * BlockFrames, b->data, BlockFrames);
+  MThreading::Mutex_Lock(CacheMutex);
+
+  b->key = key;
+  BlockMap[key] = b;
+  LinkMRU(b);
+
+  MThreading::Cond_Signal(BlockCond);
+ }
+
+ MThreading::Mutex_Unlock(CacheMutex);
+}
+
+}
@@ -0,0 +1,130 @@
+/******************************************************************************/
+/* Mednafen - Multi-system Emulator                                           */
+/******************************************************************************/
+/* CDAFCache.h - Decoded CD-DA cache for compressed audio tracks
+**  Copyright (C) 2021 Mednafen Team
+**
+** This program is free software; you can redistribute it and/or
+** modify it under the terms of the GNU General Public License
+** as published by the Free Software Foundation; either version 2
+** of the License, or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef __MDFN_CDROM_CDAFCACHE_H
+#define __MDFN_CDROM_CDAFCACHE_H
+
+#include <mednafen/MThreading.h>
+#include <mednafen/hash/md5.h>
+#include "CDAFReader.h"
+
+#include <deque>
+#include <unordered_map>
+
+namespace Mednafen
+{
+
+//
+// Bounded LRU cache of decoded audio, shared by all of a disc's audio files.  All decoding is done on
+// the cache's own thread, on demand and ahead of the read position, so that seeking back into a
+// track(e.g. a music loop) doesn't mean seeking and decoding all over again.
+//
+// Optionally, each file is also decoded in full, in the background, to a raw PCM "sidecar" file
+// named after the MD5 hash of the compressed file; when one exists, it's read instead of decoding.
+// The hashing is done in the background too, so until it's finished, audio is decoded as usual.
+//
+class CDAFCache
+{
+ public:
+
+ CDAFCache(const uint32 size_mb, const bool persist) MDFN_COLD;
+ ~CDAFCache() MDFN_COLD;
+
+ //
+ // Returns a reader that reads "reader"'s audio through the cache, and takes ownership of "reader",
+ // which is only ever used by the cache's thread from then on, until the cache is destroyed.
+ //
+ // "fp" is the stream "reader" reads from, for hashing if persistence is enabled; it's only used
+ // by the cache's thread, between reads by "reader", and must stay valid until the cache is destroyed.
+ //
+ // The returned reader must not be used after the CDAFCache object is destroyed.
+ //
+ CDAFReader* Wrap(CDAFReader* reader, Stream* fp) MDFN_COLD;
+
+ private:
+
+ friend class CDAFReader_Cached;
+
+ enum : uint32 { BlockFrames = 588 * 16 };
+ enum : uint32 { ReadAheadBlocks = 4 };
+
+ struct Block
+ {
+  uint64 key;
+  Block* prev;
+  Block* next;
+  uint32 frames;
+  int16 data[BlockFrames * 2];
+ };
+
+ struct Source
+ {
+  ~Source();
+
+  CDAFReader* reader;
+  uint64 frame_count;
+  std::unique_ptr<Stream> sidecar;	// Read instead of decoding, when present.
+
+  Stream* hash_fp;	// Non-null until hashing is done.
+  uint64 hash_pos;
+  md5_hasher hasher;
+
+  std::string sidecar_path;
+  std::unique_ptr<Stream> sidecar_out;
+  uint64 sidecar_out_pos;
+  bool persist_pending;
+ };
+
+ static INLINE uint64 MakeKey(const uint32 source, const uint64 block) { return ((uint64)source << 40) | block; }
+ enum : uint64 { NoKey = ~(uint64)0 };	// For evicted blocks, which are in neither the map nor a request.
+
+ uint64 Read(const uint32 source, uint64 frame_offset, int16* buffer, const uint64 frames);
+ void Hint(const uint32 source, const uint64 frame_offset, const uint64 frames);
+
+ Block* Lookup(const uint64 key);
+ void Request(const uint64 key, const bool urgent);
+ void Unlink(Block* b);
+ void LinkMRU(Block* b);
+ void Evict(Block* b);
+ Block* AllocBlock(void);
+ uint32 Decode(Source* src, const uint64 frame_offset, int16* buffer, const uint32 frames);
+ bool PersistStep(void);
+
+ static int ThreadStart_C(void* v);
+ void Thread(void);
+
+ std::vector<std::unique_ptr<Source>> Sources;
+ std::vector<std::unique_ptr<Block>> BlockStorage;
+ size_t BlockCapacity;
+ Block LRUHead;	// Circular list; LRUHead.next is most recently used.
+ std::unordered_map<uint64, Block*> BlockMap;
+ std::deque<uint64> Requests;
+ const bool Persist;
+
+ MThreading::Mutex* CacheMutex;	// Protects everything above, except Source fields used only by the thread.
+ MThreading::Cond* ThreadCond;	// Signaled on a new request, or exit.
+ MThreading::Cond* BlockCond;	// Signaled when a block has been decoded.
+ MThreading::Thread* CacheThread;
+ bool ThreadExit;
+};
+
+}
+#endif
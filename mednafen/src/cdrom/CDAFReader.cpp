@@ -49,6 +49,16 @@ CDAFReader::~CDAFReader()
 
 }
 
+bool CDAFReader::IsCompressed(void)
+{
+ return true;
+}
+
+void CDAFReader::HintRead(uint64 frame_offset, uint64 frames)
+{
+
+}
+
 CDAFReader* CDAFR_Open(Stream* fp)
 {
  static CDAFReader* (* const OpenFuncs[])(Stream* fp) =
@@ -34,6 +34,14 @@ class CDAFReader
  virtual ~CDAFReader();
 
  virtual uint64 FrameCount(void) = 0;
+
+ // False for formats that don't need decoding as such(e.g. WAV), and so gain nothing from caching.
+ virtual bool IsCompressed(void);
+
+ // Hint that "frames" frames starting at "frame_offset" will be read soon; a no-op unless the reader
+ // can do something about it.
+ virtual void HintRead(uint64 frame_offset, uint64 frames);
+
  INLINE uint64 Read(uint64 frame_offset, int16 *buffer, uint64 frames)
  {
   uint64 ret;
@@ -35,6 +35,7 @@ class CDAFReader_PCM final : public CDAFReader
  uint64 Read_(int16 *buffer, uint64 frames) override;
  bool Seek_(uint64 frame_offset) override;
  uint64 FrameCount(void) override;
+ bool IsCompressed(void) override;
 
  enum
  {
@@ -916,6 +917,11 @@ uint64 CDAFReader_PCM::FrameCount(void)
  return num_frames;
 }
 
+bool CDAFReader_PCM::IsCompressed(void)
+{
+ return false;
+}
+
 CDAFReader* CDAFR_PCM_Open(Stream* fp)
 {
  return new CDAFReader_PCM(fp);
@@ -21,8 +21,15 @@
 
 #include <mednafen/mednafen.h>
 #include "CDAccess.h"
+#include <mednafen/FileStream.h>
 #include "CDAccess_Image.h"
 #include "CDAccess_CCD.h"
+#include "CDAccess_CDZ.h"
+
+#if defined(HAVE_MMAP) && defined(HAVE_MADVISE)
+ #include <sys/mman.h>
+ #include <unistd.h>
+#endif
 
 namespace Mednafen
 {
@@ -39,12 +46,46 @@ CDAccess::~CDAccess()
 
 }
 
+void CDAccess::HintReadAhead(int32 lba, uint32 count) noexcept
+{
+
+}
+
+const uint8* CDAccess::MapRandom(Stream* s, bool* file_mapped) noexcept
+{
+ FileStream* fs = dynamic_cast<FileStream*>(s);
+ const uint8* ret = fs ? fs->map_random() : s->map();
+
+ *file_mapped = (fs && ret);
+
+ return ret;
+}
+
+void CDAccess::AdviseWillNeed(const uint8* map_base, uint64 map_size, uint64 offset, uint64 length) noexcept
+{
+#if defined(HAVE_MMAP) && defined(HAVE_MADVISE)
+ static const uintptr_t page_mask = sysconf(_SC_PAGESIZE) - 1;
+
+ if(offset >= map_size)
+  return;
+
+ length = std::min<uint64>(length, map_size - offset);
+
+ const uintptr_t start = (uintptr_t)(map_base + offset) & ~page_mask;
+ const uintptr_t end = (uintptr_t)(map_base + offset + length);
+
+ madvise((void*)start, end - start, MADV_WILLNEED);
+#endif
+}
+
 CDAccess* CDAccess_Open(VirtualFS* vfs, const std::string& path, bool image_memcache)
 {
  CDAccess *ret = NULL;
 
  if(vfs->test_ext(path, ".ccd"))
   ret = new CDAccess_CCD(vfs, path, image_memcache);
+ else if(vfs->test_ext(path, ".cdz"))
+  ret = new CDAccess_CDZ(vfs, path, image_memcache);
  else
   ret = new CDAccess_Image(vfs, path, image_memcache);
 
@@ -44,6 +44,19 @@ class CDAccess
 
  virtual void Read_TOC(CDUtility::TOC *toc) = 0;
 
+ // Hint that sectors [lba, lba + count) will probably be read soon; called from the same thread as Read_Raw_Sector().
+ virtual void HintReadAhead(int32 lba, uint32 count) noexcept;
+
+ protected:
+
+ // Like Stream::map(), but a FileStream is mapped as randomly accessed, so that kernel read-ahead on page faults doesn't
+ // compete with the windowed AdviseWillNeed() hints; "*file_mapped" is set to whether the result is such a mapping.
+ static const uint8* MapRandom(Stream* s, bool* file_mapped) noexcept;
+
+ // madvise()'s [offset, offset + length) of a mapping from MapRandom() as about to be needed; only call it when
+ // MapRandom() reported a file mapping.
+ static void AdviseWillNeed(const uint8* map_base, uint64 map_size, uint64 offset, uint64 length) noexcept;
+
  private:
  CDAccess(const CDAccess&);	// No copy constructor.
  CDAccess& operator=(const CDAccess&); // No assignment operator.
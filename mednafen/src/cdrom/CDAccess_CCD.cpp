@@ -82,7 +82,7 @@ static T CCD_ReadInt(CCD_Section &s, const std::string &propname, const bool hav
 }
 
 
-CDAccess_CCD::CDAccess_CCD(VirtualFS* vfs, const std::string& path, bool image_memcache) : img_numsectors(0)
+CDAccess_CCD::CDAccess_CCD(VirtualFS* vfs, const std::string& path, bool image_memcache) : img_map(NULL), img_map_is_file(false), img_numsectors(0)
 {
  Load(vfs, path, image_memcache);
 }
@@ -264,6 +264,9 @@ void CDAccess_CCD::Load(VirtualFS* vfs, const std::string& path, bool image_memc
    throw MDFN_Error(0, _("CCD image is too large."));
 
   img_numsectors = ss / 2352;  
+
+  if((img_map = MapRandom(img_stream.get(), &img_map_is_file)) && img_stream->map_size() < ss)
+   img_map = NULL;
  }
 
  //
@@ -395,12 +398,23 @@ void CDAccess_CCD::Read_Raw_Sector(uint8 *buf, int32 lba)
   return;
  }
 
- img_stream->seek(lba * 2352, SEEK_SET);
- img_stream->read(buf, 2352);
+ if(img_map)
+  memcpy(buf, img_map + (size_t)lba * 2352, 2352);
+ else
+ {
+  img_stream->seek(lba * 2352, SEEK_SET);
+  img_stream->read(buf, 2352);
+ }
 
  subpw_interleave(&sub_data[lba * 96], buf + 2352);
 }
 
+void CDAccess_CCD::HintReadAhead(int32 lba, uint32 count) noexcept
+{
+ if(img_map && img_map_is_file && lba >= 0)
+  AdviseWillNeed(img_map, (uint64)img_numsectors * 2352, (uint64)lba * 2352, (uint64)count * 2352);
+}
+
 bool CDAccess_CCD::Fast_Read_Raw_PW_TSRE(uint8* pwbuf, int32 lba) const noexcept
 {
  if(lba < 0)
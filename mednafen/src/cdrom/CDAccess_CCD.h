@@ -37,6 +37,8 @@ class CDAccess_CCD : public CDAccess
 
  virtual void Read_TOC(CDUtility::TOC *toc);
 
+ virtual void HintReadAhead(int32 lba, uint32 count) noexcept;
+
  private:
 
  void Load(VirtualFS* vfs, const std::string& path, bool image_memcache);
@@ -45,6 +47,8 @@ class CDAccess_CCD : public CDAccess
  void CheckSubQSanity(void);
 
  std::unique_ptr<Stream> img_stream;
+ const uint8* img_map;	// From MapRandom(img_stream); NULL if the stream couldn't be mapped.
+ bool img_map_is_file;
  std::unique_ptr<uint8[]> sub_data;
 
  size_t img_numsectors;
@@ -0,0 +1,393 @@
+/******************************************************************************/
+/* Mednafen - Multi-system Emulator                                           */
+/******************************************************************************/
+/* CDAccess_CDZ.cpp:
+**  Copyright (C) 2021 Mednafen Team
+**
+** This program is free software; you can redistribute it and/or
+** modify it under the terms of the GNU General Public License
+** as published by the Free Software Foundation; either version 2
+** of the License, or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <mednafen/mednafen.h>
+#include <mednafen/MemoryStream.h>
+#include "CDAccess_CDZ.h"
+
+#include <zlib.h>
+
+namespace Mednafen
+{
+
+using namespace CDUtility;
+
+static uint32 StoredSectorSize(const uint8 type)
+{
+ switch(type)
+ {
+  case CDZ_SECTOR_RAW: return 2352;
+  case CDZ_SECTOR_MODE1: return 2048;
+  case CDZ_SECTOR_MODE2_FORM1: return 8 + 2048;
+  case CDZ_SECTOR_MODE2_FORM2: return 8 + 2324;
+ }
+
+ return 0;
+}
+
+CDAccess_CDZ::CDAccess_CDZ(VirtualFS* vfs, const std::string& path, bool image_memcache) : img_map(NULL), img_map_is_file(false), img_size(0), img_numsectors(0), hunk_sectors(0), hunk_count(0), decoded_counter(0), zdctx(NULL)
+{
+ try
+ {
+  Load(vfs, path, image_memcache);
+ }
+ catch(...)
+ {
+  Cleanup();
+  throw;
+ }
+}
+
+CDAccess_CDZ::~CDAccess_CDZ()
+{
+ Cleanup();
+}
+
+void CDAccess_CDZ::Cleanup(void)
+{
+ if(zdctx)
+ {
+  ZSTD_freeDCtx(zdctx);
+  zdctx = NULL;
+ }
+}
+
+void CDAccess_CDZ::Load(VirtualFS* vfs, const std::string& path, bool image_memcache)
+{
+ uint8 header[CDZ_HEADER_SIZE];
+ uint64 index_offset;
+ uint64 sub_offset;
+ uint32 sub_length;
+ uint32 sub_crc32;
+
+ if(image_memcache)
+  img_stream.reset(new MemoryStream(vfs->open(path, VirtualFS::MODE_READ)));
+ else
+ {
+  img_stream.reset(vfs->open(path, VirtualFS::MODE_READ));
+  img_stream->require_fast_seekable();
+ }
+
+ img_size = img_stream->size();
+
+ if(img_stream->read(header, sizeof(header), false) != sizeof(header) || memcmp(header, "MDFNCDZ", 8))
+  throw MDFN_Error(0, _("Not a CDZ image."));
+
+ if(MDFN_de32lsb(&header[0x08]) != CDZ_VERSION)
+  throw MDFN_Error(0, _("CDZ image format version %u is not supported."), MDFN_de32lsb(&header[0x08]));
+
+ img_numsectors = MDFN_de32lsb(&header[0x10]);
+ hunk_sectors = MDFN_de32lsb(&header[0x14]);
+ index_offset = MDFN_de64lsb(&header[0x18]);
+ sub_offset = MDFN_de64lsb(&header[0x348]);
+ sub_length = MDFN_de32lsb(&header[0x350]);
+ sub_crc32 = MDFN_de32lsb(&header[0x354]);
+
+ if(!img_numsectors || img_numsectors > (0x7FFFFFFF / 96))
+  throw MDFN_Error(0, _("CDZ image sector count of %u is invalid."), img_numsectors);
+
+ if(!hunk_sectors || hunk_sectors > MaxHunkSectors)
+  throw MDFN_Error(0, _("CDZ image hunk size of %u sectors is invalid."), hunk_sectors);
+
+ //
+ // TOC
+ //
+ tocd.Clear();
+ tocd.first_track = header[0x20];
+ tocd.last_track = header[0x21];
+ tocd.disc_type = header[0x22];
+
+ for(unsigned t = 1; t <= 100; t++)
+ {
+  const uint8* te = &header[0x28 + (t - 1) * 8];
+
+  tocd.tracks[t].lba = MDFN_de32lsb(&te[0]);
+  tocd.tracks[t].adr = te[4];
+  tocd.tracks[t].control = te[5];
+  tocd.tracks[t].valid = (te[6] != 0);
+ }
+
+ if(tocd.first_track < 1 || tocd.first_track > 99 || tocd.last_track < tocd.first_track || tocd.last_track > 99)
+  throw MDFN_Error(0, _("CDZ image TOC track range of %u through %u is invalid."), tocd.first_track, tocd.last_track);
+
+ for(unsigned t = tocd.first_track; t <= tocd.last_track; t++)
+ {
+  if(!tocd.tracks[t].valid)
+   throw MDFN_Error(0, _("CDZ image TOC is missing track %u."), t);
+ }
+
+ tocd.tracks[100].valid = true;
+ if(tocd.tracks[100].lba != img_numsectors)
+  throw MDFN_Error(0, _("CDZ image TOC leadout LBA of %u doesn't match the sector count of %u."), tocd.tracks[100].lba, img_numsectors);
+
+ //
+ // Hunk index
+ //
+ hunk_count = (img_numsectors + hunk_sectors - 1) / hunk_sectors;
+
+ if(index_offset < CDZ_HEADER_SIZE || index_offset > img_size || (img_size - index_offset) < (uint64)hunk_count * 16)
+  throw MDFN_Error(0, _("CDZ image hunk index is truncated."));
+
+ const uint64 max_hunk_size = (uint64)hunk_sectors * (1 + 2352);
+ const uint64 max_comp_size = std::max<uint64>(max_hunk_size, ZSTD_COMPRESSBOUND(max_hunk_size));
+ uint32 max_length = 0;
+ {
+  std::unique_ptr<uint8[]> raw_index(new uint8[(size_t)hunk_count * 16]);
+
+  img_stream->seek(index_offset, SEEK_SET);
+  img_stream->read(raw_index.get(), (size_t)hunk_count * 16);
+
+  hunk_index.reset(new HunkIndexEntry[hunk_count]);
+
+  for(uint32 h = 0; h < hunk_count; h++)
+  {
+   HunkIndexEntry* e = &hunk_index[h];
+   const uint8* re = &raw_index[h * 16];
+
+   e->offset = MDFN_de64lsb(&re[0]);
+   e->length = MDFN_de32lsb(&re[8]);
+   e->crc32 = MDFN_de32lsb(&re[12]);
+
+   const uint32 length = e->length & ~CDZ_HUNK_UNCOMPRESSED;
+
+   if(length > max_comp_size || e->offset > img_size || (img_size - e->offset) < length)
+    throw MDFN_Error(0, _("CDZ image hunk index entry %u is invalid."), h);
+
+   max_length = std::max<uint32>(max_length, length);
+  }
+ }
+
+ if(!(zdctx = ZSTD_createDCtx()))
+  throw MDFN_Error(0, _("%s failed."), "ZSTD_createDCtx()");
+
+ //
+ // Subchannel data
+ //
+ {
+  const size_t sub_size = (size_t)img_numsectors * 96;
+  const uint32 length = sub_length & ~CDZ_HUNK_UNCOMPRESSED;
+  std::unique_ptr<uint8[]> comp(new uint8[std::max<uint32>(1, length)]);
+  size_t size;
+
+  if(sub_offset > img_size || (img_size - sub_offset) < length)
+   throw MDFN_Error(0, _("CDZ image subchannel data is truncated."));
+
+  img_stream->seek(sub_offset, SEEK_SET);
+  img_stream->read(comp.get(), length);
+
+  sub_data.reset(new uint8[sub_size]);
+
+  if(sub_length & CDZ_HUNK_UNCOMPRESSED)
+  {
+   size = std::min<size_t>(length, sub_size);
+   memcpy(sub_data.get(), comp.get(), size);
+  }
+  else
+  {
+   size = ZSTD_decompressDCtx(zdctx, sub_data.get(), sub_size, comp.get(), length);
+
+   if(ZSTD_isError(size))
+    throw MDFN_Error(0, _("Error decompressing CDZ image subchannel data: %s"), ZSTD_getErrorName(size));
+  }
+
+  if(size != sub_size || length > sub_size || crc32(0, sub_data.get(), size) != sub_crc32)
+   throw MDFN_Error(0, _("CDZ image subchannel data is corrupt."));
+ }
+
+ if((img_map = MapRandom(img_stream.get(), &img_map_is_file)) && img_stream->map_size() < img_size)
+  img_map = NULL;
+
+ if(!img_map)
+  comp_buf.reset(new uint8[std::max<uint32>(1, max_length)]);
+
+ for(auto& dh : decoded_hunks)
+ {
+  dh.hunk = ~0U;
+  dh.last_used = 0;
+  dh.data.reset(new uint8[max_hunk_size]);
+  dh.sector_offs.reset(new uint32[hunk_sectors]);
+ }
+}
+
+CDAccess_CDZ::DecodedHunk* CDAccess_CDZ::GetHunk(const uint32 hunk)
+{
+ DecodedHunk* dh = &decoded_hunks[0];
+
+ for(auto& cand : decoded_hunks)
+ {
+  if(cand.hunk == hunk)
+  {
+   cand.last_used = ++decoded_counter;
+   return &cand;
+  }
+
+  if(cand.last_used < dh->last_used)
+   dh = &cand;
+ }
+ //
+ //
+ //
+ const HunkIndexEntry* e = &hunk_index[hunk];
+ const uint32 length = e->length & ~CDZ_HUNK_UNCOMPRESSED;
+ const uint32 nsectors = std::min<uint32>(hunk_sectors, img_numsectors - hunk * hunk_sectors);
+ const size_t max_hunk_size = (size_t)hunk_sectors * (1 + 2352);
+ const uint8* src;
+ size_t size;
+
+ dh->hunk = ~0U;
+
+ if(img_map)
+  src = img_map + e->offset;
+ else
+ {
+  img_stream->seek(e->offset, SEEK_SET);
+  img_stream->read(comp_buf.get(), length);
+  src = comp_buf.get();
+ }
+
+ if(e->length & CDZ_HUNK_UNCOMPRESSED)
+ {
+  if(length > max_hunk_size)
+   throw MDFN_Error(0, _("CDZ image hunk %u is corrupt."), hunk);
+
+  memcpy(dh->data.get(), src, length);
+  size = length;
+ }
+ else
+ {
+  size = ZSTD_decompressDCtx(zdctx, dh->data.get(), max_hunk_size, src, length);
+
+  if(ZSTD_isError(size))
+   throw MDFN_Error(0, _("Error decompressing CDZ image hunk %u: %s"), hunk, ZSTD_getErrorName(size));
+ }
+
+ if(crc32(0, dh->data.get(), size) != e->crc32)
+  throw MDFN_Error(0, _("CDZ image hunk %u is corrupt(CRC-32 mismatch)."), hunk);
+
+ {
+  size_t offs = nsectors;
+
+  for(uint32 s = 0; s < nsectors; s++)
+  {
+   const uint32 ss = StoredSectorSize(dh->data[s]);
+
+   if(!ss)
+    throw MDFN_Error(0, _("CDZ image hunk %u has a sector with an unknown storage type of %u."), hunk, dh->data[s]);
+
+   dh->sector_offs[s] = offs;
+   offs += ss;
+  }
+
+  if(offs != size)
+   throw MDFN_Error(0, _("CDZ image hunk %u is corrupt(size mismatch)."), hunk);
+ }
+
+ dh->hunk = hunk;
+ dh->last_used = ++decoded_counter;
+
+ return dh;
+}
+
+void CDAccess_CDZ::Read_Raw_Sector(uint8 *buf, int32 lba)
+{
+ if(lba < 0)
+ {
+  synth_udapp_sector_lba(0xFF, tocd, lba, 0, buf);
+  return;
+ }
+
+ if((uint32)lba >= img_numsectors)
+ {
+  synth_leadout_sector_lba(0xFF, tocd, lba, buf);
+  return;
+ }
+
+ const uint32 hunk = (uint32)lba / hunk_sectors;
+ const uint32 s = (uint32)lba % hunk_sectors;
+ DecodedHunk* dh = GetHunk(hunk);
+ const uint8 type = dh->data[s];
+ const uint8* sd = &dh->data[dh->sector_offs[s]];
+
+ switch(type)
+ {
+  case CDZ_SECTOR_RAW:
+	memcpy(buf, sd, 2352);
+	break;
+
+  case CDZ_SECTOR_MODE1:
+	memset(buf, 0, 2352);
+	memcpy(buf + 16, sd, 2048);
+	encode_mode1_sector(LBA_to_ABA(lba), buf);
+	break;
+
+  case CDZ_SECTOR_MODE2_FORM1:
+	memset(buf, 0, 2352);
+	memcpy(buf + 16, sd, 8 + 2048);
+	encode_mode2_form1_sector(LBA_to_ABA(lba), buf);
+	break;
+
+  case CDZ_SECTOR_MODE2_FORM2:
+	memset(buf, 0, 2352);
+	memcpy(buf + 16, sd, 8 + 2324);
+	encode_mode2_form2_sector(LBA_to_ABA(lba), buf);
+	break;
+ }
+
+ subpw_interleave(&sub_data[(size_t)lba * 96], buf + 2352);
+}
+
+void CDAccess_CDZ::HintReadAhead(int32 lba, uint32 count) noexcept
+{
+ if(!img_map || !img_map_is_file || lba < 0 || (uint32)lba >= img_numsectors || !count)
+  return;
+
+ const uint32 first = (uint32)lba / hunk_sectors;
+ const uint32 last = std::min<uint32>(img_numsectors - 1, (uint32)lba + count - 1) / hunk_sectors;
+
+ for(uint32 h = first; h <= last; h++)
+  AdviseWillNeed(img_map, img_size, hunk_index[h].offset, hunk_index[h].length & ~CDZ_HUNK_UNCOMPRESSED);
+}
+
+bool CDAccess_CDZ::Fast_Read_Raw_PW_TSRE(uint8* pwbuf, int32 lba) const noexcept
+{
+ if(lba < 0)
+ {
+  subpw_synth_udapp_lba(tocd, lba, 0, pwbuf);
+  return true;
+ }
+
+ if((uint32)lba >= img_numsectors)
+ {
+  subpw_synth_leadout_lba(tocd, lba, pwbuf);
+  return true;
+ }
+
+ subpw_interleave(&sub_data[(size_t)lba * 96], pwbuf);
+
+ return true;
+}
+
+void CDAccess_CDZ::Read_TOC(CDUtility::TOC *toc)
+{
+ *toc = tocd;
+}
+
+}
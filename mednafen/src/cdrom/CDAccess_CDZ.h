@@ -0,0 +1,147 @@
+/******************************************************************************/
+/* Mednafen - Multi-system Emulator                                           */
+/******************************************************************************/
+/* CDAccess_CDZ.h:
+**  Copyright (C) 2021 Mednafen Team
+**
+** This program is free software; you can redistribute it and/or
+** modify it under the terms of the GNU General Public License
+** as published by the Free Software Foundation; either version 2
+** of the License, or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef __MDFN_CDROM_CDACCESS_CDZ_H
+#define __MDFN_CDROM_CDACCESS_CDZ_H
+
+#include "CDAccess.h"
+
+#include <zstd/zstd.h>
+
+namespace Mednafen
+{
+
+//
+// Single-file, block-compressed disc image(".cdz").  The main channel data of the disc's sectors, from LBA 0 up to the
+// leadout, is grouped into fixed-size "hunks", each compressed independently with zstd and located through an index, so
+// any sector can be read by decompressing only its hunk.  The subchannel data of the whole disc is stored separately, and
+// loaded into memory along with the index, so that it can be read without touching the hunks(as for
+// Fast_Read_Raw_PW_TSRE()).  All integers are little-endian.
+//
+//  Header(856 bytes):
+//   0x000  8   Magic, "MDFNCDZ" followed by a 0 byte.
+//   0x008  4   Format version, 2.
+//   0x00C  4   Flags, 0.
+//   0x010  4   Number of sectors.
+//   0x014  4   Sectors per hunk(1 through 256); every hunk but the last is full.
+//   0x018  8   File offset of the hunk index.
+//   0x020  1   TOC first track.
+//   0x021  1   TOC last track.
+//   0x022  1   TOC disc type.
+//   0x023  5   Reserved, 0.
+//   0x028  800 TOC entries for tracks 1 through 99 and the leadout(100), 8 bytes each:
+//               LBA(4), ADR(1), control(1), valid(1), reserved(1).
+//   0x348  8   File offset of the subchannel data.
+//   0x350  4   Length of the subchannel data; if bit 31 is set, it's stored uncompressed, otherwise it's one zstd frame.
+//   0x354  4   CRC-32 of the uncompressed subchannel data.
+//
+//  Uncompressed subchannel data: 96 bytes for each sector, deinterleaved as in a CloneCD .sub file.
+//
+//  Hunk index, one 16-byte entry per hunk:
+//   0x000  8   File offset of the hunk data.
+//   0x008  4   Length of the hunk data; if bit 31 is set, the hunk is stored uncompressed, otherwise it's one zstd frame.
+//   0x00C  4   CRC-32 of the uncompressed hunk data.
+//
+//  Uncompressed hunk data, for a hunk of N sectors:
+//   N bytes: the storage type of each sector(CDZ_SECTOR_*).
+//   The stored main channel data of each sector, in order; its length depends on the sector's storage type.
+//
+// Data sectors are stored unscrambled, as in a BIN image.  Mode 1 and Mode 2 sectors whose sync pattern, header, EDC, and
+// ECC are exactly what lec.cpp would generate for them at their position may be stored with only their user data(and
+// subheader), and are re-synthesized on read.
+//
+enum : uint32
+{
+ CDZ_VERSION = 2,
+ CDZ_HEADER_SIZE = 0x28 + 100 * 8 + 16,
+ CDZ_HUNK_UNCOMPRESSED = 0x80000000	// In the hunk index entry and subchannel data length fields.
+};
+
+enum : uint8
+{
+ CDZ_SECTOR_RAW = 0,		// 2352 bytes.
+ CDZ_SECTOR_MODE1 = 1,		// 2048 bytes of user data.
+ CDZ_SECTOR_MODE2_FORM1 = 2,	// 8 bytes of subheader, and 2048 bytes of user data.
+ CDZ_SECTOR_MODE2_FORM2 = 3,	// 8 bytes of subheader, and 2324 bytes of user data.
+};
+
+class CDAccess_CDZ : public CDAccess
+{
+ public:
+
+ CDAccess_CDZ(VirtualFS* vfs, const std::string& path, bool image_memcache);
+ virtual ~CDAccess_CDZ();
+
+ virtual void Read_Raw_Sector(uint8 *buf, int32 lba);
+
+ virtual bool Fast_Read_Raw_PW_TSRE(uint8* pwbuf, int32 lba) const noexcept;
+
+ virtual void Read_TOC(CDUtility::TOC *toc);
+
+ virtual void HintReadAhead(int32 lba, uint32 count) noexcept;
+
+ private:
+
+ struct HunkIndexEntry
+ {
+  uint64 offset;
+  uint32 length;
+  uint32 crc32;
+ };
+
+ struct DecodedHunk
+ {
+  uint32 hunk;		// ~0U if empty.
+  uint32 last_used;
+  std::unique_ptr<uint8[]> data;
+  std::unique_ptr<uint32[]> sector_offs;	// Offset of each sector's main channel data in "data".
+ };
+
+ enum : uint32 { MaxHunkSectors = 256 };
+ enum : size_t { NumDecodedHunks = 4 };
+
+ void Load(VirtualFS* vfs, const std::string& path, bool image_memcache);
+ void Cleanup(void);
+
+ DecodedHunk* GetHunk(const uint32 hunk);
+
+ std::unique_ptr<Stream> img_stream;
+ const uint8* img_map;	// From MapRandom(img_stream); NULL if the stream couldn't be mapped.
+ bool img_map_is_file;
+ uint64 img_size;
+
+ uint32 img_numsectors;
+ uint32 hunk_sectors;
+ std::unique_ptr<HunkIndexEntry[]> hunk_index;
+ uint32 hunk_count;
+
+ DecodedHunk decoded_hunks[NumDecodedHunks];
+ uint32 decoded_counter;
+ std::unique_ptr<uint8[]> comp_buf;	// Compressed hunk data, when the image isn't mapped.
+ ZSTD_DCtx* zdctx;
+
+ std::unique_ptr<uint8[]> sub_data;	// 96 bytes per sector, deinterleaved.
+
+ CDUtility::TOC tocd;
+};
+
+}
+#endif
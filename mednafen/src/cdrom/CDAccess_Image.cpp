@@ -42,6 +42,7 @@
 #include "CDAccess_Image.h"
 
 #include "CDAFReader.h"
+#include "CDAFCache.h"
 
 #include <map>
 
@@ -186,6 +187,17 @@ uint32 CDAccess_Image::GetSectorCount(CDRFILE_TRACK_INFO *track)
  return size / div;
 }
 
+void CDAccess_Image::CacheAudioReader(CDRFILE_TRACK_INFO *track)
+{
+ if(!AudioCacheSize || !track->AReader->IsCompressed())
+  return;
+
+ if(!AudioCache)
+  AudioCache.reset(new CDAFCache(AudioCacheSize, AudioCachePersist));
+
+ track->AReader = AudioCache->Wrap(track->AReader, track->fp);
+}
+
 void CDAccess_Image::ParseTOCFileLineInfo(VirtualFS* vfs, CDRFILE_TRACK_INFO *track, const int tracknum, const std::string &filename, const char *binoffset, const char *msfoffset, const char *length, bool image_memcache, std::map<std::string, Stream*> &toc_streamcache)
 {
  long offset = 0; // In bytes!
@@ -228,6 +240,8 @@ void CDAccess_Image::ParseTOCFileLineInfo(VirtualFS* vfs, CDRFILE_TRACK_INFO *tr
   {
    if(!(track->AReader = CDAFR_Open(track->fp)))
     throw MDFN_Error(0, _("Unsupported audio track file format."));
+
+   CacheAudioReader(track);
   }
   catch(std::exception& e)
   {
@@ -668,6 +682,8 @@ void CDAccess_Image::ImageOpen(VirtualFS* vfs, const std::string& path, bool ima
       {
        if(!(TmpTrack.AReader = CDAFR_Open(TmpTrack.fp)))
         throw MDFN_Error(0, _("Unsupported audio track file format."));
+
+       CacheAudioReader(&TmpTrack);
       }
       catch(std::exception& e)
       {
@@ -922,6 +938,8 @@ void CDAccess_Image::ImageOpen(VirtualFS* vfs, const std::string& path, bool ima
   }
  }
 
+ GenerateSubQRuns();
+
  //
  // Load SBI file, if present
  //
@@ -941,11 +959,27 @@ void CDAccess_Image::ImageOpen(VirtualFS* vfs, const std::string& path, bool ima
   LoadSBI(vfs, vfs->eval_fip(base_dir, file_base + "." + sbi_ext, true));
  }
 
+ //
+ // Map binary track files into memory where possible, so sector reads don't need a seek and read per sector, and so
+ // the data is shared via the page cache rather than copied.  Read_Raw_Sector() falls back to the stream if not.
+ //
+ for(int32 x = FirstTrack; x < (FirstTrack + NumTracks); x++)
+ {
+  if(Tracks[x].fp && !Tracks[x].AReader)
+  {
+   Tracks[x].MapData = MapRandom(Tracks[x].fp, &Tracks[x].MapIsFile);
+   Tracks[x].MapSize = Tracks[x].MapData ? Tracks[x].fp->map_size() : 0;
+  }
+ }
+
  GenerateTOC();
 }
 
 void CDAccess_Image::Cleanup(void)
 {
+ // Stops the decoding thread, and deletes the underlying audio readers, before their streams are deleted.
+ AudioCache.reset();
+
  for(int32 track = 0; track < 100; track++)
  {
   CDRFILE_TRACK_INFO *this_track = &Tracks[track];
@@ -971,6 +1005,9 @@ CDAccess_Image::CDAccess_Image(VirtualFS* vfs, const std::string& path, bool ima
 {
  memset(Tracks, 0, sizeof(Tracks));
 
+ AudioCacheSize = MDFN_GetSettingUI("cd.audio_cache.size");
+ AudioCachePersist = MDFN_GetSettingB("cd.audio_cache.persist");
+
  try
  {
   ImageOpen(vfs, path, image_memcache);
@@ -987,9 +1024,19 @@ CDAccess_Image::~CDAccess_Image()
  Cleanup();
 }
 
+static INLINE void ReadTrackData(CDRFILE_TRACK_INFO* ct, const uint8** map_ptr, uint8* buf, const uint32 count)
+{
+ if(*map_ptr)
+ {
+  memcpy(buf, *map_ptr, count);
+  *map_ptr += count;
+ }
+ else
+  ct->fp->read(buf, count);
+}
+
 void CDAccess_Image::Read_Raw_Sector(uint8 *buf, int32 lba)
 {
-  uint8 SimuQ[0xC];
   int32 track;
   CDRFILE_TRACK_INFO *ct;
 
@@ -1028,7 +1075,6 @@ void CDAccess_Image::Read_Raw_Sector(uint8 *buf, int32 lba)
 
   memset(buf + 2352, 0, 96);
   track = MakeSubPQ(lba, buf + 2352);
-  subq_deinterleave(buf + 2352, SimuQ);
 
   ct = &Tracks[track];
 
@@ -1101,30 +1147,35 @@ void CDAccess_Image::Read_Raw_Sector(uint8 *buf, int32 lba)
     if(ct->SubchannelMode)
      SeekPos += 96 * (lba - ct->LBA);
 
-    ct->fp->seek(SeekPos, SEEK_SET);
+    const uint8* map_ptr = NULL;
+
+    if(ct->MapData && SeekPos >= 0 && ((uint64)SeekPos + DI_Size_Table[ct->DIFormat] + (ct->SubchannelMode ? 96 : 0)) <= ct->MapSize)
+     map_ptr = ct->MapData + SeekPos;
+    else
+     ct->fp->seek(SeekPos, SEEK_SET);
 
     switch(ct->DIFormat)
     {
 	case DI_FORMAT_AUDIO:
-		ct->fp->read(buf, 2352);
+		ReadTrackData(ct, &map_ptr, buf, 2352);
 
 		if(ct->RawAudioMSBFirst)
 		 Endian_A16_Swap(buf, 588 * 2);
 		break;
 
 	case DI_FORMAT_MODE1:
-		ct->fp->read(buf + 12 + 3 + 1, 2048);
+		ReadTrackData(ct, &map_ptr, buf + 12 + 3 + 1, 2048);
 		encode_mode1_sector(lba + 150, buf);
 		break;
 
 	case DI_FORMAT_MODE1_RAW:
 	case DI_FORMAT_MODE2_RAW:
 	case DI_FORMAT_CDI_RAW:
-		ct->fp->read(buf, 2352);
+		ReadTrackData(ct, &map_ptr, buf, 2352);
 		break;
 
 	case DI_FORMAT_MODE2:
-		ct->fp->read(buf + 16, 2336);
+		ReadTrackData(ct, &map_ptr, buf + 16, 2336);
 		encode_mode2_sector(lba + 150, buf);
 		break;
 
@@ -1132,23 +1183,45 @@ void CDAccess_Image::Read_Raw_Sector(uint8 *buf, int32 lba)
 	// FIXME: M2F1, M2F2, does sub-header come before or after user data(standards say before, but I wonder
 	// about cdrdao...).
 	case DI_FORMAT_MODE2_FORM1:
-		ct->fp->read(buf + 24, 2048);
+		ReadTrackData(ct, &map_ptr, buf + 24, 2048);
 		//encode_mode2_form1_sector(lba + 150, buf);
 		break;
 
 	case DI_FORMAT_MODE2_FORM2:
-		ct->fp->read(buf + 24, 2324);
+		ReadTrackData(ct, &map_ptr, buf + 24, 2324);
 		//encode_mode2_form2_sector(lba + 150, buf);
 		break;
 
     }
 
     if(ct->SubchannelMode)
-     ct->fp->read(buf + 2352, 96);
+     ReadTrackData(ct, &map_ptr, buf + 2352, 96);
    }
   } // end if audible part of audio track read.
 }
 
+void CDAccess_Image::HintReadAhead(int32 lba, uint32 count) noexcept
+{
+ for(int32 track = FirstTrack; track < (FirstTrack + NumTracks); track++)
+ {
+  const CDRFILE_TRACK_INFO* ct = &Tracks[track];
+
+  if(lba >= ct->LBA && lba < (ct->LBA + ct->sectors))
+  {
+   if(ct->MapData && ct->MapIsFile)
+   {
+    const int32 sector_size = DI_Size_Table[ct->DIFormat] + (ct->SubchannelMode ? 96 : 0);
+    const uint32 track_count = std::min<uint32>(count, ct->LBA + ct->sectors - lba);
+
+    AdviseWillNeed(ct->MapData, ct->MapSize, ct->FileOffset + (int64)(lba - ct->LBA) * sector_size, (uint64)track_count * sector_size);
+   }
+   else if(ct->AReader)
+    ct->AReader->HintRead((ct->FileOffset / 4) + (int64)(lba - ct->LBA) * 588, (uint64)std::min<uint32>(count, ct->LBA + ct->sectors - lba) * 588);
+   break;
+  }
+ }
+}
+
 bool CDAccess_Image::Fast_Read_Raw_PW_TSRE(uint8* pwbuf, int32 lba) const noexcept
 {
  int32 track;
@@ -1178,99 +1251,130 @@ bool CDAccess_Image::Fast_Read_Raw_PW_TSRE(uint8* pwbuf, int32 lba) const noexce
  return(true);
 }
 
-//
-// Note: this function makes use of the current contents(as in |=) in SubPWBuf.
-//
-int32 CDAccess_Image::MakeSubPQ(int32 lba, uint8 *SubPWBuf) const
+void CDAccess_Image::GenerateSubQRuns(void)
 {
- uint8 buf[0xC];
- int32 track;
- uint32 lba_relative;
- uint8 pause_or = 0x00;
- bool track_found = false;
+ std::vector<int32> bounds;
+
+ CDUtility_Init();	// For subq_set_position()
 
- for(track = FirstTrack; track < (FirstTrack + NumTracks); track++)
+ //
+ // Everything but the position is constant between these sector boundaries.
+ //
+ for(int32 track = FirstTrack; track < (FirstTrack + NumTracks); track++)
  {
-  if(lba >= (Tracks[track].LBA - Tracks[track].pregap_dv - Tracks[track].pregap) && lba < (Tracks[track].LBA + Tracks[track].sectors + Tracks[track].postgap))
+  const CDRFILE_TRACK_INFO* ct = &Tracks[track];
+  const int32 start = ct->LBA - ct->pregap_dv - ct->pregap;
+  const int32 end = ct->LBA + ct->sectors + ct->postgap;
+
+  bounds.push_back(start);
+  bounds.push_back(end);
+  bounds.push_back(ct->LBA);
+  bounds.push_back(ct->LBA - 150);
+  bounds.push_back(ct->LBA + ct->sectors);
+
+  for(int32 i = 0; i < 100; i++)
   {
-   track_found = true;
-   break;
+   if(ct->index[i] > start && ct->index[i] < end)
+    bounds.push_back(ct->index[i]);
   }
  }
 
- if(!track_found)
-  throw(MDFN_Error(0, _("Could not find track for sector %u!"), lba));
-
- if(lba < Tracks[track].LBA)
-  lba_relative = Tracks[track].LBA - 1 - lba;
- else
-  lba_relative = lba - Tracks[track].LBA;
+ std::sort(bounds.begin(), bounds.end());
+ bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
 
- uint8 adr = 0x1; // Q channel data encodes position
- uint8 control = Tracks[track].subq_control;
+ SubQRuns.clear();
 
- // Handle pause(D7 of interleaved subchannel byte) bit, should be set to 1 when in pregap or postgap.
- if((lba < Tracks[track].LBA) || (lba >= Tracks[track].LBA + Tracks[track].sectors))
+ for(const int32 lba : bounds)
  {
-  //printf("pause_or = 0x80 --- %d\n", lba);
-  pause_or = 0x80;
- }
+  SubQRun run;
+  int32 track;
+  bool track_found = false;
 
- // Handle pregap between audio->data track
- {
-  int32 pg_offset = (int32)lba - Tracks[track].LBA;
+  run.lba = lba;
+  run.track = -1;
+  run.pause_or = 0x00;
+  memset(run.q, 0, sizeof(run.q));
 
-  // If we're more than 2 seconds(150 sectors) from the real "start" of the track/INDEX 01, and the track is a data track,
-  // and the preceding track is an audio track, encode it as audio(by taking the SubQ control field from the preceding track).
-  //
-  // TODO: Look into how we're supposed to handle subq control field in the four combinations of track types(data/audio).
-  //
-  if(pg_offset < -150)
+  for(track = FirstTrack; track < (FirstTrack + NumTracks); track++)
   {
-   if((Tracks[track].subq_control & SUBQ_CTRLF_DATA) && (FirstTrack < track) && !(Tracks[track - 1].subq_control & SUBQ_CTRLF_DATA))
+   if(lba >= (Tracks[track].LBA - Tracks[track].pregap_dv - Tracks[track].pregap) && lba < (Tracks[track].LBA + Tracks[track].sectors + Tracks[track].postgap))
    {
-    //printf("Pregap part 1 audio->data: lba=%d track_lba=%d\n", lba, Tracks[track].LBA);
-    control = Tracks[track - 1].subq_control;
+    track_found = true;
+    break;
    }
   }
- }
 
- memset(buf, 0, 0xC);
- buf[0] = (adr << 0) | (control << 4);
- buf[1] = U8_to_BCD(track);
+  if(track_found)
+  {
+   uint8 adr = 0x1; // Q channel data encodes position
+   uint8 control = Tracks[track].subq_control;
 
- //
- //
- //
- {
-  int index = 0;
+   run.track = track;
 
-  for(int32 i = 0; i < 100; i++)
-  {
-   if(lba >= Tracks[track].index[i])
-    index = i;
+   // Handle pause(D7 of interleaved subchannel byte) bit, should be set to 1 when in pregap or postgap.
+   if((lba < Tracks[track].LBA) || (lba >= Tracks[track].LBA + Tracks[track].sectors))
+    run.pause_or = 0x80;
+
+   // Handle pregap between audio->data track
+   {
+    int32 pg_offset = (int32)lba - Tracks[track].LBA;
+
+    // If we're more than 2 seconds(150 sectors) from the real "start" of the track/INDEX 01, and the track is a data track,
+    // and the preceding track is an audio track, encode it as audio(by taking the SubQ control field from the preceding track).
+    //
+    // TODO: Look into how we're supposed to handle subq control field in the four combinations of track types(data/audio).
+    //
+    if(pg_offset < -150)
+    {
+     if((Tracks[track].subq_control & SUBQ_CTRLF_DATA) && (FirstTrack < track) && !(Tracks[track - 1].subq_control & SUBQ_CTRLF_DATA))
+      control = Tracks[track - 1].subq_control;
+    }
+   }
+
+   run.q[0] = (adr << 0) | (control << 4);
+   run.q[1] = U8_to_BCD(track);
+
+   {
+    int index = 0;
+
+    for(int32 i = 0; i < 100; i++)
+    {
+     if(lba >= Tracks[track].index[i])
+      index = i;
+    }
+    run.q[2] = U8_to_BCD(index);
+   }
+
+   // Track relative and absolute MSF addresses are left zero, to be filled in by MakeSubPQ().
+   subq_generate_checksum(run.q);
   }
-  buf[2] = U8_to_BCD(index);
+
+  SubQRuns.push_back(run);
  }
+}
 
- //
- // Track relative MSF address
- //
- ABA_to_AMSF_BCD(lba_relative, &buf[3], &buf[4], &buf[5]);
+//
+// Note: this function makes use of the current contents(as in |=) in SubPWBuf.
+//
+int32 CDAccess_Image::MakeSubPQ(int32 lba, uint8 *SubPWBuf) const
+{
+ auto run_it = std::upper_bound(SubQRuns.begin(), SubQRuns.end(), lba, [](const int32 a, const SubQRun& b) { return a < b.lba; });
 
- //
- // Zero, the best number.
- //
- buf[6] = 0;
+ if(run_it == SubQRuns.begin() || (run_it - 1)->track < 0)
+  throw(MDFN_Error(0, _("Could not find track for sector %u!"), lba));
 
- //
- // Absolute MSF address
- //
- ABA_to_AMSF_BCD(LBA_to_ABA(lba), &buf[7], &buf[8], &buf[9]);
+ const SubQRun* run = &*(run_it - 1);
+ const int32 track = run->track;
+ uint8 buf[0xC];
+ uint32 lba_relative;
 
- //
- //
- subq_generate_checksum(buf);
+ if(lba < Tracks[track].LBA)
+  lba_relative = Tracks[track].LBA - 1 - lba;
+ else
+  lba_relative = lba - Tracks[track].LBA;
+
+ memcpy(buf, run->q, 0xC);
+ subq_set_position(buf, lba_relative, LBA_to_ABA(lba));
 
  if(!SubQReplaceMap.empty())
  {
@@ -1284,8 +1388,13 @@ int32 CDAccess_Image::MakeSubPQ(int32 lba, uint8 *SubPWBuf) const
   }
  }
 
- for(int i = 0; i < 96; i++)
-  SubPWBuf[i] |= (((buf[i >> 3] >> (7 - (i & 0x7))) & 1) ? 0x40 : 0x00) | pause_or;
+ if(run->pause_or)
+ {
+  for(int i = 0; i < 96; i++)
+   SubPWBuf[i] |= run->pause_or;
+ }
+
+ subq_interleave_or(buf, SubPWBuf);
 
  return track;
 }
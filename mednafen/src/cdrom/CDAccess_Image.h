@@ -8,6 +8,7 @@ namespace Mednafen
 
 class Stream;
 class CDAFReader;
+class CDAFCache;
 
 struct CDRFILE_TRACK_INFO
 {
@@ -33,6 +34,10 @@ struct CDRFILE_TRACK_INFO
 	uint32 LastSamplePos;
 
 	CDAFReader *AReader;
+
+	const uint8* MapData;	// From MapRandom(fp), for binary tracks; NULL if the stream couldn't be mapped.
+	uint64 MapSize;
+	bool MapIsFile;		// MapData is a file mapping, so AdviseWillNeed() applies to it.
 };
 #if 0
 struct Medium_Chunk
@@ -75,6 +80,8 @@ class CDAccess_Image : public CDAccess
 
  virtual void Read_TOC(CDUtility::TOC *toc);
 
+ virtual void HintReadAhead(int32 lba, uint32 count) noexcept;
+
  private:
 
  int32 NumTracks;
@@ -87,11 +94,27 @@ class CDAccess_Image : public CDAccess
 
  std::map<uint32, std::array<uint8, 12>> SubQReplaceMap;
 
+ // Subchannel Q of a run of consecutive sectors that differ only in their position fields(same track, index, and
+ // pregap/postgap state), so that MakeSubPQ() only has to patch in the position.
+ struct SubQRun
+ {
+  int32 lba;	// First sector of the run.
+  int32 track;	// -1 if no track covers the run.
+  uint8 pause_or;
+  uint8 q[0xC];	// Position fields zeroed, with a valid checksum.
+ };
+ std::vector<SubQRun> SubQRuns;	// Sorted by lba; the last run is a terminator, with a track of -1.
+
  std::string base_dir;
 
+ uint32 AudioCacheSize;
+ bool AudioCachePersist;
+ std::unique_ptr<CDAFCache> AudioCache;	// Created when the first compressed audio track is opened.
+
  void ImageOpen(VirtualFS* vfs, const std::string& path, bool image_memcache);
  void LoadSBI(VirtualFS* vfs, const std::string& sbi_path);
  void GenerateTOC(void);
+ void GenerateSubQRuns(void);
  void Cleanup(void);
 
  // MakeSubPQ will OR the simulated P and Q subchannel data into SubPWBuf.
@@ -99,6 +122,7 @@ class CDAccess_Image : public CDAccess
 
  void ParseTOCFileLineInfo(VirtualFS* vfs, CDRFILE_TRACK_INFO *track, const int tracknum, const std::string &filename, const char *binoffset, const char *msfoffset, const char *length, bool image_memcache, std::map<std::string, Stream*> &toc_streamcache);
  uint32 GetSectorCount(CDRFILE_TRACK_INFO *track);
+ void CacheAudioReader(CDRFILE_TRACK_INFO *track);
 };
 
 }
@@ -24,6 +24,7 @@
 #include "CDInterface_MT.h"
 #include "CDInterface_ST.h"
 #include "CDAccess.h"
+#include <mednafen/compress/ZIPReader.h>
 
 namespace Mednafen
 {
@@ -47,6 +48,11 @@ bool CDInterface::NonDeterministic_CheckSectorReady(int32 lba)
  return true;
 }
 
+void CDInterface::GetCacheStats(CacheStats* stats)
+{
+ memset(stats, 0, sizeof(*stats));
+}
+
 uint8 CDInterface::ReadSectors(uint8* buf, int32 lba, uint32 sector_count)
 {
  uint8 ret = 0;
@@ -231,12 +237,13 @@ CDInterface* CDInterface::Open(VirtualFS* vfs, const std::string& path, bool ima
 {
  //
  // Don't allow a custom VirtualFS implementation unless CD image memory caching is enabled, due to thread
- // safety and vfs object persistence/lifetime issues.
+ // safety and vfs object persistence/lifetime issues.  Files opened from a ZIPReader keep the archive
+ // open on their own, and are only ever used by the CD read thread once the image is loaded.
  //
  // TODO: Maybe add is_nonpersistent() and is_mtsafe() sort of functions to VirtualFS instead?
  // TODO: More general error message when 'vfs' isn't an object of a class derived from ArchiveReader.
  //
- if(vfs != &NVFS && !image_memcache)
+ if(vfs != &NVFS && !image_memcache && !dynamic_cast<ZIPReader*>(vfs))
   throw MDFN_Error(0, _("CD image memory caching must be enabled to allow loading a CD image from an archive."));
  //
  //
@@ -246,7 +253,7 @@ CDInterface* CDInterface::Open(VirtualFS* vfs, const std::string& path, bool ima
  if(image_memcache)
   return new CDInterface_ST(std::move(cda));
  else
-  return new CDInterface_MT(std::move(cda), affinity);
+  return new CDInterface_MT(std::move(cda), affinity, MDFN_GetSettingUI("cd.cache_size"));
 }
 
 }
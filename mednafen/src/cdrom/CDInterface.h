@@ -81,6 +81,20 @@ class CDInterface
  // For experimental and special use cases.
  virtual bool NonDeterministic_CheckSectorReady(int32 lba);
 
+ //
+ // Sector cache statistics, for debugging; all zero if the implementation
+ // doesn't cache.
+ //
+ struct CacheStats
+ {
+  uint64 hits;		// ReadRawSector() calls satisfied without waiting on the disc image.
+  uint64 misses;
+  uint64 wait_us;	// Total time spent waiting on misses, in microseconds.
+  uint64 blocks;	// Misses that had the emulation thread sleep until the read thread caught up.
+ };
+
+ virtual void GetCacheStats(CacheStats* stats);
+
  INLINE void ReadTOC(CDUtility::TOC* read_target)
  {
   *read_target = disc_toc;
@@ -20,118 +20,222 @@
 */
 
 #include <mednafen/mednafen.h>
+#include <mednafen/Time.h>
 #include "CDInterface_MT.h"
 
+#include <thread>
+
 namespace Mednafen
 {
 
 using namespace CDUtility;
 
-CDInterface_MT::CDInterface_Message::CDInterface_Message()
+CDInterface_MT::CDInterface_Waiter::CDInterface_Waiter() : sleeping(false), sem(MThreading::Sem_Create())
 {
- message = 0;
-
- memset(args, 0, sizeof(args));
+ // Spinning only helps if the other thread can run at the same time.
+ spin_count = (std::thread::hardware_concurrency() > 1) ? 2048 : 0;
 }
 
-CDInterface_MT::CDInterface_Message::CDInterface_Message(unsigned int message_, uint32 arg0, uint32 arg1, uint32 arg2, uint32 arg3)
+CDInterface_MT::CDInterface_Waiter::~CDInterface_Waiter()
 {
- message = message_;
- args[0] = arg0;
- args[1] = arg1;
- args[2] = arg2;
- args[3] = arg3;
+ MThreading::Sem_Destroy(sem);
 }
 
-CDInterface_MT::CDInterface_Message::CDInterface_Message(unsigned int message_, const std::string &str)
+//
+// The fences pair up with the one in Wake(), so that either the waiter sees the condition become true, or the waker
+// sees the waiter's "sleeping" flag(or both, in which case there'll be an extra post, and a spurious wakeup later).
+//
+template<typename T>
+INLINE bool CDInterface_MT::CDInterface_Waiter::Wait(T ready)
 {
- message = message_;
- str_message = str;
+ bool slept = false;
+
+ for(unsigned i = 0; i < spin_count; i++)
+ {
+  if(ready())
+   return false;
+ }
+
+ for(;;)
+ {
+  sleeping.store(true, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  if(ready())
+  {
+   sleeping.store(false, std::memory_order_relaxed);
+   break;
+  }
+
+  MThreading::Sem_Wait(sem);
+  slept = true;
+ }
+
+ return slept;
 }
 
-CDInterface_MT::CDInterface_Message::~CDInterface_Message()
+void CDInterface_MT::CDInterface_Waiter::Wake(void)
 {
+ std::atomic_thread_fence(std::memory_order_seq_cst);
 
+ if(sleeping.exchange(false, std::memory_order_relaxed))
+  MThreading::Sem_Post(sem);
 }
 
 CDInterface_MT::CDInterface_Queue::CDInterface_Queue()
 {
- ze_mutex = MThreading::Mutex_Create();
- ze_cond = MThreading::Cond_Create();
+
 }
 
 CDInterface_MT::CDInterface_Queue::~CDInterface_Queue()
 {
- MThreading::Mutex_Destroy(ze_mutex);
- MThreading::Cond_Destroy(ze_cond);
+
 }
 
-// Returns false if message not read, true if it was read.  Will always return true if "blocking" is set.
-// Will throw MDFN_Error if the read message code is CDInterface_MSG_FATAL_ERROR
 bool CDInterface_MT::CDInterface_Queue::Read(CDInterface_Message *message, bool blocking)
 {
- bool ret = true;
-
- //
- //
- //
- MThreading::Mutex_Lock(ze_mutex);
-
- if(blocking)
+ if(!ze_fifo.CanRead())
  {
-  while(ze_queue.size() == 0)	// while, not just if.
-  {
-   MThreading::Cond_Wait(ze_cond, ze_mutex);
-  }
+  if(!blocking)
+   return false;
+
+  ze_readable.Wait([this]() { return ze_fifo.CanRead() != 0; });
  }
 
- if(ze_queue.size() == 0)
-  ret = false;
- else
- {
-  *message = ze_queue.front();
-  ze_queue.pop();
- }  
+ *message = ze_fifo.Read();
+ ze_writable.Wake();
 
- MThreading::Mutex_Unlock(ze_mutex);
- //
- //
- //
+ return true;
+}
 
- if(ret && message->message == CDInterface_MSG_FATAL_ERROR)
-  throw MDFN_Error(0, "%s", message->str_message.c_str());
+void CDInterface_MT::CDInterface_Queue::Write(const CDInterface_Message &message)
+{
+ if(!ze_fifo.CanWrite())
+  ze_writable.Wait([this]() { return ze_fifo.CanWrite() != 0; });
 
- return ret;
+ ze_fifo.Write(message);
+ ze_readable.Wake();
 }
 
-void CDInterface_MT::CDInterface_Queue::Write(const CDInterface_Message &message)
+static int ReadThreadStart_C(void* arg)
 {
- MThreading::Mutex_Lock(ze_mutex);
+ return ((CDInterface_MT*)arg)->ReadThreadStart();
+}
 
- try
+void CDInterface_MT::Cache_Touch(const uint32 index)
+{
+ CacheEntry* const head = &CacheEntries[CacheSize];
+ CacheEntry* const e = &CacheEntries[index];
+
+ CacheEntries[e->prev].next = e->next;
+ CacheEntries[e->next].prev = e->prev;
+
+ e->prev = CacheSize;
+ e->next = head->next;
+ CacheEntries[head->next].prev = index;
+ head->next = index;
+}
+
+//
+// Failed reads are only reported once; the entry is then dropped, so that the next read of the sector tries again.
+//
+bool CDInterface_MT::Cache_Lookup(const int32 lba, uint8* buf, bool* error)
+{
+ auto it = CacheMap.find(lba);
+
+ if(it == CacheMap.end())
+  return false;
+
+ const uint32 index = it->second;
+ CacheEntry* const e = &CacheEntries[index];
+
+ memcpy(buf, e->data, 2352 + 96);
+ *error = e->error;
+
+ if(e->error)
  {
-  ze_queue.push(message);
+  CacheEntry* const head = &CacheEntries[CacheSize];
+
+  CacheMap.erase(it);
+  e->lba = CacheLBA_Invalid;
+  e->error = false;
+
+  // Move to the least recently used end, to be reused first.
+  CacheEntries[e->prev].next = e->next;
+  CacheEntries[e->next].prev = e->prev;
+
+  e->next = CacheSize;
+  e->prev = head->prev;
+  CacheEntries[head->prev].next = index;
+  head->prev = index;
  }
- catch(...)
+ else
+  Cache_Touch(index);
+
+ return true;
+}
+
+bool CDInterface_MT::Cache_Contains(const int32 lba)
+{
+ auto it = CacheMap.find(lba);
+
+ if(it == CacheMap.end())
+  return false;
+
+ Cache_Touch(it->second);
+
+ return true;
+}
+
+void CDInterface_MT::Cache_Insert(const int32 lba, const uint8* buf, const bool error)
+{
+ auto it = CacheMap.find(lba);
+ uint32 index;
+
+ if(it != CacheMap.end())
+  index = it->second;
+ else
  {
-  fprintf(stderr, "\n\nCDInterface_Message queue push failed!!!  (We now return you to your regularly unscheduled lockup)\n\n");
- }
+  index = CacheEntries[CacheSize].prev;	// Least recently used.
+
+  if(CacheEntries[index].lba != CacheLBA_Invalid)
+   CacheMap.erase(CacheEntries[index].lba);
 
- MThreading::Cond_Signal(ze_cond);	// Signal while the mutex is held to prevent icky race conditions.
+  CacheEntries[index].lba = lba;
+  CacheMap[lba] = index;
+ }
 
- MThreading::Mutex_Unlock(ze_mutex);
+ memcpy(CacheEntries[index].data, buf, 2352 + 96);
+ CacheEntries[index].error = error;
+ Cache_Touch(index);
 }
 
-static int ReadThreadStart_C(void* arg)
+bool CDInterface_MT::IsAudioLBA(const int32 lba) const
 {
- return ((CDInterface_MT*)arg)->ReadThreadStart();
+ const int track = disc_toc.FindTrackByLBA(std::max<int32>(0, lba));
+
+ return track && !(disc_toc.tracks[track].control & SUBQ_CTRLF_DATA);
 }
 
+//
+// Read-ahead policies.  CD-DA is streamed at a fixed rate, and an underrun is audible, so read further ahead for it,
+// and ramp up faster.
+//
+struct ReadAheadPolicy
+{
+ int max_ra;
+ int initial_ra;
+ int speedmult_ra;
+};
+
+static constexpr ReadAheadPolicy RAPolicy_Data = { 16, 1, 2 };
+static constexpr ReadAheadPolicy RAPolicy_Audio = { 48, 4, 4 };
+
 int CDInterface_MT::ReadThreadStart()
 {
  bool Running = true;
+ int32 hint_lba = 0, hint_end = 0;	// Range last passed to HintReadAhead().
 
- SBWritePos = 0;
  ra_lba = 0;
  ra_count = 0;
  last_read_lba = LBA_Read_Maximum + 1;
@@ -144,20 +248,15 @@ int CDInterface_MT::ReadThreadStart()
   {
    throw(MDFN_Error(0, _("TOC first(%d)/last(%d) track numbers bad."), disc_toc.first_track, disc_toc.last_track));
   }
-
-  SBWritePos = 0;
-  ra_lba = 0;
-  ra_count = 0;
-  last_read_lba = LBA_Read_Maximum + 1;
-  memset(SectorBuffers, 0, SBSize * sizeof(CDInterface_Sector_Buffer));
  }
  catch(std::exception &e)
  {
-  EmuThreadQueue.Write(CDInterface_Message(CDInterface_MSG_FATAL_ERROR, std::string(e.what())));
+  ReadThreadError = e.what();
+  EmuThreadQueue.Write({ CDInterface_MSG_FATAL_ERROR, { 0 } });
   return 0;
  }
 
- EmuThreadQueue.Write(CDInterface_Message(CDInterface_MSG_DONE));
+ EmuThreadQueue.Write({ CDInterface_MSG_DONE, { 0 } });
 
  while(Running)
  {
@@ -172,30 +271,57 @@ int CDInterface_MT::ReadThreadStart()
     Running = false;
    else if(msg.message == CDInterface_MSG_READ_SECTOR)
    {
-    static const int max_ra = 16;
-    static const int initial_ra = 1;
-    static const int speedmult_ra = 2;
-    //
     const int32 new_lba = msg.args[0];
+    const ReadAheadPolicy& rap = IsAudioLBA(new_lba) ? RAPolicy_Audio : RAPolicy_Data;
 
-    static_assert((unsigned int)max_ra < (SBSize / 4), "Max readahead too large.");
+    static_assert(RAPolicy_Data.max_ra < (CacheMinSectors / 4) && RAPolicy_Audio.max_ra < (CacheMinSectors / 4), "Max readahead too large.");
 
     if(new_lba == (last_read_lba + 1))
     {
      int how_far_ahead = ra_lba - new_lba;
 
-     if(how_far_ahead <= max_ra)
-      ra_count = std::min(speedmult_ra, 1 + max_ra - how_far_ahead);
+     if(how_far_ahead <= rap.max_ra)
+      ra_count = std::min(rap.speedmult_ra, 1 + rap.max_ra - how_far_ahead);
      else
       ra_count++;
     }
     else if(new_lba != last_read_lba)
     {
      ra_lba = new_lba;
-     ra_count = initial_ra;
+     ra_count = rap.initial_ra;
+    }
+
+    //
+    // A sector the read-ahead has already passed may have been dropped from the cache after a failed read(see
+    // Cache_Lookup()), and so needs reading again.
+    //
+    if(ra_lba != new_lba)
+    {
+     bool cached;
+
+     MThreading::Mutex_Lock(SBMutex);
+     cached = Cache_Contains(new_lba);
+     MThreading::Mutex_Unlock(SBMutex);
+
+     if(!cached)
+     {
+      ra_lba = new_lba;
+      ra_count = std::max<int32>(ra_count, rap.initial_ra);
+     }
     }
 
     last_read_lba = new_lba;
+
+    //
+    // Let the disc image backend prefetch well ahead of the read-ahead(e.g. for memory-mapped images, so the
+    // read thread doesn't stall on page faults), rehinting when the reads get close to the end of the hinted range.
+    //
+    if(ra_lba < hint_lba || (ra_lba + rap.max_ra) > hint_end)
+    {
+     hint_lba = ra_lba;
+     hint_end = ra_lba + rap.max_ra * 4;
+     disc_cdaccess->HintReadAhead(hint_lba, hint_end - hint_lba);
+    }
    }
   }
 
@@ -210,35 +336,43 @@ int CDInterface_MT::ReadThreadStart()
 
   if(ra_count)
   {
-   uint8 tmpbuf[2352 + 96];
-   bool error_condition = false;
+   bool cached;
 
-   try
-   {
-    disc_cdaccess->Read_Raw_Sector(tmpbuf, ra_lba);
-   }
-   catch(std::exception &e)
-   {
-    MDFN_Notify(MDFN_NOTICE_ERROR, _("Sector %u read error: %s"), ra_lba, e.what());
-    memset(tmpbuf, 0, sizeof(tmpbuf));
-    error_condition = true;
-   }
-   
    //
+   // Sectors still in the cache from earlier(e.g. when a game seeks back and forth between a few areas of the disc)
+   // don't need to be read again.
    //
    MThreading::Mutex_Lock(SBMutex);
+   cached = Cache_Contains(ra_lba);
+   MThreading::Mutex_Unlock(SBMutex);
 
-   SectorBuffers[SBWritePos].lba = ra_lba;
-   memcpy(SectorBuffers[SBWritePos].data, tmpbuf, 2352 + 96);
-   SectorBuffers[SBWritePos].valid = true;
-   SectorBuffers[SBWritePos].error = error_condition;
-   SBWritePos = (SBWritePos + 1) % SBSize;
+   if(!cached)
+   {
+    uint8 tmpbuf[2352 + 96];
+    bool error_condition = false;
 
-   MThreading::Cond_Signal(SBCond);
+    try
+    {
+     disc_cdaccess->Read_Raw_Sector(tmpbuf, ra_lba);
+    }
+    catch(std::exception &e)
+    {
+     MDFN_Notify(MDFN_NOTICE_ERROR, _("Sector %u read error: %s"), ra_lba, e.what());
+     memset(tmpbuf, 0, sizeof(tmpbuf));
+     error_condition = true;
+    }
+   
+    //
+    //
+    MThreading::Mutex_Lock(SBMutex);
+    Cache_Insert(ra_lba, tmpbuf, error_condition);
+    MThreading::Mutex_Unlock(SBMutex);
 
-   MThreading::Mutex_Unlock(SBMutex);
-   //
-   //
+    CacheInsertCounter.fetch_add(1, std::memory_order_release);
+    SectorWaiter.Wake();
+    //
+    //
+   }
 
    ra_lba++;
    ra_count--;
@@ -256,7 +390,7 @@ void CDInterface_MT::Cleanup(void)
  {
   try
   {
-   ReadThreadQueue.Write(CDInterface_Message(CDInterface_MSG_DIEDIEDIE));
+   ReadThreadQueue.Write({ CDInterface_MSG_DIEDIEDIE, { 0 } });
   }
   catch(std::exception &e)
   {
@@ -278,28 +412,37 @@ void CDInterface_MT::Cleanup(void)
    MThreading::Mutex_Destroy(SBMutex);
    SBMutex = NULL;
   }
-
-  if(SBCond)
-  {
-   MThreading::Cond_Destroy(SBCond);
-   SBCond = NULL;
-  }
  }
 }
 
-CDInterface_MT::CDInterface_MT(std::unique_ptr<CDAccess> cda, const uint64 affinity) : disc_cdaccess(std::move(cda)), CDReadThread(NULL), SBMutex(NULL), SBCond(NULL)
+CDInterface_MT::CDInterface_MT(std::unique_ptr<CDAccess> cda, const uint64 affinity, const uint32 cache_size_mb) : disc_cdaccess(std::move(cda)), CDReadThread(NULL), SBMutex(NULL), CacheInsertCounter(0)
 {
  try
  {
   CDInterface_Message msg;
 
+  CacheSize = std::max<uint64>(CacheMinSectors, ((uint64)cache_size_mb << 20) / sizeof(CacheEntry));
+  CacheEntries.reset(new CacheEntry[CacheSize + 1]);
+  CacheMap.reserve(CacheSize);
+
+  for(uint32 i = 0; i <= CacheSize; i++)
+  {
+   CacheEntries[i].lba = CacheLBA_Invalid;
+   CacheEntries[i].error = false;
+   CacheEntries[i].prev = i ? (i - 1) : CacheSize;
+   CacheEntries[i].next = (i < CacheSize) ? (i + 1) : 0;
+  }
+  memset(&Stats, 0, sizeof(Stats));
+
   SBMutex = MThreading::Mutex_Create();
-  SBCond = MThreading::Cond_Create();
 
   UnrecoverableError = false;
 
   CDReadThread = MThreading::Thread_Create(ReadThreadStart_C, this, "MDFN CD Read");
   EmuThreadQueue.Read(&msg);
+
+  if(msg.message == CDInterface_MSG_FATAL_ERROR)
+   throw MDFN_Error(0, "%s", ReadThreadError.c_str());
   //
   //
   if(affinity)
@@ -321,7 +464,6 @@ CDInterface_MT::~CDInterface_MT()
 
 bool CDInterface_MT::ReadRawSector(uint8 *buf, int32 lba)
 {
- bool found = false;
  bool error_condition = false;
 
  if(UnrecoverableError)
@@ -338,37 +480,49 @@ bool CDInterface_MT::ReadRawSector(uint8 *buf, int32 lba)
  }
  //fprintf(stderr, "%d\n", ra_lba - lba);
 
- ReadThreadQueue.Write(CDInterface_Message(CDInterface_MSG_READ_SECTOR, lba));
+ ReadThreadQueue.Write({ CDInterface_MSG_READ_SECTOR, { (uint32)lba } });
 
  //
+ // Only look in the cache again once the read thread has added something to it.
  //
- //
- MThreading::Mutex_Lock(SBMutex);
+ uint32 insert_counter = CacheInsertCounter.load(std::memory_order_acquire);
+ auto lookup = [&]()
+ {
+  bool found;
+
+  MThreading::Mutex_Lock(SBMutex);
+  found = Cache_Lookup(lba, buf, &error_condition);
+  MThreading::Mutex_Unlock(SBMutex);
+
+  return found;
+ };
 
- do
+ if(lookup())
+  Stats.hits++;
+ else
  {
-  for(int i = 0; i < SBSize; i++)
-  {
-   if(SectorBuffers[i].valid && SectorBuffers[i].lba == lba)
-   {
-    error_condition = SectorBuffers[i].error;
-    memcpy(buf, SectorBuffers[i].data, 2352 + 96);
-    found = true;
-   }
-  }
+  const int64 wait_start = Time::MonoUS();
+
+  Stats.misses++;
+
+  if(SectorWaiter.Wait([&]()
+	{
+	 const uint32 ic = CacheInsertCounter.load(std::memory_order_acquire);
+
+	 if(ic == insert_counter)
+	  return false;
+
+	 insert_counter = ic;
 
-  if(!found)
+	 return lookup();
+	}))
   {
-   //int32 swt = MDFND_GetTime();
-   MThreading::Cond_Wait(SBCond, SBMutex);
-   //printf("SB Waited: %d\n", MDFND_GetTime() - swt);
+   Stats.blocks++;
   }
- } while(!found);
 
- MThreading::Mutex_Unlock(SBMutex);
- //
- //
- //
+  Stats.wait_us += Time::MonoUS() - wait_start;
+ }
+
  return !error_condition;
 }
 
@@ -390,7 +544,7 @@ bool CDInterface_MT::ReadRawSectorPWOnly(uint8* pwbuf, int32 lba, bool hint_full
  if(disc_cdaccess->Fast_Read_Raw_PW_TSRE(pwbuf, lba))
  {
   if(hint_fullread)
-   ReadThreadQueue.Write(CDInterface_Message(CDInterface_MSG_READ_SECTOR, lba));
+   ReadThreadQueue.Write({ CDInterface_MSG_READ_SECTOR, { (uint32)lba } });
 
   return true;
  }
@@ -406,12 +560,17 @@ bool CDInterface_MT::ReadRawSectorPWOnly(uint8* pwbuf, int32 lba, bool hint_full
  }
 }
 
+void CDInterface_MT::GetCacheStats(CacheStats* stats)
+{
+ *stats = Stats;
+}
+
 void CDInterface_MT::HintReadSector(int32 lba)
 {
  if(UnrecoverableError)
   return;
 
- ReadThreadQueue.Write(CDInterface_Message(CDInterface_MSG_READ_SECTOR, lba));
+ ReadThreadQueue.Write({ CDInterface_MSG_READ_SECTOR, { (uint32)lba } });
 }
 
 }
@@ -25,7 +25,9 @@
 #include <mednafen/cdrom/CDInterface.h>
 #include <mednafen/cdrom/CDAccess.h>
 #include <mednafen/MThreading.h>
-#include <queue>
+#include <mednafen/AtomicFIFO.h>
+#include <atomic>
+#include <unordered_map>
 
 namespace Mednafen
 {
@@ -35,12 +37,13 @@ class CDInterface_MT : public CDInterface
 {
  public:
 
- CDInterface_MT(std::unique_ptr<CDAccess> cda, const uint64 affinity) MDFN_COLD;
+ CDInterface_MT(std::unique_ptr<CDAccess> cda, const uint64 affinity, const uint32 cache_size_mb) MDFN_COLD;
  virtual ~CDInterface_MT() MDFN_COLD;
 
  virtual void HintReadSector(int32 lba) override;
  virtual bool ReadRawSector(uint8 *buf, int32 lba) override;
  virtual bool ReadRawSectorPWOnly(uint8* pwbuf, int32 lba, bool hint_fullread) override;
+ virtual void GetCacheStats(CacheStats* stats) override;
 
  // FIXME: Semi-private:
  int ReadThreadStart(void);
@@ -57,8 +60,7 @@ class CDInterface_MT : public CDInterface
  {
   // Status/Error messages
   CDInterface_MSG_DONE = 0,		// Read -> emu. args: No args.
-  CDInterface_MSG_INFO,			// Read -> emu. args: str_message
-  CDInterface_MSG_FATAL_ERROR,		// Read -> emu. args: *TODO ARGS*
+  CDInterface_MSG_FATAL_ERROR,		// Read -> emu. args: No args; the message is in ReadThreadError.
 
   //
   // Command messages.
@@ -70,21 +72,39 @@ class CDInterface_MT : public CDInterface
 				*/
  };
 
- class CDInterface_Message
+ struct CDInterface_Message
+ {
+  unsigned int message;
+  uint32 args[1];
+ };
+
+ //
+ // Waits for a condition that another thread makes true, spinning briefly before going to sleep; at most one thread
+ // may wait on a given Waiter at once.
+ //
+ class CDInterface_Waiter
  {
   public:
 
-  CDInterface_Message();
-  CDInterface_Message(unsigned int message_, uint32 arg0 = 0, uint32 arg1 = 0, uint32 arg2 = 0, uint32 arg3 = 0);
-  CDInterface_Message(unsigned int message_, const std::string &str);
-  ~CDInterface_Message();
+  CDInterface_Waiter();
+  ~CDInterface_Waiter();
 
-  unsigned int message;
-  uint32 args[4];
-  void *parg;
-  std::string str_message;
+  // Returns true if it had to sleep.
+  template<typename T>
+  bool Wait(T ready);
+
+  // To be called after making the waited-for condition true.
+  void Wake(void);
+
+  private:
+  std::atomic_bool sleeping;
+  MThreading::Sem* sem;
+  unsigned spin_count;
  };
 
+ //
+ // Single-producer, single-consumer message queue.
+ //
  class CDInterface_Queue
  {
   public:
@@ -92,14 +112,15 @@ class CDInterface_MT : public CDInterface
   CDInterface_Queue();
   ~CDInterface_Queue();
 
+  // Returns false if message not read, true if it was read.  Will always return true if "blocking" is set.
   bool Read(CDInterface_Message *message, bool blocking = true);
 
   void Write(const CDInterface_Message &message);
 
   private:
-  std::queue<CDInterface_Message> ze_queue;
-  MThreading::Mutex *ze_mutex;
-  MThreading::Cond *ze_cond;
+  AtomicFIFO<CDInterface_Message, 256> ze_fifo;
+  CDInterface_Waiter ze_readable;
+  CDInterface_Waiter ze_writable;
  };
 
  // Queue for messages to the read thread.
@@ -108,19 +129,38 @@ class CDInterface_MT : public CDInterface
  // Queue for messages to the emu thread.
  CDInterface_Queue EmuThreadQueue;
 
- enum { SBSize = 256 };
- struct CDInterface_Sector_Buffer
+ std::string ReadThreadError;
+
+ //
+ // LRU cache of sectors read by the read thread, keyed by LBA; protected by SBMutex.  CacheInsertCounter is incremented,
+ // and SectorWaiter woken, after each sector is added.  Entry [CacheSize] is the
+ // list head, with CacheEntries[CacheSize].next being the most recently used entry.
+ //
+ enum { CacheMinSectors = 256 };
+ struct CacheEntry
  {
-  bool valid;
+  int32 lba;	// CacheLBA_Invalid if the entry is unused.
   bool error;
-  int32 lba;
+  uint32 prev;
+  uint32 next;
   uint8 data[2352 + 96];
- } SectorBuffers[SBSize];
+ };
+ enum : int32 { CacheLBA_Invalid = INT32_MIN };
+
+ std::unique_ptr<CacheEntry[]> CacheEntries;
+ uint32 CacheSize;
+ std::unordered_map<int32, uint32> CacheMap;
+
+ CacheStats Stats;	// Emu-thread-only.
+
+ void Cache_Touch(const uint32 index);
+ bool Cache_Lookup(const int32 lba, uint8* buf, bool* error);
+ bool Cache_Contains(const int32 lba);
+ void Cache_Insert(const int32 lba, const uint8* buf, const bool error);
 
- uint32 SBWritePos;
- 
  MThreading::Mutex* SBMutex;
- MThreading::Cond* SBCond;
+ std::atomic<uint32> CacheInsertCounter;
+ CDInterface_Waiter SectorWaiter;
 
  //
  // Read-thread-only:
@@ -128,6 +168,8 @@ class CDInterface_MT : public CDInterface
  int32 ra_lba;
  int32 ra_count;
  int32 last_read_lba;
+
+ bool IsAudioLBA(const int32 lba) const;
 };
 
 }
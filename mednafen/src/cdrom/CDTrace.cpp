@@ -0,0 +1,285 @@
+/******************************************************************************/
+/* Mednafen - Multi-system Emulator                                           */
+/******************************************************************************/
+/* CDTrace.cpp - Emulated CD drive activity trace
+**  Copyright (C) 2021 Mednafen Team
+**
+** This program is free software; you can redistribute it and/or
+** modify it under the terms of the GNU General Public License
+** as published by the Free Software Foundation; either version 2
+** of the License, or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <mednafen/mednafen.h>
+#include <mednafen/FileStream.h>
+#include "CDTrace.h"
+
+namespace Mednafen
+{
+
+namespace CDTrace
+{
+
+bool Active = false;
+int64 Now = 0;
+
+static bool Suspended = false;
+
+enum : size_t { RecordSize = 24 };
+enum : size_t { BufferRecords = 65536 / RecordSize };
+
+static std::unique_ptr<FileStream> fp;
+static std::unique_ptr<uint8[]> buffer;
+static size_t buffer_count;
+static uint32 ClockRate;
+
+static struct
+{
+ uint64 commands[256];
+ const char* command_names[256];
+
+ uint64 reads;
+ uint64 read_sectors;
+ uint64 read_clocks;		// From the READ command to the last sector.
+ uint64 read_seek_clocks;	// Part of read_clocks that was modelled seek delay, for completed reads.
+
+ uint64 seeks[2];		// Data, CD-DA.
+ uint64 seek_distance[2];
+ uint64 seek_clocks;		// Data only; CD-DA seeks aren't modelled.
+ uint64 max_seek_clocks;
+
+ uint64 stalls[2];
+ uint64 stall_us[2];
+
+ uint64 adpcm_underruns;
+
+ uint64 discontinuities;
+} Stats;
+
+static struct
+{
+ bool pending;
+ int64 start_ts;
+ int32 lba;
+ uint32 count;
+ uint64 seek_clocks;
+} CurRead;
+
+static void Flush(void)
+{
+ if(!buffer_count)
+  return;
+
+ try
+ {
+  fp->write(buffer.get(), buffer_count * RecordSize);
+ }
+ catch(std::exception& e)
+ {
+  MDFN_Notify(MDFN_NOTICE_ERROR, _("Error writing CD trace: %s"), e.what());
+  Active = false;
+ }
+ buffer_count = 0;
+}
+
+static void Record(const uint8 type, const uint8 a, const uint32 b, const uint32 c, const uint32 d)
+{
+ uint8* r = &buffer[buffer_count * RecordSize];
+
+ MDFN_en64lsb(&r[0x00], Now);
+ r[0x08] = type;
+ r[0x09] = a;
+ MDFN_en16lsb(&r[0x0A], 0);
+ MDFN_en32lsb(&r[0x0C], b);
+ MDFN_en32lsb(&r[0x10], c);
+ MDFN_en32lsb(&r[0x14], d);
+
+ if(++buffer_count == BufferRecords)
+  Flush();
+}
+
+void Start(const std::string& path, const uint8 system, const uint32 clock_rate)
+{
+ uint8 header[16];
+
+ fp.reset(new FileStream(path, FileStream::MODE_WRITE));
+ buffer.reset(new uint8[BufferRecords * RecordSize]);
+ buffer_count = 0;
+ ClockRate = clock_rate;
+
+ memcpy(&header[0x00], "MDFNCDTR", 8);
+ MDFN_en16lsb(&header[0x08], 2);
+ header[0x0A] = system;
+ header[0x0B] = 0;
+ MDFN_en32lsb(&header[0x0C], clock_rate);
+ fp->write(header, sizeof(header));
+
+ memset(&Stats, 0, sizeof(Stats));
+ memset(&CurRead, 0, sizeof(CurRead));
+ Now = 0;
+ Active = true;
+ Suspended = false;
+
+ MDFN_printf(_("Tracing CD drive activity to \"%s\".\n"), path.c_str());
+}
+
+static double ClocksToMS(const uint64 clocks)
+{
+ return clocks * 1000.0 / ClockRate;
+}
+
+static void Report(void)
+{
+ MDFN_printf(_("CD trace summary:\n"));
+ MDFN_AutoIndent aind(1);
+
+ MDFN_printf(_("Commands:\n"));
+ {
+  MDFN_AutoIndent aindc(1);
+
+  for(unsigned op = 0; op < 256; op++)
+  {
+   if(Stats.commands[op])
+    MDFN_printf(_("0x%02x %-36s %10llu\n"), op, Stats.command_names[op] ? Stats.command_names[op] : _("(invalid)"), (unsigned long long)Stats.commands[op]);
+  }
+ }
+
+ MDFN_printf(_("Data reads: %llu, %llu sectors, %.3f ms total\n"), (unsigned long long)Stats.reads, (unsigned long long)Stats.read_sectors, ClocksToMS(Stats.read_clocks));
+ MDFN_printf(_("Data seeks: %llu, average distance %.1f sectors, %.3f ms modelled total, %.3f ms max\n"), (unsigned long long)Stats.seeks[0], Stats.seeks[0] ? (double)Stats.seek_distance[0] / Stats.seeks[0] : 0.0, ClocksToMS(Stats.seek_clocks), ClocksToMS(Stats.max_seek_clocks));
+ MDFN_printf(_("Time in completed reads spent seeking: %.2f%%\n"), Stats.read_clocks ? (100.0 * Stats.read_seek_clocks / Stats.read_clocks) : 0.0);
+ MDFN_printf(_("CD-DA seeks: %llu, average distance %.1f sectors\n"), (unsigned long long)Stats.seeks[1], Stats.seeks[1] ? (double)Stats.seek_distance[1] / Stats.seeks[1] : 0.0);
+ MDFN_printf(_("Data stalls: %llu, %.3f ms\n"), (unsigned long long)Stats.stalls[0], Stats.stall_us[0] / 1000.0);
+ MDFN_printf(_("CD-DA stalls: %llu, %.3f ms\n"), (unsigned long long)Stats.stalls[1], Stats.stall_us[1] / 1000.0);
+ MDFN_printf(_("ADPCM underruns: %llu\n"), (unsigned long long)Stats.adpcm_underruns);
+ MDFN_printf(_("Discontinuities: %llu\n"), (unsigned long long)Stats.discontinuities);
+}
+
+void Stop(void)
+{
+ if(!fp)
+  return;
+
+ if(Active || Suspended)
+  Flush();
+
+ Active = false;
+ Suspended = false;
+
+ try
+ {
+  fp->close();
+ }
+ catch(std::exception& e)
+ {
+  MDFN_Notify(MDFN_NOTICE_ERROR, _("Error writing CD trace: %s"), e.what());
+ }
+ fp.reset();
+ buffer.reset();
+
+ Report();
+}
+
+void Suspend(const bool suspend)
+{
+ if(suspend)
+ {
+  Suspended = Active;
+  Active = false;
+ }
+ else if(Suspended)
+ {
+  Suspended = false;
+  Active = true;
+ }
+}
+
+void Discontinuity(const int64 new_now)
+{
+ const int64 prev_now = Now;
+
+ Stats.discontinuities++;
+ CurRead.pending = false;
+
+ Now = new_now;
+ Record(EVENT_DISCONTINUITY, 0, (uint32)prev_now, (uint32)((uint64)prev_now >> 32), 0);
+}
+
+void Command(const uint8* cdb, const char* name)
+{
+ Stats.commands[cdb[0]]++;
+ Stats.command_names[cdb[0]] = name;
+
+ Record(EVENT_COMMAND, cdb[0], MDFN_de32msb(&cdb[1]), MDFN_de32msb(&cdb[5]), MDFN_de32msb(&cdb[9]));
+}
+
+void Seek(const int32 from_lba, const int32 to_lba, const int64 delay, const bool audio)
+{
+ const uint32 distance = abs(to_lba - from_lba);
+ const uint64 clocks = std::max<int64>(0, delay);
+
+ Stats.seeks[audio]++;
+ Stats.seek_distance[audio] += distance;
+
+ if(!audio)
+ {
+  Stats.seek_clocks += clocks;
+  Stats.max_seek_clocks = std::max<uint64>(Stats.max_seek_clocks, clocks);
+  CurRead.seek_clocks = clocks;
+ }
+
+ Record(EVENT_SEEK, audio, from_lba, to_lba, std::min<uint64>(0xFFFFFFFF, clocks));
+}
+
+void ReadStart(const int32 lba, const uint32 count)
+{
+ Stats.reads++;
+
+ CurRead.pending = true;
+ CurRead.start_ts = Now;
+ CurRead.lba = lba;
+ CurRead.count = count;
+}
+
+void ReadDone(void)
+{
+ if(!CurRead.pending)
+  return;
+
+ const uint64 clocks = Now - CurRead.start_ts;
+
+ Stats.read_sectors += CurRead.count;
+ Stats.read_clocks += clocks;
+ Stats.read_seek_clocks += std::min<uint64>(clocks, CurRead.seek_clocks);
+
+ Record(EVENT_READ_DONE, 0, CurRead.lba, CurRead.count, std::min<uint64>(0xFFFFFFFF, clocks));
+
+ CurRead.pending = false;
+}
+
+void Stall(const int32 lba, const uint64 wait_us, const bool audio)
+{
+ Stats.stalls[audio]++;
+ Stats.stall_us[audio] += wait_us;
+
+ Record(EVENT_STALL, audio, lba, 0, std::min<uint64>(0xFFFFFFFF, wait_us));
+}
+
+void ADPCMUnderrun(const uint16 read_addr)
+{
+ Stats.adpcm_underruns++;
+
+ Record(EVENT_ADPCM_UNDERRUN, 0, read_addr, 0, 0);
+}
+
+}
+
+}
@@ -0,0 +1,89 @@
+/******************************************************************************/
+/* Mednafen - Multi-system Emulator                                           */
+/******************************************************************************/
+/* CDTrace.h - Emulated CD drive activity trace
+**  Copyright (C) 2021 Mednafen Team
+**
+** This program is free software; you can redistribute it and/or
+** modify it under the terms of the GNU General Public License
+** as published by the Free Software Foundation; either version 2
+** of the License, or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef __MDFN_CDROM_CDTRACE_H
+#define __MDFN_CDROM_CDTRACE_H
+
+namespace Mednafen
+{
+
+//
+// Records what the emulated CD drive(scsicd.cpp) does over time, for tuning seek and read timing: every SCSI
+// command, every seek with its distance and modelled delay, each data read's transfer time, host-side stalls
+// waiting on the disc image, and ADPCM playback underruns.  Written as a binary trace, and summarized on Stop().
+//
+// Trace file(little-endian):
+//  Header(16 bytes):
+//   0x00  8  Magic, "MDFNCDTR".
+//   0x08  2  Version, 2.
+//   0x0A  1  System; 0 = PC Engine CD, 1 = PC-FX.
+//   0x0B  1  Reserved, 0.
+//   0x0C  4  Clock rate of timestamps, in Hz.
+//
+//  Records(24 bytes each):
+//   0x00  8  Timestamp, in clocks of the emulated CD unit's monotonic timestamp.
+//   0x08  1  Event type(EVENT_*).
+//   0x09  1  Event-specific; "a" below.
+//   0x0A  2  Reserved, 0.
+//   0x0C  4  Event-specific; "b" below.
+//   0x10  4  Event-specific; "c" below.
+//   0x14  4  Event-specific; "d" below.
+//
+namespace CDTrace
+{
+ enum : uint8
+ {
+  EVENT_COMMAND = 0,	// a = opcode, b/c/d = CDB bytes 1-4/5-8/9-12, big-endian.
+  EVENT_SEEK,		// a = 1 if for CD-DA playback, b = from LBA, c = to LBA, d = modelled delay before the first sector, in clocks.
+  EVENT_READ_DONE,	// b = start LBA, c = sector count, d = time since the read command, in clocks.
+  EVENT_STALL,		// a = 1 if for CD-DA playback, b = LBA, d = host time spent waiting on the disc image, in microseconds.
+  EVENT_ADPCM_UNDERRUN,	// b = ADPCM read address.
+  EVENT_DISCONTINUITY,	// Save state load, rewind, or reset; timestamp is the new one, b/c = previous timestamp, low/high 32 bits.
+ };
+
+ enum : uint8
+ {
+  SYSTEM_PCE = 0,
+  SYSTEM_PCFX = 1
+ };
+
+ extern bool Active;
+ extern int64 Now;	// Timestamp for new records; kept current by SCSICD_Run().
+
+ void Start(const std::string& path, const uint8 system, const uint32 clock_rate) MDFN_COLD;
+ void Stop(void) MDFN_COLD;	// Prints the summary.
+
+ // Clears Active while run-ahead emulates speculative frames that will be rolled back, and restores it afterward.
+ void Suspend(const bool suspend);
+
+ // Timestamps are about to jump(possibly backwards); ends any in-progress read, and sets Now to new_now.
+ void Discontinuity(const int64 new_now);
+
+ void Command(const uint8* cdb, const char* name);
+ void Seek(const int32 from_lba, const int32 to_lba, const int64 delay, const bool audio);
+ void ReadStart(const int32 lba, const uint32 count);
+ void ReadDone(void);
+ void Stall(const int32 lba, const uint64 wait_us, const bool audio);
+ void ADPCMUnderrun(const uint16 read_addr);
+}
+
+}
+#endif
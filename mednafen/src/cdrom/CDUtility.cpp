@@ -54,6 +54,27 @@ static void InitScrambleTable(void)
  // printf("0x%02x, ", scramble_table[i]);
 }
 
+//
+// CRC-16 as used for Q is linear(zero initial value, no final XOR inside crc16_ccitt()), so changing some bytes of
+// a Q buffer changes its CRC by the CRC of the XOR difference, which is the XOR of the CRCs of each changed byte alone.
+//
+static const uint8 subq_position_offs[6] = { 0x3, 0x4, 0x5, 0x7, 0x8, 0x9 };
+static uint16 subq_position_crc[6][256];
+
+static void InitSubQPositionCRC(void)
+{
+ for(unsigned i = 0; i < 6; i++)
+ {
+  for(unsigned v = 0; v < 256; v++)
+  {
+   uint8 tmp[0xA] = { 0 };
+
+   tmp[subq_position_offs[i]] = v;
+   subq_position_crc[i][v] = crc16_ccitt(tmp, 0xA);
+  }
+ }
+}
+
 void CDUtility_Init(void)
 {
  if(!CDUtility_Inited)
@@ -62,6 +83,8 @@ void CDUtility_Init(void)
 
   InitScrambleTable();
 
+  InitSubQPositionCRC();
+
   CDUtility_Inited = true;
  }
 }
@@ -115,32 +138,50 @@ bool edc_lec_check_and_correct(uint8 *sector_data, bool xa)
  return(ValidateRawSector(sector_data, xa));
 }
 
-void subq_deinterleave(const uint8 *SubPWBuf, uint8 *qbuf)
+//
+// The subchannel (de)interleaving below works on 8 bytes of interleaved data at a time, one byte per bit of a
+// deinterleaved byte, with the first interleaved byte holding the most significant bit.
+//
+// Gathers bit "bit" of each of the 8 bytes in "v"(little-endian), into one byte.  The multiply moves each byte's bit to its
+// place in the top byte; the other partial products land either above bit 63 or below bit 56, at distinct positions,
+// so they can't carry into it.
+static INLINE uint8 GatherBits(const uint64 v, const unsigned bit)
 {
- memset(qbuf, 0, 0xC);
+ return (((v >> bit) & 0x0101010101010101ULL) * 0x8040201008040201ULL) >> 56;
+}
 
- for(int i = 0; i < 96; i++)
- {
-  qbuf[i >> 3] |= ((SubPWBuf[i] >> 6) & 0x1) << (7 - (i & 0x7));
- }
+// Inverse of GatherBits(), returning 0x80 in each byte whose bit is set in "b", and 0x00 in the others.
+static INLINE uint64 SpreadBits(const uint8 b)
+{
+ const uint64 sel = (b * 0x0101010101010101ULL) & 0x0102040810204080ULL;
+
+ return (sel + 0x7F7F7F7F7F7F7F7FULL) & 0x8080808080808080ULL;
 }
 
+void subq_deinterleave(const uint8 *SubPWBuf, uint8 *qbuf)
+{
+ for(unsigned i = 0; i < 12; i++)
+  qbuf[i] = GatherBits(MDFN_de64lsb(&SubPWBuf[i << 3]), 6);
+}
+
+void subq_interleave_or(const uint8* qbuf, uint8* SubPWBuf)
+{
+ for(unsigned i = 0; i < 12; i++)
+  MDFN_en64lsb(&SubPWBuf[i << 3], MDFN_de64lsb(&SubPWBuf[i << 3]) | (SpreadBits(qbuf[i]) >> 1));
+}
 
 // Deinterleaves 96 bytes of subchannel P-W data from 96 bytes of interleaved subchannel PW data.
 void subpw_deinterleave(const uint8 *in_buf, uint8 *out_buf)
 {
  assert(in_buf != out_buf);
 
- memset(out_buf, 0, 96);
-
- for(unsigned ch = 0; ch < 8; ch++)
+ for(unsigned d = 0; d < 12; d++)
  {
-  for(unsigned i = 0; i < 96; i++)
-  {
-   out_buf[(ch * 12) + (i >> 3)] |= ((in_buf[i] >> (7 - ch)) & 0x1) << (7 - (i & 0x7));
-  }
- }
+  const uint64 v = MDFN_de64lsb(&in_buf[d << 3]);
 
+  for(unsigned ch = 0; ch < 8; ch++)
+   out_buf[(ch * 12) + d] = GatherBits(v, 7 - ch);
+ }
 }
 
 // Interleaves 96 bytes of subchannel P-W data from 96 bytes of uninterleaved subchannel PW data.
@@ -150,17 +191,30 @@ void subpw_interleave(const uint8 *in_buf, uint8 *out_buf)
 
  for(unsigned d = 0; d < 12; d++)
  {
-  for(unsigned bitpoodle = 0; bitpoodle < 8; bitpoodle++)
-  {
-   uint8 rawb = 0;
+  uint64 v = 0;
 
-   for(unsigned ch = 0; ch < 8; ch++)
-   {
-    rawb |= ((in_buf[ch * 12 + d] >> (7 - bitpoodle)) & 1) << (7 - ch);
-   }
-   out_buf[(d << 3) + bitpoodle] = rawb;
-  }
+  for(unsigned ch = 0; ch < 8; ch++)
+   v |= SpreadBits(in_buf[ch * 12 + d]) >> ch;
+
+  MDFN_en64lsb(&out_buf[d << 3], v);
+ }
+}
+
+void subq_set_position(uint8* subq_buf, const uint32 relative_frames, const uint32 absolute_aba)
+{
+ uint8 pos[6];
+ uint16 crc = 0xFFFF ^ MDFN_de16msb(&subq_buf[0xA]);
+
+ ABA_to_AMSF_BCD(relative_frames, &pos[0], &pos[1], &pos[2]);
+ ABA_to_AMSF_BCD(absolute_aba, &pos[3], &pos[4], &pos[5]);
+
+ for(unsigned i = 0; i < 6; i++)
+ {
+  crc ^= subq_position_crc[i][subq_buf[subq_position_offs[i]] ^ pos[i]];
+  subq_buf[subq_position_offs[i]] = pos[i];
  }
+
+ MDFN_en16msb(&subq_buf[0xA], 0xFFFF ^ crc);
 }
 
 // NOTES ON LEADOUT AREA SYNTHESIS
@@ -213,8 +267,8 @@ void subpw_synth_leadout_lba(const TOC& toc, const int32 lba, uint8* SubPWBuf)
 
  subq_generate_checksum(buf);
 
- for(int i = 0; i < 96; i++)
-  SubPWBuf[i] = (((buf[i >> 3] >> (7 - (i & 0x7))) & 1) ? 0x40 : 0x00) | 0x80;
+ memset(SubPWBuf, 0x80, 96);
+ subq_interleave_or(buf, SubPWBuf);
 }
 
 void synth_leadout_sector_lba(uint8 mode, const TOC& toc, const int32 lba, uint8* out_buf)
@@ -309,8 +363,8 @@ void subpw_synth_udapp_lba(const TOC& toc, const int32 lba, const int32 lba_subq
 
  subq_generate_checksum(buf);
 
- for(int i = 0; i < 96; i++)
-  SubPWBuf[i] = (((buf[i >> 3] >> (7 - (i & 0x7))) & 1) ? 0x40 : 0x00) | 0x80;
+ memset(SubPWBuf, 0x80, 96);
+ subq_interleave_or(buf, SubPWBuf);
 }
 
 void synth_udapp_sector_lba(uint8 mode, const TOC& toc, const int32 lba, int32 lba_subq_relative_offs, uint8* out_buf)
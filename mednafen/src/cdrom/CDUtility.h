@@ -256,6 +256,14 @@ namespace CDUtility
  // Deinterleaves 12 bytes of subchannel Q data from 96 bytes of interleaved subchannel PW data.
  void subq_deinterleave(const uint8 *subpw_buf, uint8 *subq_buf);
 
+ // Interleaves 12 bytes of subchannel Q data, ORing them into 96 bytes of interleaved subchannel PW data.
+ void subq_interleave_or(const uint8* subq_buf, uint8* subpw_buf);
+
+ // Sets the track-relative and absolute position(MSF) fields of ADR_CURPOS subchannel Q data, and updates the checksum
+ // to match without recalculating it over the whole buffer.  subq_buf must pass subq_check_checksum() beforehand.
+ // Requires CDUtility_Init() to have been called.
+ void subq_set_position(uint8* subq_buf, const uint32 relative_frames, const uint32 absolute_aba);
+
  // Deinterleaves 96 bytes of subchannel P-W data from 96 bytes of interleaved subchannel PW data.
  void subpw_deinterleave(const uint8 *in_buf, uint8 *out_buf);
 
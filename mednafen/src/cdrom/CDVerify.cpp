@@ -0,0 +1,383 @@
+/******************************************************************************/
+/* Mednafen - Multi-system Emulator                                           */
+/******************************************************************************/
+/* CDVerify.cpp - Whole-disc integrity check
+**  Copyright (C) 2021 Mednafen Team
+**
+** This program is free software; you can redistribute it and/or
+** modify it under the terms of the GNU General Public License
+** as published by the Free Software Foundation; either version 2
+** of the License, or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+//
+// The disc is read in chunks of sectors, by the calling thread, into a ring of chunk buffers.  Each
+// filled chunk is then handed to three consumers: an MD5 thread and a SHA-256 thread, which must
+// process the chunks in order, and a pool of EDC/L-EC checking threads, which take whichever
+// chunk is next.  A chunk buffer is reused once all three are done with it.
+//
+// Nothing here may modify a chunk's sector data, since the consumers run concurrently;
+// L-EC correction is done on a copy.
+//
+
+#include <mednafen/mednafen.h>
+#include <mednafen/MThreading.h>
+#include "CDVerify.h"
+#include "dvdisaster.h"
+
+#include <thread>
+
+namespace Mednafen
+{
+
+using namespace CDUtility;
+
+namespace
+{
+
+enum : uint32 { ChunkSectors = 256 };
+
+enum : uint8
+{
+ SF_DATA = 0x01,
+ SF_READ_ERROR = 0x02
+};
+
+struct Chunk
+{
+ int32 lba;
+ uint32 count;
+ uint8 flags[ChunkSectors];
+ uint8 data[ChunkSectors][2352 + 96];
+};
+
+enum
+{
+ SECTOR_OK = 0,
+ SECTOR_CORRECTED,
+ SECTOR_BAD
+};
+
+class CDVerifier
+{
+ public:
+
+ CDVerifier(CDInterface* cdif, unsigned num_threads, CDVerifyResult* res);
+ ~CDVerifier();
+
+ void Run(void);
+
+ private:
+
+ static int MD5ThreadStart_C(void* v);
+ static int SHA256ThreadStart_C(void* v);
+ static int CheckThreadStart_C(void* v);
+
+ template<typename T>
+ void HashThread(T* hasher, MThreading::Sem* ready);
+ void CheckThread(void);
+ void ChunkDone(const unsigned k);
+
+ static unsigned CheckSector(const uint8* data);
+
+ CDInterface* cdif;
+ CDVerifyResult* res;
+ TOC toc;
+ unsigned num_check_threads;
+
+ uint32 total_chunks;
+ unsigned num_chunks;
+ std::unique_ptr<Chunk[]> chunks;
+ std::unique_ptr<unsigned[]> chunk_pending;	// Consumers yet to finish with the chunk.
+ std::vector<MThreading::Sem*> chunk_free;
+
+ MThreading::Mutex* mutex;	// Protects chunk_pending, check_next, and res->corrected and res->bad_lbas.
+ MThreading::Sem* md5_ready;
+ MThreading::Sem* sha256_ready;
+ MThreading::Sem* check_ready;
+ uint32 check_next;
+
+ md5_hasher md5;
+ sha256_hasher sha256;
+};
+
+CDVerifier::CDVerifier(CDInterface* cdif_, unsigned num_threads, CDVerifyResult* res_) : cdif(cdif_), res(res_), mutex(nullptr), md5_ready(nullptr), sha256_ready(nullptr), check_ready(nullptr), check_next(0)
+{
+ cdif->ReadTOC(&toc);
+
+ if(!num_threads)
+  num_threads = std::max<unsigned>(1, std::thread::hardware_concurrency());
+
+ num_check_threads = num_threads;
+
+ res->sectors = toc.tracks[100].lba;
+ res->data_sectors = 0;
+ res->corrected = 0;
+ res->bad_lbas.clear();
+
+ total_chunks = (res->sectors + ChunkSectors - 1) / ChunkSectors;
+ num_chunks = std::min<uint32>(std::max<uint32>(1, total_chunks), num_check_threads * 2 + 2);
+ chunks.reset(new Chunk[num_chunks]);
+ chunk_pending.reset(new unsigned[num_chunks]);
+
+ try
+ {
+  mutex = MThreading::Mutex_Create();
+  md5_ready = MThreading::Sem_Create();
+  sha256_ready = MThreading::Sem_Create();
+  check_ready = MThreading::Sem_Create();
+
+  for(unsigned k = 0; k < num_chunks; k++)
+  {
+   chunk_free.push_back(MThreading::Sem_Create());
+   MThreading::Sem_Post(chunk_free.back());
+  }
+ }
+ catch(...)
+ {
+  for(auto* s : chunk_free)
+   MThreading::Sem_Destroy(s);
+
+  if(check_ready)
+   MThreading::Sem_Destroy(check_ready);
+
+  if(sha256_ready)
+   MThreading::Sem_Destroy(sha256_ready);
+
+  if(md5_ready)
+   MThreading::Sem_Destroy(md5_ready);
+
+  if(mutex)
+   MThreading::Mutex_Destroy(mutex);
+
+  throw;
+ }
+}
+
+CDVerifier::~CDVerifier()
+{
+ for(auto* s : chunk_free)
+  MThreading::Sem_Destroy(s);
+
+ MThreading::Sem_Destroy(check_ready);
+ MThreading::Sem_Destroy(sha256_ready);
+ MThreading::Sem_Destroy(md5_ready);
+ MThreading::Mutex_Destroy(mutex);
+}
+
+int CDVerifier::MD5ThreadStart_C(void* v)
+{
+ CDVerifier* cdv = (CDVerifier*)v;
+
+ cdv->HashThread(&cdv->md5, cdv->md5_ready);
+
+ return 0;
+}
+
+int CDVerifier::SHA256ThreadStart_C(void* v)
+{
+ CDVerifier* cdv = (CDVerifier*)v;
+
+ cdv->HashThread(&cdv->sha256, cdv->sha256_ready);
+
+ return 0;
+}
+
+int CDVerifier::CheckThreadStart_C(void* v)
+{
+ ((CDVerifier*)v)->CheckThread();
+
+ return 0;
+}
+
+void CDVerifier::ChunkDone(const unsigned k)
+{
+ MThreading::Mutex_Lock(mutex);
+
+ if(!--chunk_pending[k])
+  MThreading::Sem_Post(chunk_free[k]);
+
+ MThreading::Mutex_Unlock(mutex);
+}
+
+template<typename T>
+void CDVerifier::HashThread(T* hasher, MThreading::Sem* ready)
+{
+ for(uint32 i = 0; i < total_chunks; i++)
+ {
+  const unsigned k = i % num_chunks;
+  const Chunk* c = &chunks[k];
+
+  MThreading::Sem_Wait(ready);
+
+  for(uint32 s = 0; s < c->count; s++)
+   hasher->process(c->data[s], 2352);
+
+  ChunkDone(k);
+ }
+}
+
+unsigned CDVerifier::CheckSector(const uint8* data)
+{
+ const uint8 mode = data[12 + 3];
+
+ if(mode == 0x1 || (mode == 0x2 && !(data[12 + 6] & 0x20)))
+ {
+  const bool xa = (mode == 0x2);
+  uint8 tmp[2352];
+
+  if(edc_check(data, xa))
+   return SECTOR_OK;
+
+  memcpy(tmp, data, sizeof(tmp));
+
+  return edc_lec_check_and_correct(tmp, xa) ? SECTOR_CORRECTED : SECTOR_BAD;
+ }
+ else if(mode == 0x2)
+ {
+  // Mode 2 form 2; no L-EC, and the EDC is optional(0 when absent).
+  const uint32 expected_crc = MDFN_de32lsb(&data[2348]);
+
+  return (!expected_crc || expected_crc == EDCCrc32(&data[16], 2332)) ? SECTOR_OK : SECTOR_BAD;
+ }
+ else if(mode == 0x0)
+  return SECTOR_OK;
+
+ return SECTOR_BAD;
+}
+
+void CDVerifier::CheckThread(void)
+{
+ std::vector<int32> bad_lbas;
+
+ for(;;)
+ {
+  uint32 i;
+
+  MThreading::Sem_Wait(check_ready);
+
+  MThreading::Mutex_Lock(mutex);
+  i = check_next++;
+  MThreading::Mutex_Unlock(mutex);
+
+  if(i >= total_chunks)
+   break;
+  //
+  const unsigned k = i % num_chunks;
+  const Chunk* c = &chunks[k];
+  uint32 corrected = 0;
+
+  bad_lbas.clear();
+
+  for(uint32 s = 0; s < c->count; s++)
+  {
+   if(c->flags[s] & SF_READ_ERROR)
+    bad_lbas.push_back(c->lba + s);
+   else if(c->flags[s] & SF_DATA)
+   {
+    switch(CheckSector(c->data[s]))
+    {
+     case SECTOR_CORRECTED: corrected++; break;
+     case SECTOR_BAD: bad_lbas.push_back(c->lba + s); break;
+    }
+   }
+  }
+
+  MThreading::Mutex_Lock(mutex);
+  res->corrected += corrected;
+  res->bad_lbas.insert(res->bad_lbas.end(), bad_lbas.begin(), bad_lbas.end());
+  MThreading::Mutex_Unlock(mutex);
+
+  ChunkDone(k);
+ }
+}
+
+void CDVerifier::Run(void)
+{
+ std::vector<MThreading::Thread*> threads;
+
+ threads.push_back(MThreading::Thread_Create(MD5ThreadStart_C, this, "CD Verify MD5"));
+ threads.push_back(MThreading::Thread_Create(SHA256ThreadStart_C, this, "CD Verify SHA-256"));
+
+ for(unsigned t = 0; t < num_check_threads; t++)
+  threads.push_back(MThreading::Thread_Create(CheckThreadStart_C, this, "CD Verify EDC/L-EC"));
+
+ for(uint32 i = 0; i < total_chunks; i++)
+ {
+  const unsigned k = i % num_chunks;
+  Chunk* c = &chunks[k];
+
+  MThreading::Sem_Wait(chunk_free[k]);
+
+  c->lba = i * ChunkSectors;
+  c->count = std::min<uint32>(ChunkSectors, res->sectors - c->lba);
+
+  for(uint32 s = 0; s < c->count; s++)
+  {
+   const int32 lba = c->lba + s;
+   bool read_ok;
+
+   try
+   {
+    read_ok = cdif->ReadRawSector(c->data[s], lba);
+   }
+   catch(std::exception&)
+   {
+    read_ok = false;
+   }
+
+   c->flags[s] = 0;
+
+   if(toc.tracks[toc.FindTrackByLBA(lba)].control & SUBQ_CTRLF_DATA)
+   {
+    c->flags[s] |= SF_DATA;
+    res->data_sectors++;
+   }
+
+   if(!read_ok)
+   {
+    c->flags[s] |= SF_READ_ERROR;
+    memset(c->data[s], 0, sizeof(c->data[s]));
+   }
+  }
+
+  MThreading::Mutex_Lock(mutex);
+  chunk_pending[k] = 3;
+  MThreading::Mutex_Unlock(mutex);
+
+  MThreading::Sem_Post(md5_ready);
+  MThreading::Sem_Post(sha256_ready);
+  MThreading::Sem_Post(check_ready);
+ }
+
+ // Wake the checking threads so they see there's nothing left.
+ for(unsigned t = 0; t < num_check_threads; t++)
+  MThreading::Sem_Post(check_ready);
+
+ for(auto* t : threads)
+  MThreading::Thread_Wait(t, nullptr);
+
+ std::sort(res->bad_lbas.begin(), res->bad_lbas.end());
+ res->md5 = md5.digest();
+ res->sha256 = sha256.digest();
+}
+
+}
+
+void CDVerify(CDInterface* cdif, unsigned num_threads, CDVerifyResult* res)
+{
+ CDVerifier cdv(cdif, num_threads, res);
+
+ cdv.Run();
+}
+
+}
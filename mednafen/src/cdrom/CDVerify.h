@@ -0,0 +1,54 @@
+/******************************************************************************/
+/* Mednafen - Multi-system Emulator                                           */
+/******************************************************************************/
+/* CDVerify.h - Whole-disc integrity check
+**  Copyright (C) 2021 Mednafen Team
+**
+** This program is free software; you can redistribute it and/or
+** modify it under the terms of the GNU General Public License
+** as published by the Free Software Foundation; either version 2
+** of the License, or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef __MDFN_CDROM_CDVERIFY_H
+#define __MDFN_CDROM_CDVERIFY_H
+
+#include <mednafen/cdrom/CDInterface.h>
+#include <mednafen/hash/md5.h>
+#include <mednafen/hash/sha256.h>
+
+namespace Mednafen
+{
+
+struct CDVerifyResult
+{
+ uint32 sectors;		// LBA 0 up to the leadout.
+ uint32 data_sectors;
+ uint32 corrected;		// Data sectors whose EDC errors were corrected by L-EC.
+ std::vector<int32> bad_lbas;	// Unreadable sectors, and data sectors with uncorrectable errors; sorted.
+
+ // Of the 2352 bytes of main channel data of every sector, data sectors descrambled, as
+ // in a single-file BIN/CUE image of the disc without any pregap before track 1.
+ md5_digest md5;
+ sha256_digest sha256;
+};
+
+//
+// Reads every sector of the disc, checking the EDC(and attempting L-EC correction on failure)
+// of data sectors and hashing the whole.  Sectors are read sequentially by the calling thread,
+// while hashing and checking are spread over other threads; "num_threads" is the number of
+// EDC/L-EC checking threads, or 0 to pick one automatically.
+//
+void CDVerify(CDInterface* cdif, unsigned num_threads, CDVerifyResult* res) MDFN_COLD;
+
+}
+#endif
@@ -0,0 +1,210 @@
+/******************************************************************************/
+/* Mednafen - Multi-system Emulator                                           */
+/******************************************************************************/
+/* CDZWriter.cpp - CDZ compressed disc image creation
+**  Copyright (C) 2021 Mednafen Team
+**
+** This program is free software; you can redistribute it and/or
+** modify it under the terms of the GNU General Public License
+** as published by the Free Software Foundation; either version 2
+** of the License, or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <mednafen/mednafen.h>
+#include <mednafen/compress/BlockCompressor.h>
+#include "CDZWriter.h"
+#include "CDAccess_CDZ.h"
+
+#include <zlib.h>
+
+namespace Mednafen
+{
+
+using namespace CDUtility;
+
+enum : uint32 { HunkSectors = 32 };
+
+//
+// Returns the CDZ_SECTOR_* type "sector" can be stored as, and its stored data.
+//
+static uint8 ClassifySector(const uint8* sector, const int32 lba, const bool strip_ecc, const uint8** stored, uint32* stored_size)
+{
+ static const uint8 sync[12] = { 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00 };
+
+ *stored = sector;
+ *stored_size = 2352;
+
+ if(strip_ecc && !memcmp(sector, sync, sizeof(sync)))
+ {
+  uint8 tmp[2352];
+  uint8 type = CDZ_SECTOR_RAW;
+  uint32 size = 0;
+
+  memset(tmp, 0, sizeof(tmp));
+
+  if(sector[15] == 0x01)
+  {
+   type = CDZ_SECTOR_MODE1;
+   size = 2048;
+   memcpy(tmp + 16, sector + 16, size);
+   encode_mode1_sector(LBA_to_ABA(lba), tmp);
+  }
+  else if(sector[15] == 0x02)
+  {
+   if(sector[18] & 0x20)
+   {
+    type = CDZ_SECTOR_MODE2_FORM2;
+    size = 8 + 2324;
+    memcpy(tmp + 16, sector + 16, size);
+    encode_mode2_form2_sector(LBA_to_ABA(lba), tmp);
+   }
+   else
+   {
+    type = CDZ_SECTOR_MODE2_FORM1;
+    size = 8 + 2048;
+    memcpy(tmp + 16, sector + 16, size);
+    encode_mode2_form1_sector(LBA_to_ABA(lba), tmp);
+   }
+  }
+
+  if(type != CDZ_SECTOR_RAW && !memcmp(tmp, sector, 2352))
+  {
+   *stored = sector + 16;
+   *stored_size = size;
+   return type;
+  }
+ }
+
+ return CDZ_SECTOR_RAW;
+}
+
+void CDZ_Write(CDInterface* cdif, Stream* out, const bool strip_ecc)
+{
+ if(!BlockCompressor::IsAvailable(BlockCompressor::TYPE_ZSTD))
+  throw MDFN_Error(0, _("Writing CDZ images requires zstd compression support, which was not compiled in."));
+
+ std::unique_ptr<BlockCompressor> bc(BlockCompressor::Create(BlockCompressor::TYPE_ZSTD));
+ const size_t max_hunk_size = HunkSectors * (1 + 2352);
+ std::unique_ptr<uint8[]> hunk(new uint8[max_hunk_size]);
+ std::unique_ptr<uint8[]> comp(new uint8[bc->MaxCompressedSize(max_hunk_size)]);
+ std::vector<uint8> index;
+ uint8 header[CDZ_HEADER_SIZE];
+ TOC toc;
+
+ cdif->ReadTOC(&toc);
+
+ const uint32 num_sectors = toc.tracks[100].lba;
+ const uint32 hunk_count = (num_sectors + HunkSectors - 1) / HunkSectors;
+ std::unique_ptr<uint8[]> sub_data(new uint8[(size_t)num_sectors * 96]);
+
+ memset(header, 0, sizeof(header));
+ out->write(header, sizeof(header));
+
+ for(uint32 h = 0; h < hunk_count; h++)
+ {
+  const uint32 nsectors = std::min<uint32>(HunkSectors, num_sectors - h * HunkSectors);
+  size_t size = nsectors;
+
+  for(uint32 s = 0; s < nsectors; s++)
+  {
+   const int32 lba = h * HunkSectors + s;
+   uint8 buf[2352 + 96];
+   const uint8* stored;
+   uint32 stored_size;
+
+   if(!cdif->ReadRawSector(buf, lba))
+    throw MDFN_Error(0, _("Error reading sector at LBA %d."), lba);
+
+   hunk[s] = ClassifySector(buf, lba, strip_ecc, &stored, &stored_size);
+   subpw_deinterleave(buf + 2352, &sub_data[(size_t)lba * 96]);
+   memcpy(&hunk[size], stored, stored_size);
+   size += stored_size;
+  }
+  //
+  //
+  //
+  const uint64 offset = out->tell();
+  const uint32 hunk_crc = crc32(0, hunk.get(), size);
+  size_t comp_size = bc->Compress(hunk.get(), size, comp.get());
+  uint8 ie[16];
+
+  if(comp_size < size)
+   out->write(comp.get(), comp_size);
+  else
+  {
+   out->write(hunk.get(), size);
+   comp_size = size | CDZ_HUNK_UNCOMPRESSED;
+  }
+
+  MDFN_en64lsb(&ie[0], offset);
+  MDFN_en32lsb(&ie[8], comp_size);
+  MDFN_en32lsb(&ie[12], hunk_crc);
+  index.insert(index.end(), ie, ie + sizeof(ie));
+ }
+
+ const uint64 index_offset = out->tell();
+
+ if(index.size())
+  out->write(&index[0], index.size());
+ //
+ //
+ //
+ const uint64 sub_offset = out->tell();
+ const size_t sub_size = (size_t)num_sectors * 96;
+ const uint32 sub_crc = crc32(0, sub_data.get(), sub_size);
+ uint32 sub_length;
+ {
+  std::unique_ptr<uint8[]> sub_comp(new uint8[bc->MaxCompressedSize(sub_size)]);
+  const size_t sub_comp_size = bc->Compress(sub_data.get(), sub_size, sub_comp.get());
+
+  if(sub_comp_size < sub_size)
+  {
+   out->write(sub_comp.get(), sub_comp_size);
+   sub_length = sub_comp_size;
+  }
+  else
+  {
+   out->write(sub_data.get(), sub_size);
+   sub_length = sub_size | CDZ_HUNK_UNCOMPRESSED;
+  }
+ }
+
+ memcpy(&header[0x00], "MDFNCDZ", 8);
+ MDFN_en32lsb(&header[0x08], CDZ_VERSION);
+ MDFN_en32lsb(&header[0x0C], 0);
+ MDFN_en32lsb(&header[0x10], num_sectors);
+ MDFN_en32lsb(&header[0x14], HunkSectors);
+ MDFN_en64lsb(&header[0x18], index_offset);
+ header[0x20] = toc.first_track;
+ header[0x21] = toc.last_track;
+ header[0x22] = toc.disc_type;
+
+ for(unsigned t = 1; t <= 100; t++)
+ {
+  uint8* te = &header[0x28 + (t - 1) * 8];
+
+  MDFN_en32lsb(&te[0], toc.tracks[t].lba);
+  te[4] = toc.tracks[t].adr;
+  te[5] = toc.tracks[t].control;
+  te[6] = toc.tracks[t].valid || t == 100;
+ }
+
+ MDFN_en64lsb(&header[0x348], sub_offset);
+ MDFN_en32lsb(&header[0x350], sub_length);
+ MDFN_en32lsb(&header[0x354], sub_crc);
+
+ out->seek(0, SEEK_SET);
+ out->write(header, sizeof(header));
+ out->close();
+}
+
+}
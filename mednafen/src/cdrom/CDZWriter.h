@@ -0,0 +1,40 @@
+/******************************************************************************/
+/* Mednafen - Multi-system Emulator                                           */
+/******************************************************************************/
+/* CDZWriter.h - CDZ compressed disc image creation
+**  Copyright (C) 2021 Mednafen Team
+**
+** This program is free software; you can redistribute it and/or
+** modify it under the terms of the GNU General Public License
+** as published by the Free Software Foundation; either version 2
+** of the License, or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef __MDFN_CDROM_CDZWRITER_H
+#define __MDFN_CDROM_CDZWRITER_H
+
+#include <mednafen/cdrom/CDInterface.h>
+
+namespace Mednafen
+{
+
+//
+// Writes the whole disc, from LBA 0 up to the leadout, to "out" as a CDZ image(see CDAccess_CDZ.h), with its
+// subchannel data.  If "strip_ecc" is true, data sectors whose sync pattern, header, EDC, and ECC can be
+// regenerated exactly are stored without them.
+//
+// zstd compression requires building with an external libzstd; throws otherwise.
+//
+void CDZ_Write(CDInterface* cdif, Stream* out, const bool strip_ecc) MDFN_COLD;
+
+}
+#endif
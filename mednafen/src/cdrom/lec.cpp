@@ -24,7 +24,19 @@
 #include <assert.h>
 #include <sys/types.h>
 
+#include "dvdisaster.h"
 #include "lec.h"
+#include "../cputest/cputest.h"
+
+#if defined(ARCH_X86) && defined(HAVE_SSE2_INTRINSICS) && defined(__GNUC__)
+ #include <tmmintrin.h>
+ #define LEC_SSSE3 1
+#endif
+
+#if defined(HAVE_NEON_INTRINSICS) && defined(__aarch64__)
+ #include <arm_neon.h>
+ #define LEC_NEON 1
+#endif
 
 #define GF8_PRIM_POLY 0x11d /* x^8 + x^4 + x^3 + x^2 + 1 */
 
@@ -58,16 +70,6 @@ public:
   operator const u_int16_t *() const	    { return &table[0][0]; }
 } CF8_Q_COEFFS_RESULTS_01;
 
-static const class CrcTable {
-private:
-  u_int32_t table[256];
-public:
-  CrcTable();
-  ~CrcTable() {}
-  u_int32_t operator[](int i) const	{ return table[i]; }
-  operator const u_int32_t *() const	{ return table;    }
-} CRCTABLE;
-
 static const class ScrambleTable {
 private:
   u_int8_t table[2340];
@@ -223,67 +225,43 @@ Gf8_Q_Coeffs_Results_01::Gf8_Q_Coeffs_Results_01()
   }
 }
 
-/* Reverses the bits in 'd'. 'bits' defines the bit width of 'd'.
+/* Nibble-split copies of the CF8_Q_COEFFS_RESULTS_01 products, for the
+ * byte shuffle based SIMD P/Q parity calculation; since multiplication
+ * distributes over the XOR, c*d == c*(d & 0x0f) ^ c*(d & 0xf0).
  */
-static u_int32_t mirror_bits(u_int32_t d, int bits)
-{
-  int i;
-  u_int32_t r = 0;
-
-  for (i = 0; i < bits; i++) {
-    r <<= 1;
-
-    if ((d & 0x1) != 0)
-      r |= 0x1;
-
-    d >>= 1;
-  }
+static const class Gf8_Q_Coeffs_Nibbles {
+public:
+  Gf8_Q_Coeffs_Nibbles();
+  ~Gf8_Q_Coeffs_Nibbles() {}
 
-  return r;
-}
+  /* [coefficient][low nibble/coeff 0, high nibble/coeff 0, low nibble/coeff 1, high nibble/coeff 1][nibble] */
+  alignas(16) u_int8_t table[43][4][16];
+} CF8_Q_COEFFS_NIBBLES;
 
-/* Build the CRC lookup table for EDC_POLY poly. The CRC is 32 bit wide
- * and reversed (i.e. the bit stream is divided by the EDC_POLY with the
- * LSB first order).
- */
-CrcTable::CrcTable ()
+Gf8_Q_Coeffs_Nibbles::Gf8_Q_Coeffs_Nibbles()
 {
-  u_int32_t i, j;
-  u_int32_t r;
-  
-  for (i = 0; i < 256; i++) {
-    r = mirror_bits(i, 8);
-
-    r <<= 24;
+  int i, j;
 
-    for (j = 0; j < 8; j++) {
-      if ((r & 0x80000000) != 0) {
-	r <<= 1;
-	r ^= EDC_POLY;
-      }
-      else {
-	r <<= 1;
-      }
+  for (j = 0; j < 43; j++) {
+    for (i = 0; i < 16; i++) {
+      const u_int16_t lo = CF8_Q_COEFFS_RESULTS_01[j][i];
+      const u_int16_t hi = CF8_Q_COEFFS_RESULTS_01[j][i << 4];
+
+      table[j][0][i] = lo & 0xff;
+      table[j][1][i] = hi & 0xff;
+      table[j][2][i] = lo >> 8;
+      table[j][3][i] = hi >> 8;
     }
-
-    r = mirror_bits(r, 32);
-
-    table[i] = r;
   }
 }
 
-/* Calculates the CRC of given data with given lengths based on the
- * table lookup algorithm.
+/* Calculates the EDC of given data with given lengths; the CRC is 32 bit
+ * wide and reversed (i.e. the bit stream is divided by the EDC_POLY with
+ * the LSB first order), which is the same CRC the dvdisaster code uses.
  */
 static u_int32_t calc_edc(u_int8_t *data, int len)
 {
-  u_int32_t crc = 0;
-
-  while (len--) {
-    crc = CRCTABLE[(int)(crc ^ *data++) & 0xff] ^ (crc >> 8);
-  }
-
-  return crc;
+  return EDCCrc32(data, len);
 }
 
 /* Build the scramble table as defined in the yellow book. The bytes
@@ -383,6 +361,132 @@ static void set_sector_header(u_int8_t mode, u_int32_t adr, u_int8_t *sector)
   sector[LEC_HEADER_OFFSET + 3] = mode;
 }
 
+/* SIMD parity kernel: for 'count' rows of 16*NVEC bytes, 'stride' bytes apart
+ * starting at 'base', multiplies row j by Q coefficients 'coeff_start' + j
+ * and accumulates the products into 'out0' (first coefficient set) and
+ * 'out1' (second coefficient set).
+ */
+#if defined(LEC_SSSE3)
+template<int NVEC>
+static __attribute__((target("ssse3"))) void parity_kernel_ssse3(const u_int8_t *base, int stride, int coeff_start, int count, u_int8_t *out0, u_int8_t *out1)
+{
+  const __m128i nmask = _mm_set1_epi8(0x0f);
+  __m128i acc0[NVEC], acc1[NVEC];
+  int j, v;
+
+  for (v = 0; v < NVEC; v++)
+    acc0[v] = acc1[v] = _mm_setzero_si128();
+
+  for (j = 0; j < count; j++) {
+    const u_int8_t (*nt)[16] = CF8_Q_COEFFS_NIBBLES.table[coeff_start + j];
+    const __m128i t0l = _mm_load_si128((const __m128i*)nt[0]);
+    const __m128i t0h = _mm_load_si128((const __m128i*)nt[1]);
+    const __m128i t1l = _mm_load_si128((const __m128i*)nt[2]);
+    const __m128i t1h = _mm_load_si128((const __m128i*)nt[3]);
+    const u_int8_t *row = base + j * stride;
+
+    for (v = 0; v < NVEC; v++) {
+      const __m128i d = _mm_loadu_si128((const __m128i*)(row + v * 16));
+      const __m128i lo = _mm_and_si128(d, nmask);
+      const __m128i hi = _mm_and_si128(_mm_srli_epi16(d, 4), nmask);
+
+      acc0[v] = _mm_xor_si128(acc0[v], _mm_xor_si128(_mm_shuffle_epi8(t0l, lo), _mm_shuffle_epi8(t0h, hi)));
+      acc1[v] = _mm_xor_si128(acc1[v], _mm_xor_si128(_mm_shuffle_epi8(t1l, lo), _mm_shuffle_epi8(t1h, hi)));
+    }
+  }
+
+  for (v = 0; v < NVEC; v++) {
+    _mm_storeu_si128((__m128i*)(out0 + v * 16), acc0[v]);
+    _mm_storeu_si128((__m128i*)(out1 + v * 16), acc1[v]);
+  }
+}
+#endif
+
+#if defined(LEC_NEON)
+template<int NVEC>
+static void parity_kernel_neon(const u_int8_t *base, int stride, int coeff_start, int count, u_int8_t *out0, u_int8_t *out1)
+{
+  const uint8x16_t nmask = vdupq_n_u8(0x0f);
+  uint8x16_t acc0[NVEC], acc1[NVEC];
+  int j, v;
+
+  for (v = 0; v < NVEC; v++)
+    acc0[v] = acc1[v] = vdupq_n_u8(0);
+
+  for (j = 0; j < count; j++) {
+    const u_int8_t (*nt)[16] = CF8_Q_COEFFS_NIBBLES.table[coeff_start + j];
+    const uint8x16_t t0l = vld1q_u8(nt[0]);
+    const uint8x16_t t0h = vld1q_u8(nt[1]);
+    const uint8x16_t t1l = vld1q_u8(nt[2]);
+    const uint8x16_t t1h = vld1q_u8(nt[3]);
+    const u_int8_t *row = base + j * stride;
+
+    for (v = 0; v < NVEC; v++) {
+      const uint8x16_t d = vld1q_u8(row + v * 16);
+      const uint8x16_t lo = vandq_u8(d, nmask);
+      const uint8x16_t hi = vshrq_n_u8(d, 4);
+
+      acc0[v] = veorq_u8(acc0[v], veorq_u8(vqtbl1q_u8(t0l, lo), vqtbl1q_u8(t0h, hi)));
+      acc1[v] = veorq_u8(acc1[v], veorq_u8(vqtbl1q_u8(t1l, lo), vqtbl1q_u8(t1h, hi)));
+    }
+  }
+
+  for (v = 0; v < NVEC; v++) {
+    vst1q_u8(out0 + v * 16, acc0[v]);
+    vst1q_u8(out1 + v * 16, acc1[v]);
+  }
+}
+#endif
+
+enum { LEC_SIMD_NONE = 0, LEC_SIMD_SSSE3, LEC_SIMD_NEON };
+
+static unsigned lec_simd_detect(void)
+{
+#if defined(LEC_SSSE3)
+  if (cputest_get_flags() & CPUTEST_FLAG_SSSE3)
+    return LEC_SIMD_SSSE3;
+#endif
+
+#if defined(LEC_NEON)
+  return LEC_SIMD_NEON;
+#endif
+
+  return LEC_SIMD_NONE;
+}
+
+static unsigned lec_simd = lec_simd_detect();
+
+bool lec_set_simd(bool enable)
+{
+  const bool prev = (lec_simd != LEC_SIMD_NONE);
+
+  lec_simd = enable ? lec_simd_detect() : (unsigned)LEC_SIMD_NONE;
+
+  return prev;
+}
+
+/* Returns false if no SIMD implementation is available.
+ */
+template<int NVEC>
+static bool parity_kernel(const u_int8_t *base, int stride, int coeff_start, int count, u_int8_t *out0, u_int8_t *out1)
+{
+  switch (lec_simd) {
+#if defined(LEC_SSSE3)
+  case LEC_SIMD_SSSE3:
+    parity_kernel_ssse3<NVEC>(base, stride, coeff_start, count, out0, out1);
+    return true;
+#endif
+
+#if defined(LEC_NEON)
+  case LEC_SIMD_NEON:
+    parity_kernel_neon<NVEC>(base, stride, coeff_start, count, out0, out1);
+    return true;
+#endif
+  }
+
+  return false;
+}
+
 /* Calculate the P parities for the sector.
  * The 43 P vectors of length 24 are combined with the GF8_P_COEFFS.
  */
@@ -400,6 +504,20 @@ static void calc_P_parity(u_int8_t *sector)
   p1 = sector + LEC_MODE1_P_PARITY_OFFSET;
   p0 = sector + LEC_MODE1_P_PARITY_OFFSET + 2 * 43;
 
+  /* Each of the 24 P vector elements is a whole row of 2 * 43 bytes, so all
+   * 43 P vectors can be processed together; the over-read past each row
+   * only lands in the discarded lanes.
+   */
+  {
+    u_int8_t acc0[6 * 16], acc1[6 * 16];
+
+    if (parity_kernel<6>(p_lsb_start, 2 * 43, 19, 24, acc0, acc1)) {
+      memcpy(p0, acc0, 2 * 43);
+      memcpy(p1, acc1, 2 * 43);
+      return;
+    }
+  }
+
   for (i = 0; i <= 42; i++) {
     p_lsb = p_lsb_start;
 
@@ -446,6 +564,36 @@ static void calc_Q_parity(u_int8_t *sector)
   q1 = sector + LEC_MODE1_Q_PARITY_OFFSET;
   q0 = sector + LEC_MODE1_Q_PARITY_OFFSET + 2 * 26;
 
+  /* Element j of Q vector i is word 43 * ((i + j) % 26) + j; with column j
+   * copied out rotated by j words, element j of all 26 Q vectors is then a
+   * contiguous run.
+   */
+  if (lec_simd != LEC_SIMD_NONE) {
+    u_int8_t cols[43 * 2 * 26 + 16];
+    u_int8_t acc0[4 * 16], acc1[4 * 16];
+
+    for (j = 0; j <= 42; j++) {
+      const u_int8_t *s = q_lsb_start + 2 * j;
+      u_int8_t *d = cols + j * 2 * 26;
+      int r = j % 26;
+
+      for (i = 0; i <= 25; i++) {
+	d[2 * i] = s[2 * 43 * r];
+	d[2 * i + 1] = s[2 * 43 * r + 1];
+
+	if (++r == 26)
+	  r = 0;
+      }
+    }
+    memset(cols + 43 * 2 * 26, 0, 16);
+
+    parity_kernel<4>(cols, 2 * 26, 0, 43, acc0, acc1);
+
+    memcpy(q0, acc0, 2 * 26);
+    memcpy(q1, acc1, 2 * 26);
+    return;
+  }
+
   for (i = 0; i <= 25; i++) {
     q_lsb = q_lsb_start;
 
@@ -74,4 +74,10 @@ void lec_encode_mode2_form2_sector(u_int32_t adr, u_int8_t *sector);
  */
 void lec_scramble(u_int8_t *sector);
 
+/* Enables or disables the SIMD P/Q parity calculation(where available),
+ * so it can be cross-checked against the scalar one; not thread-safe.
+ * Returns whether SIMD was in use before.
+ */
+bool lec_set_simd(bool enable);
+
 #endif
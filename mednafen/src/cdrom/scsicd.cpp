@@ -43,6 +43,7 @@
 #include "scsicd.h"
 #include "SimpleFIFO.h"
 #include "seektime_pce.h"
+#include "CDTrace.h"
 
 #if defined(__SSE2__)
 #include <xmmintrin.h>
@@ -313,6 +314,9 @@ void SCSICD_Power(scsicd_timestamp_t system_timestamp)
 
  monotonic_timestamp = system_timestamp;
 
+ if(MDFN_UNLIKELY(CDTrace::Active) && monotonic_timestamp != CDTrace::Now)
+  CDTrace::Discontinuity(monotonic_timestamp);
+
  cd.DiscChanged = false;
 
  if(Cur_CDIF && !TrayOpen)
@@ -358,10 +362,7 @@ static void GenSubQFromSubPW(void)
 {
  uint8 SubQBuf[0xC];
 
- memset(SubQBuf, 0, 0xC);
-
- for(int i = 0; i < 96; i++)
-  SubQBuf[i >> 3] |= ((cd.SubPWBuf[i] & 0x40) >> 6) << (7 - (i & 7));
+ subq_deinterleave(cd.SubPWBuf, SubQBuf);
 
  //printf("Real %d/ SubQ %d - ", read_sec, BCD_to_U8(SubQBuf[7]) * 75 * 60 + BCD_to_U8(SubQBuf[8]) * 75 + BCD_to_U8(SubQBuf[9]) - 150);
  // Debug code, remove me.
@@ -540,6 +541,35 @@ static void DoSimpleDataIn(const uint8 *data_in, uint32 len)
  ChangePhase(PHASE_DATA_IN);
 }
 
+void SCSICD_GetCacheStats(CDInterface::CacheStats* stats)
+{
+ if(Cur_CDIF)
+  Cur_CDIF->GetCacheStats(stats);
+ else
+  memset(stats, 0, sizeof(*stats));
+}
+
+// Cur_CDIF->ReadRawSector(), noting in the trace any time spent waiting on the disc image.
+static INLINE bool ReadRawSector(uint8* buf, int32 lba, bool audio)
+{
+ if(MDFN_LIKELY(!CDTrace::Active))
+  return Cur_CDIF->ReadRawSector(buf, lba);
+ else
+ {
+  CDInterface::CacheStats prev, cur;
+  bool ret;
+
+  Cur_CDIF->GetCacheStats(&prev);
+  ret = Cur_CDIF->ReadRawSector(buf, lba);
+  Cur_CDIF->GetCacheStats(&cur);
+
+  if(cur.misses != prev.misses)
+   CDTrace::Stall(lba, cur.wait_us - prev.wait_us, audio);
+
+  return ret;
+ }
+}
+
 void SCSICD_SetDisc(bool new_tray_open, CDInterface *cdif, bool no_emu_side_effects)
 {
  Cur_CDIF = cdif;
@@ -2070,6 +2100,14 @@ static void DoREADBase(uint32 sa, uint32 sc)
   SCSILog("SCSI", "%sRead: start=0x%08x(track=%d, offs=0x%08x), cnt=0x%08x, timer=%dms", (SectorAddr == sa) ? "Sequential" : "", sa, Track, Offset, sc, (int) (((int64) CDReadTimer * 1000) / System_Clock));
  }
 
+ if(CDTrace::Active && sc)
+ {
+  if(sa != (head_pos + 1))
+   CDTrace::Seek(head_pos, sa, CDReadTimer, false);
+
+  CDTrace::ReadStart(sa, sc);
+ }
+
  PrevHeadAddress = SectorAddr;
  PrevSectorCount = sc;
 
@@ -2698,7 +2736,10 @@ static INLINE void RunCDDA(uint32 system_timestamp, int32 run_time)
      {
       uint8 tmpbuf[2352 + 96];
 
-      Cur_CDIF->ReadRawSector(tmpbuf, read_sec);	//, read_sec_end, read_sec_start);
+      if(MDFN_UNLIKELY(CDTrace::Active) && read_sec != head_pos && read_sec != (head_pos + 1))
+       CDTrace::Seek(head_pos, read_sec, 0, true);
+
+      ReadRawSector(tmpbuf, read_sec, true);	//, read_sec_end, read_sec_start);
       head_pos = read_sec;
 
       for(int i = 0; i < 588 * 2; i++)
@@ -2958,7 +2999,7 @@ static INLINE void RunCDRead(uint32 system_timestamp, int32 run_time)
     {
      CommandCCError(SENSEKEY_ILLEGAL_REQUEST, NSE_END_OF_VOLUME);
     }
-    else if(!Cur_CDIF->ReadRawSector(tmp_read_buf, SectorAddr))	//, SectorAddr + SectorCount))
+    else if(!ReadRawSector(tmp_read_buf, SectorAddr, false))	//, SectorAddr + SectorCount))
     {
      cd.data_transfer_done = false;
 
@@ -2998,6 +3039,9 @@ static INLINE void RunCDRead(uint32 system_timestamp, int32 run_time)
      }
 
      cd.data_transfer_done = (SectorCount == 0);
+
+     if(MDFN_UNLIKELY(CDTrace::Active) && cd.data_transfer_done)
+      CDTrace::ReadDone();
     }
    }				// end else to if(!Cur_CDIF->ReadSector
 
@@ -3017,6 +3061,7 @@ uint32 SCSICD_Run(scsicd_timestamp_t system_timestamp)
  }
 
  monotonic_timestamp += run_time;
+ CDTrace::Now = monotonic_timestamp;
 
  lastts = system_timestamp;
 
@@ -3150,6 +3195,9 @@ uint32 SCSICD_Run(scsicd_timestamp_t system_timestamp)
        {
 	bool prev_ps = (cdda.CDDAStatus == CDDASTATUS_PLAYING || cdda.CDDAStatus == CDDASTATUS_SCANNING);
 
+	if(MDFN_UNLIKELY(CDTrace::Active))
+	 CDTrace::Command(cd.command_buffer, cmd_info_ptr->pretty_name);
+
         cmd_info_ptr->func(cd.command_buffer);
 
 	bool new_ps = (cdda.CDDAStatus == CDDASTATUS_PLAYING || cdda.CDDAStatus == CDDASTATUS_SCANNING);
@@ -3339,6 +3387,8 @@ void SCSICD_SetTransferRate(uint32 TransferRate)
 
 void SCSICD_Close(void)
 {
+ CDTrace::Stop();
+
  if(din)
  {
   delete din;
@@ -3386,6 +3436,13 @@ void SCSICD_Init(int type, int cdda_time_div, int32* left_hrbuf, int32* right_hr
  System_Clock = SystemClock;
  CDIRQCallback = IRQFunc;
  CDStuffSubchannels = SSCFunc;
+
+ {
+  const std::string trace_path = MDFN_GetSettingS("cd.trace");
+
+  if(trace_path.size())
+   CDTrace::Start(trace_path, (type == SCSICD_PCFX) ? CDTrace::SYSTEM_PCFX : CDTrace::SYSTEM_PCE, SystemClock);
+ }
 }
 
 void SCSICD_SetCDDAVolume(double left, double right)
@@ -3502,6 +3559,11 @@ void SCSICD_StateAction(StateMem* sm, const unsigned load, const bool data_only,
 
   for(int i = 0; i < NumModePages; i++)
    UpdateMPCacheP(&ModePages[i]);
+
+  if(MDFN_UNLIKELY(CDTrace::Active))
+   CDTrace::Discontinuity(monotonic_timestamp);
+  else
+   CDTrace::Now = monotonic_timestamp;
  }
 }
 
@@ -1,6 +1,8 @@
 #ifndef __PCFX_SCSICD_H
 #define __PCFX_SCSICD_H
 
+#include <mednafen/cdrom/CDInterface.h>
+
 namespace Mednafen
 {
 
@@ -99,5 +101,8 @@ void SCSICD_StateAction(StateMem *sm, const unsigned load, const bool data_only,
 
 void SCSICD_SetDisc(bool tray_open, CDInterface* cdif, bool no_emu_side_effects = false);
 
+// For the debugger; all zero if no disc is loaded.
+void SCSICD_GetCacheStats(CDInterface::CacheStats* stats);
+
 }
 #endif
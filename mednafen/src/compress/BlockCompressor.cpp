@@ -0,0 +1,308 @@
+/******************************************************************************/
+/* Mednafen - Multi-system Emulator                                           */
+/******************************************************************************/
+/* BlockCompressor.cpp:
+**  Copyright (C) 2021 Mednafen Team
+**
+** This program is free software; you can redistribute it and/or
+** modify it under the terms of the GNU General Public License
+** as published by the Free Software Foundation; either version 2
+** of the License, or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <mednafen/mednafen.h>
+#include "BlockCompressor.h"
+
+#include <mednafen/quicklz/quicklz.h>
+#include <minilzo/minilzo.h>
+
+#ifdef HAVE_EXTERNAL_LIBZSTD
+ #include <zstd.h>
+ #include <zdict.h>
+#endif
+
+namespace Mednafen
+{
+
+BlockCompressor::BlockCompressor()
+{
+
+}
+
+BlockCompressor::~BlockCompressor()
+{
+
+}
+
+void BlockCompressor::AddDictionarySample(const void* data, size_t len)
+{
+
+}
+
+void BlockCompressor::TrainDictionary(void)
+{
+
+}
+
+//
+//
+//
+class BlockCompressor_QuickLZ : public BlockCompressor
+{
+ public:
+
+ BlockCompressor_QuickLZ()
+ {
+  memset(scratch_compress, 0, sizeof(scratch_compress));
+  memset(scratch_decompress, 0, sizeof(scratch_decompress));
+ }
+
+ virtual size_t MaxCompressedSize(size_t len) override
+ {
+  return len + 400;
+ }
+
+ virtual size_t Compress(const void* src, size_t len, void* dst) override
+ {
+  return qlz_compress(src, (char*)dst, len, scratch_compress);
+ }
+
+ virtual void Decompress(const void* src, size_t src_len, void* dst, size_t dst_len) override
+ {
+  if(src_len < 9 || qlz_size_compressed((const char*)src) != src_len || qlz_size_decompressed((const char*)src) != dst_len)
+   throw MDFN_Error(0, _("QuickLZ decompression failed: %s"), _("Corrupt data."));
+
+  qlz_decompress((const char*)src, dst, scratch_decompress);
+ }
+
+ private:
+ char scratch_compress[QLZ_SCRATCH_COMPRESS];
+ char scratch_decompress[QLZ_SCRATCH_DECOMPRESS];
+};
+
+//
+//
+//
+class BlockCompressor_LZO : public BlockCompressor
+{
+ public:
+
+ BlockCompressor_LZO() : workmem(new uint8[LZO1X_1_MEM_COMPRESS])
+ {
+
+ }
+
+ virtual size_t MaxCompressedSize(size_t len) override
+ {
+  return len + (len / 16) + 64 + 3;
+ }
+
+ virtual size_t Compress(const void* src, size_t len, void* dst) override
+ {
+  lzo_uint dst_len = MaxCompressedSize(len);
+
+  lzo1x_1_compress((const uint8*)src, len, (uint8*)dst, &dst_len, workmem.get());
+
+  return dst_len;
+ }
+
+ virtual void Decompress(const void* src, size_t src_len, void* dst, size_t dst_len) override
+ {
+  lzo_uint out_len = dst_len;
+  const int res = lzo1x_decompress_safe((const uint8*)src, src_len, (uint8*)dst, &out_len, nullptr);
+
+  if(res != LZO_E_OK || out_len != dst_len)
+   throw MDFN_Error(0, _("LZO decompression failed: %d"), res);
+ }
+
+ private:
+ std::unique_ptr<uint8[]> workmem;
+};
+
+//
+//
+//
+#ifdef HAVE_EXTERNAL_LIBZSTD
+class BlockCompressor_Zstd : public BlockCompressor
+{
+ public:
+
+ enum { Level = 1 };
+ enum : size_t { MaxDictSize = 112640 };
+ enum : size_t { MaxSampleBytes = 16 * 1024 * 1024 };
+
+ BlockCompressor_Zstd() : cctx(nullptr), dctx(nullptr), cdict(nullptr), ddict(nullptr), dict_id(0)
+ {
+  if(!(cctx = ZSTD_createCCtx()) || !(dctx = ZSTD_createDCtx()))
+  {
+   Cleanup();
+   throw MDFN_Error(0, _("%s failed."), "ZSTD_createCCtx()");
+  }
+ }
+
+ virtual ~BlockCompressor_Zstd() override
+ {
+  Cleanup();
+ }
+
+ virtual size_t MaxCompressedSize(size_t len) override
+ {
+  return ZSTD_compressBound(len);
+ }
+
+ virtual size_t Compress(const void* src, size_t len, void* dst) override
+ {
+  size_t res;
+
+  if(cdict)
+   res = ZSTD_compress_usingCDict(cctx, dst, MaxCompressedSize(len), src, len, cdict);
+  else
+   res = ZSTD_compressCCtx(cctx, dst, MaxCompressedSize(len), src, len, Level);
+
+  if(ZSTD_isError(res))
+   throw MDFN_Error(0, _("%s failed: %s"), "ZSTD_compress()", ZSTD_getErrorName(res));
+
+  return res;
+ }
+
+ virtual void Decompress(const void* src, size_t src_len, void* dst, size_t dst_len) override
+ {
+  const unsigned frame_dict_id = ZSTD_getDictID_fromFrame(src, src_len);
+  size_t res;
+
+  if(frame_dict_id)
+  {
+   if(!ddict || frame_dict_id != dict_id)
+    throw MDFN_Error(0, _("%s failed: %s"), "ZSTD_decompress()", _("Unknown dictionary."));
+
+   res = ZSTD_decompress_usingDDict(dctx, dst, dst_len, src, src_len, ddict);
+  }
+  else
+   res = ZSTD_decompressDCtx(dctx, dst, dst_len, src, src_len);
+
+  if(ZSTD_isError(res))
+   throw MDFN_Error(0, _("%s failed: %s"), "ZSTD_decompress()", ZSTD_getErrorName(res));
+
+  if(res != dst_len)
+   throw MDFN_Error(0, _("%s failed: %s"), "ZSTD_decompress()", _("Unexpected decompressed size."));
+ }
+
+ virtual void AddDictionarySample(const void* data, size_t len) override
+ {
+  if(cdict || (samples.size() + len) > MaxSampleBytes)
+   return;
+
+  samples.insert(samples.end(), (const uint8*)data, (const uint8*)data + len);
+  sample_sizes.push_back(len);
+ }
+
+ virtual void TrainDictionary(void) override
+ {
+  if(!cdict && sample_sizes.size())
+  {
+   std::unique_ptr<uint8[]> dict(new uint8[MaxDictSize]);
+   const size_t dict_size = ZDICT_trainFromBuffer(dict.get(), MaxDictSize, &samples[0], &sample_sizes[0], sample_sizes.size());
+
+   // Training fails with too little, or too uniform, sample data; just carry on without a dictionary then.
+   if(!ZDICT_isError(dict_size))
+   {
+    cdict = ZSTD_createCDict(dict.get(), dict_size, Level);
+    ddict = ZSTD_createDDict(dict.get(), dict_size);
+    dict_id = ZDICT_getDictID(dict.get(), dict_size);
+
+    if(!cdict || !ddict || !dict_id)
+    {
+     ZSTD_freeCDict(cdict);
+     ZSTD_freeDDict(ddict);
+     cdict = nullptr;
+     ddict = nullptr;
+     dict_id = 0;
+    }
+   }
+  }
+
+  samples.clear();
+  samples.shrink_to_fit();
+  sample_sizes.clear();
+  sample_sizes.shrink_to_fit();
+ }
+
+ private:
+
+ void Cleanup(void)
+ {
+  ZSTD_freeCDict(cdict);
+  ZSTD_freeDDict(ddict);
+  ZSTD_freeDCtx(dctx);
+  ZSTD_freeCCtx(cctx);
+ }
+
+ ZSTD_CCtx* cctx;
+ ZSTD_DCtx* dctx;
+ ZSTD_CDict* cdict;
+ ZSTD_DDict* ddict;
+ unsigned dict_id;
+
+ std::vector<uint8> samples;
+ std::vector<size_t> sample_sizes;
+};
+#endif
+
+//
+//
+//
+bool BlockCompressor::IsAvailable(const unsigned type)
+{
+ switch(type)
+ {
+  case TYPE_QUICKLZ:
+  case TYPE_LZO:
+	return true;
+
+#ifdef HAVE_EXTERNAL_LIBZSTD
+  case TYPE_ZSTD:
+	return true;
+#endif
+ }
+
+ return false;
+}
+
+const char* BlockCompressor::GetName(const unsigned type)
+{
+ static const char* const names[TYPE__COUNT] = { "QuickLZ", "LZO", "zstd" };
+
+ return (type < TYPE__COUNT) ? names[type] : "?";
+}
+
+BlockCompressor* BlockCompressor::Create(const unsigned type)
+{
+ switch(type)
+ {
+  case TYPE_QUICKLZ:
+	return new BlockCompressor_QuickLZ();
+
+  case TYPE_LZO:
+	return new BlockCompressor_LZO();
+
+  case TYPE_ZSTD:
+#ifdef HAVE_EXTERNAL_LIBZSTD
+	return new BlockCompressor_Zstd();
+#else
+	throw MDFN_Error(0, _("%s compression support was not compiled in; rebuild with --with-external-libzstd."), GetName(type));
+#endif
+ }
+
+ throw MDFN_Error(0, _("Unknown compressor type %u."), type);
+}
+
+}
@@ -0,0 +1,73 @@
+/******************************************************************************/
+/* Mednafen - Multi-system Emulator                                           */
+/******************************************************************************/
+/* BlockCompressor.h:
+**  Copyright (C) 2021 Mednafen Team
+**
+** This program is free software; you can redistribute it and/or
+** modify it under the terms of the GNU General Public License
+** as published by the Free Software Foundation; either version 2
+** of the License, or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef __MDFN_COMPRESS_BLOCKCOMPRESSOR_H
+#define __MDFN_COMPRESS_BLOCKCOMPRESSOR_H
+
+namespace Mednafen
+{
+
+//
+// In-memory compression of independent blocks, used for state rewinding.  Methods may be called from different threads,
+// but never concurrently.
+//
+class BlockCompressor
+{
+ public:
+
+ enum
+ {
+  TYPE_QUICKLZ = 0,
+  TYPE_LZO,
+  TYPE_ZSTD,
+
+  TYPE__COUNT
+ };
+
+ static BlockCompressor* Create(const unsigned type);	// Throws if support for "type" wasn't compiled in.
+ static bool IsAvailable(const unsigned type);
+ static const char* GetName(const unsigned type);
+
+ virtual ~BlockCompressor();
+
+ // Worst-case compressed size for "len" bytes of input.
+ virtual size_t MaxCompressedSize(size_t len) = 0;
+
+ // Returns the compressed size.
+ virtual size_t Compress(const void* src, size_t len, void* dst) = 0;
+
+ // Throws if the compressed data is corrupt, or doesn't decompress to exactly "dst_len" bytes.
+ virtual void Decompress(const void* src, size_t src_len, void* dst, size_t dst_len) = 0;
+
+ //
+ // For compressors that support it, TrainDictionary() builds a dictionary from the data previously passed to
+ // AddDictionarySample(), and uses it for all subsequent compression; data compressed before then remains decompressible.
+ // Does nothing for other compressors, or if a usable dictionary couldn't be built.
+ //
+ virtual void AddDictionarySample(const void* data, size_t len);
+ virtual void TrainDictionary(void);
+
+ protected:
+ BlockCompressor();
+};
+
+}
+#endif
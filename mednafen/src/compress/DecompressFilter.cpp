@@ -22,6 +22,8 @@
 // TODO: Seek testing.
 
 #include <mednafen/mednafen.h>
+#include <mednafen/FileStream.h>
+#include <mednafen/NativeVFS.h>
 #include "DecompressFilter.h"
 
 #include <zlib.h>
@@ -30,7 +32,7 @@ namespace Mednafen
 {
 
 DecompressFilter::DecompressFilter(janky_ptr<Stream> source_stream, const std::string& vfc, uint64 csize, uint64 ucs, uint64 ucrc32) 
-	: ss(std::move(source_stream)), ss_startpos(source_stream->tell()), ss_boundpos(ss_startpos + csize), ss_pos(ss_startpos), uc_size(ucs), running_crc32(0), expected_crc32(ucrc32), vfcontext(vfc)
+	: ss(std::move(source_stream)), ss_startpos(source_stream->tell()), ss_boundpos(ss_startpos + csize), ss_pos(ss_startpos), uc_size(ucs), running_crc32(0), running_crc32_valid(true), expected_crc32(ucrc32), checkpoint_interval(0), next_checkpoint_pos(0), checkpoints_saved(0), vfcontext(vfc)
 {
  position = 0;
  target_position = 0;
@@ -43,22 +45,206 @@ DecompressFilter::~DecompressFilter()
 
 void DecompressFilter::require_fast_seekable(void)
 {
+ if(checkpoint_interval)
+  return;
+
  throw MDFN_Error(0, _("Unable to perform fast seeks on %s."), vfcontext.c_str());
 }
 
+void DecompressFilter::init_checkpoints(void)
+{
+ if(checkpoints.size() || !checkpoint_index_path.size())
+  return;
+
+ try
+ {
+  load_checkpoints();
+ }
+ catch(std::exception&)
+ {
+  checkpoints.clear();
+ }
+}
+
+void DecompressFilter::enable_checkpoints(uint64 interval, const std::string& index_path)
+{
+ assert(interval && !position && !checkpoint_interval);
+
+ checkpoint_interval = interval;
+ next_checkpoint_pos = interval;
+ checkpoint_index_path = index_path;
+
+ init_checkpoints();
+
+ checkpoints_saved = checkpoints.size();
+
+ if(checkpoints.size())
+  next_checkpoint_pos = checkpoints.back().uc_pos + checkpoint_interval;
+}
+
+void DecompressFilter::add_checkpoint(uint64 produced, uint64 cp_ss_pos, uint8 bits, std::vector<uint8> state)
+{
+ const uint64 uc_pos = position + produced;
+
+ if(checkpoints.size() && uc_pos <= checkpoints.back().uc_pos)
+  return;
+
+ checkpoints.push_back({ uc_pos, cp_ss_pos, 0, false, bits, std::move(state) });
+ next_checkpoint_pos = uc_pos + checkpoint_interval;
+}
+
+void DecompressFilter::add_checkpoint_direct(uint64 uc_pos, uint64 cp_ss_pos)
+{
+ assert(!checkpoints.size() || uc_pos > checkpoints.back().uc_pos);
+
+ checkpoints.push_back({ uc_pos, cp_ss_pos, 0, false, 0, std::vector<uint8>() });
+}
+
+uint64 DecompressFilter::read_source_at(uint64 offset, void* data, uint64 count)
+{
+ if(offset >= source_size())
+  return 0;
+
+ ss->seek(ss_startpos + offset, SEEK_SET);
+
+ const uint64 ret = ss->read(data, std::min<uint64>(count, source_size() - offset), false);
+
+ ss->seek(ss_pos, SEEK_SET);
+
+ return ret;
+}
+
+//
+// Index file layout(little-endian):
+//  "MDFNDFCP", version(4), compressed size(8), uncompressed size(8), expected CRC-32(8), checkpoint count(4),
+//  then for each checkpoint: uc_pos(8), ss_pos(8), crc32(4), crc32_valid(1), bits(1), state size(4), state.
+//
+// The sizes and CRC-32 guard against a stale index; they must match this stream's exactly.
+//
+static const uint8 CheckpointIndexMagic[8] = { 'M', 'D', 'F', 'N', 'D', 'F', 'C', 'P' };
+static const uint32 CheckpointIndexVersion = 1;
+
+void DecompressFilter::load_checkpoints(void)
+{
+ std::unique_ptr<Stream> fp(NVFS.open(checkpoint_index_path, VirtualFS::MODE_READ, false, false));
+ uint8 header[8 + 4 + 8 + 8 + 8 + 4];
+
+ if(!fp)
+  return;
+
+ fp->read(header, sizeof(header));
+
+ if(memcmp(header, CheckpointIndexMagic, sizeof(CheckpointIndexMagic)) || MDFN_de32lsb(&header[8]) != CheckpointIndexVersion ||
+	MDFN_de64lsb(&header[12]) != source_size() || MDFN_de64lsb(&header[20]) != uc_size || MDFN_de64lsb(&header[28]) != expected_crc32)
+  return;
+
+ const uint32 count = MDFN_de32lsb(&header[36]);
+
+ for(uint32 i = 0; i < count; i++)
+ {
+  uint8 raw[8 + 8 + 4 + 1 + 1 + 4];
+  Checkpoint cp;
+
+  fp->read(raw, sizeof(raw));
+
+  cp.uc_pos = MDFN_de64lsb(&raw[0]);
+  cp.ss_pos = MDFN_de64lsb(&raw[8]);
+  cp.crc32 = MDFN_de32lsb(&raw[16]);
+  cp.crc32_valid = raw[20];
+  cp.bits = raw[21];
+
+  const uint32 state_size = MDFN_de32lsb(&raw[22]);
+
+  if(state_size > 0x10000 || cp.ss_pos > source_size() || cp.uc_pos > uc_size || (checkpoints.size() && cp.uc_pos <= checkpoints.back().uc_pos))
+   throw MDFN_Error(0, _("Bad checkpoint index."));
+
+  cp.state.resize(state_size);
+
+  if(state_size)
+   fp->read(&cp.state[0], state_size);
+
+  checkpoints.push_back(std::move(cp));
+ }
+}
+
+void DecompressFilter::save_checkpoints(void)
+{
+ const std::string tmp_path = checkpoint_index_path + ".tmp";
+ uint8 header[8 + 4 + 8 + 8 + 8 + 4];
+
+ NVFS.create_missing_dirs(tmp_path);
+ {
+  FileStream fp(tmp_path, FileStream::MODE_WRITE);
+
+  memcpy(&header[0], CheckpointIndexMagic, sizeof(CheckpointIndexMagic));
+  MDFN_en32lsb(&header[8], CheckpointIndexVersion);
+  MDFN_en64lsb(&header[12], source_size());
+  MDFN_en64lsb(&header[20], uc_size);
+  MDFN_en64lsb(&header[28], expected_crc32);
+  MDFN_en32lsb(&header[36], checkpoints.size());
+  fp.write(header, sizeof(header));
+
+  for(auto const& cp : checkpoints)
+  {
+   uint8 raw[8 + 8 + 4 + 1 + 1 + 4];
+
+   MDFN_en64lsb(&raw[0], cp.uc_pos);
+   MDFN_en64lsb(&raw[8], cp.ss_pos);
+   MDFN_en32lsb(&raw[16], cp.crc32);
+   raw[20] = cp.crc32_valid;
+   raw[21] = cp.bits;
+   MDFN_en32lsb(&raw[22], cp.state.size());
+   fp.write(raw, sizeof(raw));
+
+   if(cp.state.size())
+    fp.write(&cp.state[0], cp.state.size());
+  }
+
+  fp.close();
+ }
+ NVFS.rename(tmp_path, checkpoint_index_path);
+
+ checkpoints_saved = checkpoints.size();
+}
+
+static INLINE uint32 UpdateCRC32(uint32 crc, const void* data, uint64 len)
+{
+ // Obviously won't work right if we're read()'ing into weirdly-mapped memory. ;)
+ for(uint64 i = 0, zlmax = ((uInt)(uint64)-1) >> 1; i != len; i += std::min<uint64>(zlmax, len - i))
+  crc = crc32(crc, (Bytef*)data + i, std::min<uint64>(zlmax, len - i));
+
+ return crc;
+}
+
 uint64 DecompressFilter::read_wrap(void* data, uint64 count)
 {
+ const uint64 start_position = position;
  const uint64 ret = read_decompress(data, std::min<uint64>(uc_size - position, count));
 
  position += ret;
 
  assert(position <= uc_size);
 
- if(expected_crc32 != (uint64)-1)
+ if(expected_crc32 != (uint64)-1 && running_crc32_valid)
  {
-  // Obviously won't work right if we're read()'ing into weirdly-mapped memory. ;)
-  for(uint64 i = 0, zlmax = ((uInt)(uint64)-1) >> 1; i != ret; i += std::min<uint64>(zlmax, ret - i))
-   running_crc32 = crc32(running_crc32, (Bytef*)data + i, std::min<uint64>(zlmax, ret - i));
+  uint64 done = 0;
+
+  //
+  // Fill in the CRC-32 of checkpoints within the data just read.
+  //
+  for(auto it = std::lower_bound(checkpoints.begin(), checkpoints.end(), start_position, [](const Checkpoint& cp, uint64 pos) { return cp.uc_pos < pos; }); it != checkpoints.end() && it->uc_pos <= position; ++it)
+  {
+   running_crc32 = UpdateCRC32(running_crc32, (uint8*)data + done, (it->uc_pos - start_position) - done);
+   done = it->uc_pos - start_position;
+
+   if(!it->crc32_valid)
+   {
+    it->crc32 = running_crc32;
+    it->crc32_valid = true;
+   }
+  }
+
+  running_crc32 = UpdateCRC32(running_crc32, (uint8*)data + done, ret - done);
 
   if(position == uc_size)
   {
@@ -79,14 +265,33 @@ uint64 DecompressFilter::read(void *data, uint64 count, bool error_on_eos)
 
  try
  {
-  if(target_position < position)
+  if(target_position != position)
   {
-   //puts("REWIND");
-   ss_pos = ss_startpos;
-   position = 0;
-   running_crc32 = 0;
-   //
-   reset_decompress();
+   auto it = std::upper_bound(checkpoints.begin(), checkpoints.end(), target_position, [](uint64 pos, const Checkpoint& cp) { return pos < cp.uc_pos; });
+   const Checkpoint* cp = (it != checkpoints.begin()) ? &*(it - 1) : nullptr;
+
+   if(cp && (target_position < position || cp->uc_pos > position))
+   {
+    ss_pos = ss_startpos + cp->ss_pos;
+    position = cp->uc_pos;
+    running_crc32 = cp->crc32;
+    running_crc32_valid = cp->crc32_valid;
+    //
+    if(ss->tell() != ss_pos)
+     ss->seek(ss_pos, SEEK_SET);
+
+    restore_checkpoint(*cp);
+   }
+   else if(target_position < position)
+   {
+    //puts("REWIND");
+    ss_pos = ss_startpos;
+    position = 0;
+    running_crc32 = 0;
+    running_crc32_valid = true;
+    //
+    reset_decompress();
+   }
   }
 
   if(ss->tell() != ss_pos)
@@ -181,6 +386,18 @@ uint64 DecompressFilter::size(void)
 
 void DecompressFilter::close(void)
 {
+ if(checkpoint_index_path.size() && checkpoints.size() > checkpoints_saved)
+ {
+  try
+  {
+   save_checkpoints();
+  }
+  catch(std::exception&)
+  {
+   checkpoints_saved = checkpoints.size();
+  }
+ }
+
  close_decompress();
 
  ss.reset();
@@ -190,7 +407,7 @@ uint64 DecompressFilter::attributes(void)
 {
  uint64 ret = ss->attributes() & (ATTRIBUTE_READABLE | ATTRIBUTE_SEEKABLE);
 
- if(ret & ATTRIBUTE_SEEKABLE)
+ if((ret & ATTRIBUTE_SEEKABLE) && !checkpoint_interval)
   ret |= ATTRIBUTE_SLOW_SEEK;
 
  if(uc_size == (uint64)-1)
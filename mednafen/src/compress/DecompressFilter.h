@@ -44,6 +44,19 @@ class DecompressFilter : public Stream
   std::unique_ptr<T> up;
  };
 
+ //
+ // A point in the stream from which decompression can be restarted, without decompressing everything before it.
+ //
+ struct Checkpoint
+ {
+  uint64 uc_pos;	// Position in the decompressed data.
+  uint64 ss_pos;	// Position in the compressed data, relative to its start.
+  uint32 crc32;		// CRC-32 of the decompressed data before uc_pos, if crc32_valid.
+  bool crc32_valid;
+  uint8 bits;		// Decompressor-specific state needed to restart; e.g. a bit offset and
+  std::vector<uint8> state;	// the inflate window.
+ };
+
 
  DecompressFilter(janky_ptr<Stream> source_stream, const std::string& vfcontext, uint64 csize, uint64 ucs = (uint64)-1, uint64 ucrc32 = (uint64)-1);
  virtual ~DecompressFilter() override;
@@ -59,12 +72,51 @@ class DecompressFilter : public Stream
 
  virtual void require_fast_seekable(void) override;
 
+ //
+ // Enables recording a checkpoint about every "interval" bytes of decompressed data as the stream is read, so that a
+ // later seek only has to decompress from the nearest checkpoint before the target position instead of from the start.
+ // Also makes require_fast_seekable() succeed.
+ //
+ // If "index_path" isn't empty, checkpoints are loaded from that file, and saved to it when the stream is closed if more
+ // were recorded; errors doing either are ignored.
+ //
+ void enable_checkpoints(uint64 interval, const std::string& index_path = std::string());
+
  virtual uint64 read_decompress(void* data, uint64 count) = 0;
  virtual void reset_decompress(void) = 0;
  virtual void close_decompress(void) = 0;
 
  protected:
 
+ //
+ // Called with the source stream position already set to cp.ss_pos; the decompressor should discard any buffered
+ // input and restart decompression as of "cp".
+ //
+ virtual void restore_checkpoint(const Checkpoint& cp) = 0;
+
+ // Called by enable_checkpoints() to set up the initial checkpoints; loads the index file, if any.  Overridden by
+ // formats that carry their own seek index, which call this if they add no checkpoints of their own.
+ virtual void init_checkpoints(void);
+
+ INLINE bool checkpoints_enabled(void) const { return checkpoint_interval != 0; }
+
+ // For use by read_decompress(), where "produced" is the number of bytes decompressed so far by the current call.
+ INLINE bool checkpoint_due(uint64 produced) const
+ {
+  return checkpoint_interval && (position + produced) >= next_checkpoint_pos;
+ }
+ void add_checkpoint(uint64 produced, uint64 cp_ss_pos, uint8 bits, std::vector<uint8> state);
+
+ // For use by init_checkpoints(); must be called in order of increasing uc_pos.
+ void add_checkpoint_direct(uint64 uc_pos, uint64 cp_ss_pos);
+
+ INLINE uint64 source_tell(void) const { return ss_pos - ss_startpos; }
+ INLINE uint64 source_size(void) const { return ss_boundpos - ss_startpos; }
+ uint64 read_source_at(uint64 offset, void* data, uint64 count);
+
+ INLINE uint64 get_uncompressed_size(void) const { return uc_size; }
+ INLINE void set_uncompressed_size(uint64 ucs) { uc_size = ucs; }
+
  uint64 read_wrap(void* data, uint64 count);
 
  INLINE uint64 read_source(void* data, uint64 count)
@@ -87,8 +139,18 @@ class DecompressFilter : public Stream
  uint64 uc_size;
 
  uint32 running_crc32;
+ bool running_crc32_valid;	// false after restoring a checkpoint without a CRC-32.
  const uint64 expected_crc32;
 
+ void load_checkpoints(void);
+ void save_checkpoints(void);
+
+ std::vector<Checkpoint> checkpoints;	// Sorted by uc_pos.
+ uint64 checkpoint_interval;
+ uint64 next_checkpoint_pos;
+ size_t checkpoints_saved;
+ std::string checkpoint_index_path;
+
  protected:
  std::string vfcontext;
 };
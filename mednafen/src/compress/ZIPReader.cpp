@@ -20,6 +20,8 @@
 */
 
 #include <mednafen/mednafen.h>
+#include <mednafen/general.h>
+#include <mednafen/hash/md5.h>
 
 #include "ZIPReader.h"
 #include "ZLInflateFilter.h"
@@ -35,11 +37,21 @@ enum : bool { EnableZstandardCRC32Check = false };
 //
 //
 //
+class ZSLock
+{
+ public:
+ INLINE ZSLock(MThreading::Mutex* m) : mutex(m) { MThreading::Mutex_Lock(mutex); }
+ INLINE ~ZSLock() { MThreading::Mutex_Unlock(mutex); }
+
+ private:
+ MThreading::Mutex* mutex;
+};
+
 class StreamViewFilter : public Stream
 {
  public:
 
- StreamViewFilter(Stream* source_stream, const std::string& vfc, uint64 sp, uint64 bp, uint64 expcrc32 = (uint64)-1);
+ StreamViewFilter(std::shared_ptr<Stream> source_stream, std::shared_ptr<MThreading::Mutex> source_mutex, const std::string& vfc, uint64 sp, uint64 bp, uint64 expcrc32 = (uint64)-1);
  virtual ~StreamViewFilter() override;
  virtual uint64 read(void *data, uint64 count, bool error_on_eos = true) override;
  virtual void write(const void *data, uint64 count) override;
@@ -52,7 +64,8 @@ class StreamViewFilter : public Stream
  virtual void flush(void) override;
 
  private:
- Stream* ss;
+ std::shared_ptr<Stream> ss;
+ std::shared_ptr<MThreading::Mutex> ss_mutex;
  uint64 ss_start_pos;
  uint64 ss_bound_pos;
 
@@ -64,7 +77,7 @@ class StreamViewFilter : public Stream
  const std::string vfcontext;
 };
 
-StreamViewFilter::StreamViewFilter(Stream* source_stream, const std::string& vfc, uint64 sp, uint64 bp, uint64 expcrc32) : ss(source_stream), ss_start_pos(sp), ss_bound_pos(bp), pos(0), running_crc32(0), running_crc32_posreached(0), expected_crc32(expcrc32), vfcontext(vfc)
+StreamViewFilter::StreamViewFilter(std::shared_ptr<Stream> source_stream, std::shared_ptr<MThreading::Mutex> source_mutex, const std::string& vfc, uint64 sp, uint64 bp, uint64 expcrc32) : ss(std::move(source_stream)), ss_mutex(std::move(source_mutex)), ss_start_pos(sp), ss_bound_pos(bp), pos(0), running_crc32(0), running_crc32_posreached(0), expected_crc32(expcrc32), vfcontext(vfc)
 {
  if(ss_bound_pos < ss_start_pos)
   throw MDFN_Error(0, _("StreamViewFilter() bound_pos < start_pos"));
@@ -90,10 +103,14 @@ uint64 StreamViewFilter::read(void *data, uint64 count, bool error_on_eos)
  if(cc < count && error_on_eos)
   throw MDFN_Error(0, _("Error reading from %s: %s"), vfcontext.c_str(), _("Unexpected EOF"));
 
- if(ss->tell() != (ss_start_pos + pos))
-  ss->seek(ss_start_pos + pos, SEEK_SET);
+ {
+  ZSLock lock(ss_mutex.get());
 
- ret = ss->read(data, cc, error_on_eos);
+  if(ss->tell() != (ss_start_pos + pos))
+   ss->seek(ss_start_pos + pos, SEEK_SET);
+
+  ret = ss->read(data, cc, error_on_eos);
+ }
  pos += ret;
 
  if(expected_crc32 != (uint64)-1)
@@ -126,6 +143,8 @@ void StreamViewFilter::write(const void *data, uint64 count)
  if(cc < count)
   throw MDFN_Error(0, _("ASDF"));
 
+ ZSLock lock(ss_mutex.get());
+
  if(ss->tell() != (ss_start_pos + pos))
   ss->seek(ss_start_pos + pos, SEEK_SET);
 
@@ -185,7 +204,8 @@ uint64 StreamViewFilter::size(void)
 
 void StreamViewFilter::close(void)
 {
- ss = nullptr;
+ ss.reset();
+ ss_mutex.reset();
 }
 
 uint64 StreamViewFilter::attributes(void)
@@ -238,8 +258,6 @@ Stream* ZIPReader::open(size_t which)
  }
  //
  //
- zs->seek(e.lh_reloffs, SEEK_SET);
-
  struct
  {
   uint32 sig;
@@ -256,8 +274,14 @@ Stream* ZIPReader::open(size_t which)
  } lfh;
  uint8 lfh_raw[0x1E];
 
- if(zs->read(lfh_raw, sizeof(lfh_raw), false) != sizeof(lfh_raw))
-  throw MDFN_Error(0, _("Unexpected EOF when reading ZIP Local File Header."));
+ {
+  ZSLock lock(zs_mutex.get());
+
+  zs->seek(e.lh_reloffs, SEEK_SET);
+
+  if(zs->read(lfh_raw, sizeof(lfh_raw), false) != sizeof(lfh_raw))
+   throw MDFN_Error(0, _("Unexpected EOF when reading ZIP Local File Header."));
+ }
 
  lfh.sig          = MDFN_de32lsb(&lfh_raw[0x00]);
  lfh.version_need = MDFN_de16lsb(&lfh_raw[0x04]);
@@ -280,26 +304,64 @@ Stream* ZIPReader::open(size_t which)
  if(lfh.gpflags & 0x1)
   throw MDFN_Error(0, _("ZIP decryption support not implemented."));
 
- zs->seek(lfh.name_len + lfh.extra_len, SEEK_CUR);
-
+ const uint64 start_pos = e.lh_reloffs + sizeof(lfh_raw) + lfh.name_len + lfh.extra_len;
  const std::string vfcontext = MDFN_sprintf(_("opened file %s"), this->get_human_path(e.name).c_str());
 
- return make_stream(zs.get(), vfcontext, e.method, e.comp_size, e.uncomp_size, e.crc32);
+ return make_stream(start_pos, vfcontext, e.method, e.comp_size, e.uncomp_size, e.crc32);
+}
+
+//
+// Name of the seek index file for a compressed file, derived from its size, CRC-32, and the start and end of its
+// compressed data("s").
+//
+static std::string make_seekindex_path(Stream* s, const uint16 method, const uint64 comp_size, const uint64 uncomp_size, const uint32 crc)
+{
+ const uint64 edge_size = std::min<uint64>(comp_size, 4096);
+ std::unique_ptr<uint8[]> tmp(new uint8[edge_size]);
+ uint8 raw[2 + 8 + 8 + 4];
+ md5_hasher h;
+
+ MDFN_en16lsb(&raw[0], method);
+ MDFN_en64lsb(&raw[2], comp_size);
+ MDFN_en64lsb(&raw[10], uncomp_size);
+ MDFN_en32lsb(&raw[18], crc);
+ h.process(raw, sizeof(raw));
+
+ s->read(tmp.get(), edge_size);
+ h.process(tmp.get(), edge_size);
+
+ s->seek(comp_size - edge_size, SEEK_SET);
+ s->read(tmp.get(), edge_size);
+ h.process(tmp.get(), edge_size);
+
+ s->seek(0, SEEK_SET);
+
+ return MDFN_MakeFName(MDFNMKF_SEEKINDEX, 0, md5_context::asciistr(&h.digest()[0], false) + ".idx");
 }
 
-Stream* ZIPReader::make_stream(Stream* s, std::string vfcontext, const uint16 method, const uint64 comp_size, const uint64 uncomp_size, const uint32 crc)
+Stream* ZIPReader::make_stream(const uint64 start_pos, std::string vfcontext, const uint16 method, const uint64 comp_size, const uint64 uncomp_size, const uint32 crc)
 {
  if(method == 0)
+  return new StreamViewFilter(zs, zs_mutex, vfcontext, start_pos, start_pos + uncomp_size, crc);
+ else if(method == 8 || method == 93 || method == 20)
  {
-  uint64 start_pos = s->tell();
-  uint64 bound_pos = start_pos + uncomp_size;
+  //
+  // Restart points for seeking; about 512 per file, but no closer than 1MiB apart.
+  //
+  std::unique_ptr<Stream> cs(new StreamViewFilter(zs, zs_mutex, vfcontext, start_pos, start_pos + comp_size));
+  const uint64 interval = std::max<uint64>(1024 * 1024, uncomp_size / 512);
+  const std::string index_path = (uncomp_size > interval && MDFN_GetSettingB("filesys.seekindex")) ? make_seekindex_path(cs.get(), method, comp_size, uncomp_size, crc) : std::string();
+  std::unique_ptr<DecompressFilter> ret;
+
+  if(method == 8)
+   ret.reset(new ZLInflateFilter(std::move(cs), vfcontext, ZLInflateFilter::FORMAT::RAW, comp_size, uncomp_size, crc));
+  else
+   ret.reset(new ZstdDecompressFilter(std::move(cs), vfcontext, comp_size, uncomp_size, EnableZstandardCRC32Check ? crc : (uint64)-1));
+
+  ret->enable_checkpoints(interval, index_path);
 
-  return new StreamViewFilter(s, vfcontext, start_pos, bound_pos, crc);
+  return ret.release();
  }
- else if(method == 8)
-  return new ZLInflateFilter(s, vfcontext, ZLInflateFilter::FORMAT::RAW, comp_size, uncomp_size, crc);
- else if(method == 93 || method == 20)
-  return new ZstdDecompressFilter(s, vfcontext, comp_size, uncomp_size, EnableZstandardCRC32Check ? crc : (uint64)-1);
  //else if(method == 97) // TODO, maybe?
  // return new WAVPackDecodeFilter(s, vfcontext, comp_size, uncomp_size, crc);
  else
@@ -475,6 +537,7 @@ ZIPReader::ZIPReader(std::unique_ptr<Stream> s)
  read_central_directory(s.get(), size, eocdr.total_cde_count);
 
  zs = std::move(s);
+ zs_mutex.reset(MThreading::Mutex_Create(), MThreading::Mutex_Destroy);
 }
 
 static std::string canonicalize_zip_path(const std::string& name)
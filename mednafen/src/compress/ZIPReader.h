@@ -23,6 +23,7 @@
 #define __MDFN_COMPRESS_ZIPREADER_H
 
 #include "ArchiveReader.h"
+#include <mednafen/MThreading.h>
 
 namespace Mednafen
 {
@@ -72,7 +73,7 @@ class ZIPReader : public ArchiveReader
  };
 
  void read_central_directory(Stream* s, const uint64 zip_size, const uint64 total_cde_count);
- Stream* make_stream(Stream* s, std::string vfcontext, const uint16 method, const uint64 comp_size, const uint64 uncomp_size, const uint32 crc);
+ Stream* make_stream(const uint64 start_pos, std::string vfcontext, const uint16 method, const uint64 comp_size, const uint64 uncomp_size, const uint32 crc);
 
  struct FileEntry
  {
@@ -87,7 +88,12 @@ class ZIPReader : public ArchiveReader
   uint16 method;
  };
 
- std::unique_ptr<Stream> zs;
+ //
+ // Shared with opened files, so they remain usable after the ZIPReader is destroyed, and from threads other
+ // than the one that opened them; zs_mutex must be held while seeking in and reading from zs.
+ //
+ std::shared_ptr<Stream> zs;
+ std::shared_ptr<MThreading::Mutex> zs_mutex;
  std::vector<FileEntry> entries;
  std::map<std::string, size_t > entries_map;
 
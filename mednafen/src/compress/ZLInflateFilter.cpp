@@ -26,7 +26,7 @@ namespace Mednafen
 {
 
 ZLInflateFilter::ZLInflateFilter(janky_ptr<Stream> source_stream, const std::string& vfc, FORMAT df, uint64 csize, uint64 ucs, uint64 ucrc32) 
-	: DecompressFilter(std::move(source_stream), vfc, csize, ucs, ucrc32)
+	: DecompressFilter(std::move(source_stream), vfc, csize, ucs, ucrc32), format(df), raw_restored(false), trailer_skip(0)
 {
  int irc;
  int iiwbits;
@@ -54,6 +54,8 @@ ZLInflateFilter::ZLInflateFilter(janky_ptr<Stream> source_stream, const std::str
 	break;
  }
 
+ window_bits = iiwbits;
+
  memset(&zs, 0, sizeof(zs));
  irc = inflateInit2(&zs, iiwbits);
 
@@ -76,16 +78,45 @@ ZLInflateFilter::~ZLInflateFilter()
 void ZLInflateFilter::reset_decompress(void)
 {
  zs.avail_in = 0;
+ raw_restored = false;
+ trailer_skip = 0;
  //
- int irc = inflateReset(&zs);
+ int irc = inflateReset2(&zs, window_bits);
 
  if(MDFN_UNLIKELY(irc < 0))
   throw MDFN_Error(0, _("Error seeking in %s: inflateReset() failed: %d"), vfcontext.c_str(), irc);
 }
 
+//
+// Checkpoints are taken at deflate block boundaries, as in zlib's "zran" example; restarting requires the bit offset
+// into the next byte of input(with the partially-consumed byte itself saved as state[0]), and the 32KiB window.
+//
+void ZLInflateFilter::restore_checkpoint(const Checkpoint& cp)
+{
+ int irc;
+
+ if(cp.state.size() < 1 || cp.bits > 7)
+  throw MDFN_Error(0, _("Error seeking in %s: %s"), vfcontext.c_str(), _("Bad checkpoint."));
+
+ zs.avail_in = 0;
+ trailer_skip = 0;
+
+ if((irc = inflateReset2(&zs, -15)) < 0)
+  throw MDFN_Error(0, _("Error seeking in %s: inflateReset2() failed: %d"), vfcontext.c_str(), irc);
+
+ if(cp.bits && (irc = inflatePrime(&zs, cp.bits, cp.state[0] >> (8 - cp.bits))) < 0)
+  throw MDFN_Error(0, _("Error seeking in %s: inflatePrime() failed: %d"), vfcontext.c_str(), irc);
+
+ if(cp.state.size() > 1 && (irc = inflateSetDictionary(&zs, &cp.state[1], cp.state.size() - 1)) < 0)
+  throw MDFN_Error(0, _("Error seeking in %s: inflateSetDictionary() failed: %d"), vfcontext.c_str(), irc);
+
+ raw_restored = (format != FORMAT::RAW);
+}
+
 
 uint64 ZLInflateFilter::read_decompress(void* data, uint64 count)
 {
+ const bool checkpointing = checkpoints_enabled() && format != FORMAT::AUTO_ZGZ;
  bool stream_end = false;
 
  zs.next_out = (Bytef*)data;
@@ -101,6 +132,23 @@ uint64 ZLInflateFilter::read_decompress(void* data, uint64 count)
    zs.avail_in = read_source(buf, sizeof(buf));
   }
 
+  if(trailer_skip)
+  {
+   const uInt skip = std::min<uInt>(trailer_skip, zs.avail_in);
+
+   zs.next_in += skip;
+   zs.avail_in -= skip;
+   trailer_skip -= skip;
+
+   if(trailer_skip || !zs.avail_in)
+   {
+    if(!skip)
+     break;
+
+    continue;
+   }
+  }
+
   if(stream_end)
   {
    if(zs.avail_in)
@@ -125,7 +173,7 @@ uint64 ZLInflateFilter::read_decompress(void* data, uint64 count)
 
   zs.total_out = 0;
   //printf("inflate: stream_end=%d, zs.avail_in=%d\n", stream_end, zs.avail_in);
-  irc = inflate(&zs, no_more_input ? Z_SYNC_FLUSH : Z_NO_FLUSH);
+  irc = inflate(&zs, checkpointing ? Z_BLOCK : (no_more_input ? Z_SYNC_FLUSH : Z_NO_FLUSH));
   //printf(" return: %d\n", irc);
   if(MDFN_UNLIKELY(irc < 0))
   {
@@ -137,6 +185,39 @@ uint64 ZLInflateFilter::read_decompress(void* data, uint64 count)
     throw MDFN_Error(0, _("Error reading from %s: zlib error %d"), vfcontext.c_str(), irc);
   }
 
+  //
+  // At a block boundary(that's not the end of the stream)?
+  //
+  if(checkpointing && (zs.data_type & 128) && !(zs.data_type & 64) && irc != Z_STREAM_END)
+  {
+   const uint64 produced = zs.next_out - (Bytef*)data;
+   const unsigned bits = zs.data_type & 7;
+
+   // (A partially-consumed byte must still be in the buffer)
+   if(checkpoint_due(produced) && (!bits || zs.next_in != buf))
+   {
+    std::vector<uint8> state(1 + 32768);
+    uInt dict_len = 32768;
+
+    state[0] = bits ? zs.next_in[-1] : 0;
+    inflateGetDictionary(&zs, &state[1], &dict_len);
+    state.resize(1 + dict_len);
+
+    add_checkpoint(produced, source_tell() - zs.avail_in, bits, std::move(state));
+   }
+  }
+
+  if(irc == Z_STREAM_END && raw_restored)
+  {
+   int reset_irc;
+
+   trailer_skip = (format == FORMAT::GZIP) ? 8 : 4;
+   raw_restored = false;
+
+   if(MDFN_UNLIKELY((reset_irc = inflateReset2(&zs, window_bits)) < 0))
+    throw MDFN_Error(0, _("Error reading from %s: inflateReset2() failed: %d"), vfcontext.c_str(), reset_irc);
+  }
+
   if(no_more_input)
   {
    //if(irc != Z_STREAM_END)
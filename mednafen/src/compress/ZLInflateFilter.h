@@ -49,9 +49,16 @@ class ZLInflateFilter : public DecompressFilter
  virtual void reset_decompress(void) override;
  virtual void close_decompress(void) override;
 
+ protected:
+ virtual void restore_checkpoint(const Checkpoint& cp) override;
+
  private:
 
  z_stream zs;
+ const FORMAT format;
+ int window_bits;
+ bool raw_restored;	// Restarted from a checkpoint in raw mode; the zlib/gzip trailer must be skipped manually.
+ uint32 trailer_skip;
  uint8 buf[8192];
 };
 
@@ -46,6 +46,79 @@ void ZstdDecompressFilter::reset_decompress(void)
  ib.size = 0;
 }
 
+//
+// Frames are independent, so a checkpoint is just a frame's position.
+//
+void ZstdDecompressFilter::restore_checkpoint(const Checkpoint& cp)
+{
+ reset_decompress();
+}
+
+void ZstdDecompressFilter::init_checkpoints(void)
+{
+ read_seek_table();
+
+ DecompressFilter::init_checkpoints();	// Does nothing if the seek table provided checkpoints.
+}
+
+//
+// Frame positions are taken from the seek table of the zstd "seekable format", if present: a skippable frame at
+// the end of the stream, holding a compressed and decompressed size(and, optionally, a checksum) for each frame,
+// followed by a 9-byte footer.
+//
+void ZstdDecompressFilter::read_seek_table(void)
+{
+ static const uint32 SeekTableMagic = 0x8F92EAB1;
+ static const uint32 SkippableMagic = 0x184D2A5E;
+ const uint64 ss_size = source_size();
+ uint8 footer[9];
+
+ if(ss_size < 8 + sizeof(footer) || read_source_at(ss_size - sizeof(footer), footer, sizeof(footer)) != sizeof(footer))
+  return;
+
+ if(MDFN_de32lsb(&footer[5]) != SeekTableMagic || (footer[4] & 0x7C))
+  return;
+
+ const uint32 num_frames = MDFN_de32lsb(&footer[0]);
+ const uint32 entry_size = (footer[4] & 0x80) ? 12 : 8;
+ const uint64 table_size = (uint64)num_frames * entry_size + sizeof(footer);
+ uint8 header[8];
+
+ if(!num_frames || ss_size < 8 + table_size)
+  return;
+
+ if(read_source_at(ss_size - table_size - 8, header, 8) != 8 || MDFN_de32lsb(&header[0]) != SkippableMagic || MDFN_de32lsb(&header[4]) != table_size)
+  return;
+
+ std::unique_ptr<uint8[]> table(new uint8[num_frames * entry_size]);
+ uint64 c_pos = 0;
+ uint64 d_pos = 0;
+ uint64 last_cp_d_pos = 0;
+
+ if(read_source_at(ss_size - table_size, table.get(), num_frames * entry_size) != num_frames * entry_size)
+  return;
+
+ for(uint32 i = 0; i < num_frames; i++)
+ {
+  const uint8* e = &table[i * entry_size];
+
+  if(d_pos > last_cp_d_pos)
+  {
+   add_checkpoint_direct(d_pos, c_pos);
+   last_cp_d_pos = d_pos;
+  }
+
+  c_pos += MDFN_de32lsb(&e[0]);
+  d_pos += MDFN_de32lsb(&e[4]);
+ }
+
+ if(c_pos > ss_size - table_size - 8)
+  throw MDFN_Error(0, _("Error reading from %s: %s"), vfcontext.c_str(), _("Bad zstd seek table."));
+
+ if(get_uncompressed_size() == (uint64)-1)
+  set_uncompressed_size(d_pos);
+}
+
 ZstdDecompressFilter::~ZstdDecompressFilter()
 {
  try
@@ -86,6 +159,10 @@ uint64 ZstdDecompressFilter::read_decompress(void* data, uint64 count)
    const size_t res = ZSTD_decompressStream(zs, &ob, &ib);
    if(ZSTD_isError(res))
     throw MDFN_Error(0, _("Error reading from %s: %s failed: %s"), vfcontext.c_str(), "ZSTD_decompressStream()", ZSTD_getErrorName(res));
+
+   // At a frame boundary?
+   if(!res && checkpoint_due(ob.pos))
+    add_checkpoint(ob.pos, source_tell() - (ib.size - ib.pos), 0, std::vector<uint8>());
   } while(ob.pos != ob.size && ib.size);
  }
 
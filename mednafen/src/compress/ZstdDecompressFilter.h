@@ -40,7 +40,13 @@ class ZstdDecompressFilter : public DecompressFilter
  virtual void reset_decompress(void) override;
  virtual void close_decompress(void) override;
 
+ protected:
+ virtual void restore_checkpoint(const Checkpoint& cp) override;
+ virtual void init_checkpoints(void) override;
+
  private:
+ void read_seek_table(void);
+
  ZSTD_DStream* zs;
  ZSTD_inBuffer ib;
 
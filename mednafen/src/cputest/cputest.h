@@ -44,6 +44,9 @@ extern "C" {
 #define CPUTEST_FLAG_AVX          0x4000 ///< AVX functions: requires OS support even if YMM registers aren't used
 
 #define CPUTEST_FLAG_CMOV	  0x8000 // CMOVcc support (Mednafen addition)
+#define CPUTEST_FLAG_AVX2	  0x1000 // AVX2 functions; implies OS support for YMM registers (Mednafen addition)
+#define CPUTEST_FLAG_FMA3	  0x0800 // FMA3 functions; implies OS support for YMM registers (Mednafen addition)
+#define CPUTEST_FLAG_AVX512	  0x2000 // AVX-512 F, BW, DQ, and VL functions; implies OS support for ZMM and opmask registers (Mednafen addition)
 
 //#define CPUTEST_FLAG_IWMMXT       0x0100 ///< XScale IWMMXT
 #define CPUTEST_FLAG_ALTIVEC      0x0001 ///< standard
@@ -35,6 +35,15 @@
            "=c" (ecx), "=d" (edx)\
          : "0" (index));
 
+#define cpuid_count(index,count,eax,ebx,ecx,edx)\
+    __asm__ volatile\
+        ("mov %%"REG_b", %%"REG_S"\n\t"\
+         "cpuid\n\t"\
+         "xchg %%"REG_b", %%"REG_S\
+         : "=a" (eax), "=S" (ebx),\
+           "=c" (ecx), "=d" (edx)\
+         : "0" (index), "2" (count));
+
 #define xgetbv(index,eax,edx)                                   \
     __asm__ (".byte 0x0f, 0x01, 0xd0" : "=a"(eax), "=d"(edx) : "c" (index))
 
@@ -110,6 +119,24 @@ int ff_get_cpu_flags_x86(void)
                 rval |= CPUTEST_FLAG_AVX;
         }
 //#endif
+	// Mednafen addition(fma3):
+	if ((rval & CPUTEST_FLAG_AVX) && (ecx & (1<<12)))
+	    rval |= CPUTEST_FLAG_FMA3;
+
+	// Mednafen addition(avx2):
+	if ((rval & CPUTEST_FLAG_AVX) && max_std_level >= 7) {
+	    cpuid_count(7, 0, eax, ebx, ecx, edx);
+	    if (ebx & (1<<5))
+	        rval |= CPUTEST_FLAG_AVX2;
+
+	    // Mednafen addition(avx512):
+	    if ((ebx & 0xC0030000) == 0xC0030000) {
+	        /* Check for OS support of opmask and ZMM state */
+	        xgetbv(0, eax, edx);
+	        if ((eax & 0xE6) == 0xE6)
+	            rval |= CPUTEST_FLAG_AVX512;
+	    }
+	}
 //#endif
                   ;
     }
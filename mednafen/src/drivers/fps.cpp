@@ -18,6 +18,7 @@
 #include "main.h"
 #include "video.h"
 #include "fps.h"
+#include "sound.h"
 
 #include <trio/trio.h>
 
@@ -69,7 +70,7 @@ void FPS_Init(const unsigned fps_pos, const unsigned fps_scale, const unsigned f
 
  FPSRect.x = FPSRect.y = 0;
  FPSRect.w = 6 * font_width;
- FPSRect.h = 3 * font_height;
+ FPSRect.h = 5 * font_height;	// 2 more lines for sound rate control, if enabled.
 
  FPSSurface = new MDFN_Surface(NULL, FPSRect.w, FPSRect.h, FPSRect.w, MDFN_PixelFormat::ABGR32_8888);
 }
@@ -186,7 +187,14 @@ void FPS_DrawToScreen(const MDFN_PixelFormat& pf, const MDFN_Rect& cr, unsigned
 
  FPSSurface->SetFormat(pf, false);
  //
- const unsigned eff_scale = scale ? scale : std::max<unsigned>(1, /*std::min(cr.w, cr.h)*/min_screen_w_h / std::max(FPSRect.w, FPSRect.h) / 8);
+ float rc_fill_ms, rc_ppm;
+ const bool rc_active = Sound_GetRateControlStatus(&rc_fill_ms, &rc_ppm);
+ MDFN_Rect srect = FPSRect;
+
+ if(!rc_active)
+  srect.h = 3 * font_height;
+
+ const unsigned eff_scale = scale ? scale : std::max<unsigned>(1, /*std::min(cr.w, cr.h)*/min_screen_w_h / std::max(srect.w, srect.h) / 8);
  char virtfps[32], drawnfps[32], blitfps[32];
  const uint32 surf_text_color = FPSSurface->MakeColor((text_color >> 16) & 0xFF, (text_color >> 8) & 0xFF, (text_color >> 0) & 0xFF, (text_color >> 24) & 0xFF);
 
@@ -197,12 +205,23 @@ void FPS_DrawToScreen(const MDFN_PixelFormat& pf, const MDFN_Rect& cr, unsigned
  DrawText(FPSSurface, 0, font_height * 0, virtfps, surf_text_color, font);
  DrawText(FPSSurface, 0, font_height * 1, drawnfps, surf_text_color, font);
  DrawText(FPSSurface, 0, font_height * 2, blitfps, surf_text_color, font);
+
+ if(rc_active)
+ {
+  char rcfill[32], rcppm[32];
+
+  trio_snprintf(rcfill, sizeof(rcfill), "%.1fms", rc_fill_ms);
+  trio_snprintf(rcppm, sizeof(rcppm), "%+.0fp", rc_ppm);
+
+  DrawText(FPSSurface, 0, font_height * 3, rcfill, surf_text_color, font);
+  DrawText(FPSSurface, 0, font_height * 4, rcppm, surf_text_color, font);
+ }
  //
  //
  MDFN_Rect drect;
 
- drect.w = FPSRect.w * eff_scale;
- drect.h = FPSRect.h * eff_scale;
+ drect.w = srect.w * eff_scale;
+ drect.h = srect.h * eff_scale;
 
  switch(position)
  {
@@ -226,5 +245,5 @@ void FPS_DrawToScreen(const MDFN_PixelFormat& pf, const MDFN_Rect& cr, unsigned
 	drect.y = cr.y + (cr.h - drect.h) / 2;
 	break;
  }
- BlitOSD(FPSSurface, &FPSRect, &drect, -1);
+ BlitOSD(FPSSurface, &srect, &drect, -1);
 }
@@ -1163,6 +1163,7 @@ enum CommandKey
 	CK_POWER,
 	CK_EXIT,
 	CK_STATE_REWIND,
+	CK_STATE_REWIND_SEEK,
 	CK_ROTATESCREEN,
 	CK_TOGGLENETVIEW,
 	CK_ADVANCE_FRAME,
@@ -1300,6 +1301,7 @@ static const COKE CKeys[_CK_COUNT]	=
 	CKEYDEF( "power", "Power toggle", CKEYDEF_DANGEROUS, MK_CK(F11) ),
 	CKEYDEF( "exit", "Exit", CKEYDEF_BYPASSKEYZEROING | CKEYDEF_DANGEROUS, MK_CK2(F12, ESCAPE) ),
 	CKEYDEF( "state_rewind", "Rewind", 0, MK_CK(BACKSPACE) ),
+	CKEYDEF( "state_rewind_seek", "Rewind 10 seconds", 0, MK_CK_SHIFT(BACKSPACE) ),
 	CKEYDEF( "rotate_screen", "Rotate screen", 0, MK_CK_ALT(O) ),
 
 	CKEYDEF( "togglenetview", "Toggle netplay console", 0, MK_CK(T) ),
@@ -1858,6 +1860,12 @@ static void CheckCommandKeys(void)
   else
 	DNeedRewind = false;
 
+  if(CK_Check(CK_STATE_REWIND_SEEK))
+  {
+   if(!MDFNI_SeekStateRewind(((uint64)CurGame->fps * 10) >> 24))
+    MDFN_Notify(MDFN_NOTICE_STATUS, _("No state rewinding history to seek in."));
+  }
+
   if(CK_Check(CK_STATE_REWIND_TOGGLE))
   {
    RewindState = !RewindState;
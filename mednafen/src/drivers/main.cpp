@@ -69,6 +69,7 @@ static bool SuppressErrorPopups;	// Set from env variable "MEDNAFEN_NOPOPUPS"
 static int StateFuzzTest = false;
 static int StateSLSTest = false;
 static int StateRCTest = false;	// Rewind consistency
+static int StateCompBench = false;	// Frames emulated, plus one, while waiting to run the state compression benchmark.
 #if 1
 static int StatePCTest = false;	// Power(toggle) consistency
 #endif
@@ -165,6 +166,7 @@ static const MDFNSetting DriverSettings[] =
   { "sfspeed", MDFNSF_NOFLAGS, gettext_noop("SLOW-forwarding speed multiplier."), NULL, MDFNST_FLOAT, "0.75", "0.25", "15" },
   { "sftoggle", MDFNSF_NOFLAGS, gettext_noop("Treat the SLOW-forward button as a toggle."), NULL, MDFNST_BOOL, "0" },
 
+  { "runahead", MDFNSF_NOFLAGS, gettext_noop("Number of frames to run ahead, to reduce input latency."), gettext_noop("After each frame is emulated, emulation continues for this many more frames with the same input, the last of those frames is displayed, and the emulation state is rolled back.  This hides up to that many frames of a game's own input lag, at the cost of emulating that many extra frames, plus a save state save and restore, per frame.  Sound is only taken from the frames that aren't rolled back.  Setting this higher than a game's own lag will make it react to input before it should.  Has no effect while state rewinding is in progress."), MDFNST_UINT, "0", "0", "8" },
   { "nothrottle", MDFNSF_NOFLAGS, gettext_noop("Disable speed throttling when sound is disabled."), NULL, MDFNST_BOOL, "0"},
   { "autosave", MDFNSF_NOFLAGS, gettext_noop("Automatically load/save state on game load/close."), gettext_noop("Automatically save and load save states when a game is closed or loaded, respectively."), MDFNST_BOOL, "0"},
   { "sound.driver", MDFNSF_NOFLAGS, gettext_noop("Select sound driver."), gettext_noop("The following choices are possible, sorted by preference, high to low, when \"default\" driver is used, but dependent on being compiled in."), MDFNST_ENUM, "default", NULL, NULL, NULL, NULL, SDriver_List },
@@ -174,6 +176,9 @@ static const MDFNSetting DriverSettings[] =
   { "sound.period_time", MDFNSF_NOFLAGS, gettext_noop("Desired period size in microseconds(μs)."), gettext_noop("Currently only affects OSS, ALSA, WASAPI(exclusive mode), and SDL output.  A value of 0 defers to the default in the driver code in SexyAL.\n\nNote: This is not the \"sound buffer size\" setting, that would be \"sound.buffer_time\"."), MDFNST_UINT,  "0", "0", "100000" },
   { "sound.buffer_time", MDFNSF_NOFLAGS, gettext_noop("Desired buffer size in milliseconds(ms)."), gettext_noop("The default value of 0 enables automatic buffer size selection."), MDFNST_UINT, "0", "0", "1000" },
   { "sound.rate", MDFNSF_NOFLAGS, gettext_noop("Specifies the sound playback rate, in sound frames per second(\"Hz\")."), NULL, MDFNST_UINT, "48000", "22050", "192000"},
+  { "sound.rate_control", MDFNSF_NOFLAGS, gettext_noop("Enable dynamic sound rate control."), gettext_noop("Continuously measures how full the sound output buffer is, and adjusts the rate at which the emulated system generates sound by a tiny amount to keep it near \"sound.rate_control_time\".  Intended for when emulation is paced by the display, with \"video.blit_timesync\" enabled and vsync, rather than by sound output; \"sound.buffer_time\" should then be set to at least a couple of video frames' time more than the target, so that writing sound never has to wait.  Only has an effect with emulated systems that support it(currently \"nes\", \"pce\", and \"pcfx\"), and never affects sound recording.\n\nStatistics are printed when sound output is shut down, and the FPS display shows the current buffer fill level and adjustment."), MDFNST_BOOL, "0" },
+  { "sound.rate_control_time", MDFNSF_NOFLAGS, gettext_noop("Target average sound output buffer fill level for dynamic rate control, in milliseconds(ms)."), gettext_noop("Reduced as needed so that the buffer has room for a video frame's worth of sound more than this."), MDFNST_UINT, "20", "1", "500" },
+  { "sound.rate_control_max", MDFNSF_NOFLAGS, gettext_noop("Maximum dynamic rate control adjustment, in parts per million(ppm)."), gettext_noop("Adjustments of a few hundred ppm are inaudible.  Higher values let rate control cope with a bigger mismatch between the emulated system's frame rate and the display's refresh rate, at the risk of audible pitch wavering."), MDFNST_UINT, "500", "1", "10000" },
 
   #ifdef WANT_DEBUGGER
   { "debugger.autostepmode", MDFNSF_NOFLAGS, gettext_noop("Automatically go into the debugger's step mode after a game is loaded."), NULL, MDFNST_BOOL, "0" },
@@ -863,6 +868,7 @@ static bool DoArgs(int argc, char *argv[], char **filename)
 	char *cdtestpath = NULL;
 	int swiftresamptest = 0;
 	int owlresamptest = 0;
+	int owlresampbench = 0;
 	int vidbench = 0;
 	#ifdef WANT_SS_EMU
 	int ss_midsync;
@@ -906,6 +912,9 @@ static bool DoArgs(int argc, char *argv[], char **filename)
 	 // Save state rewind consistency test.
 	 { "staterctest", NULL, &StateRCTest, 0, 0 },
 
+	 // State rewinding compressor benchmark, run once 10 seconds or so into emulation.
+	 { "statecompbench", NULL, &StateCompBench, 0, 0 },
+
 #if 1
 	 // Save state power consistency test.
 	 { "statepctest", NULL, &StatePCTest, 0, 0 },
@@ -917,6 +926,9 @@ static bool DoArgs(int argc, char *argv[], char **filename)
 	 // OwlResampler test.
 	 { "owlresamptest", NULL, &owlresamptest, 0, 0 },
 
+	 // OwlResampler benchmark, of each SIMD kernel the CPU supports.
+	 { "owlresampbench", NULL, &owlresampbench, 0, 0 },
+
 	 { "vidbench", NULL, &vidbench, 0, 0 },
 
 	 #ifdef WANT_SS_EMU
@@ -978,6 +990,9 @@ static bool DoArgs(int argc, char *argv[], char **filename)
 	 if(owlresamptest)
 	  MDFNI_RunOwlResamplerTest();
 
+	 if(owlresampbench)
+	  MDFNI_RunOwlResamplerBenchmark();
+
 	 if(vidbench)
 	  MDFN_RunVideoBenchmarks();
 
@@ -1305,9 +1320,12 @@ static int GameLoop(void *arg)
 	 espec.NeedRewind = DNeedRewind;
 
  	 espec.SoundRate = Sound_GetRate();
+	 espec.SoundRateAdjust = Sound_GetRateAdjust();
 	 espec.SoundBuf = Sound_GetEmuModBuffer(&espec.SoundBufMaxSize);
  	 espec.SoundVolume = (double)MDFN_GetSettingUI("sound.volume") / 100;
 
+	 const unsigned RunAhead = MDFN_GetSettingUI("runahead");
+
 	 if(MDFN_UNLIKELY(StateFuzzTest))
 	 {
 	  EmulateSpecStruct estmp = espec;
@@ -1353,6 +1371,16 @@ static int GameLoop(void *arg)
 	   abort();
 	  }
 	 }
+	 else if(RunAhead && !espec.NeedRewind)
+	 {
+	  const int skip_save = espec.skip;
+
+	  espec.skip = true;	// Replaced by the run-ahead frame.
+	  MDFNI_Emulate(&espec);
+	  espec.skip = skip_save;
+
+	  MDFNI_RunAhead(&espec, RunAhead);
+	 }
 	 else
           MDFNI_Emulate(&espec);
 
@@ -1380,6 +1408,12 @@ static int GameLoop(void *arg)
 	  }
 	 }
 
+	 if(MDFN_UNLIKELY(StateCompBench) && ++StateCompBench > 600)
+	 {
+	  StateCompBench = false;
+	  MDFNI_BenchmarkStateCompression();
+	 }
+
 	 ers.AddEmuTime((espec.MasterCycles - espec.MasterCycles_DriverProcessed) / CurGameSpeed);
 
 	 SoftFB[SoftFB_BackBuffer].rect = espec.DisplayRect;
@@ -32,6 +32,121 @@ static int32 EmuModBufferSize = 0;	// In frames.
 static double SoundRate = 0;
 static bool NeedReInit = false;
 
+//
+// Dynamic rate control("sound.rate_control"): on each write, the number of sample frames queued in the output buffer, averaged
+// over just before and just after the write, is compared against a target, and a proportional-integral controller nudges the
+// sound rate adjustment factor(EmulateSpecStruct::SoundRateAdjust) by up to a few hundred ppm, so that when something other
+// than sound output, such as video.blit_timesync with vsync, paces emulation, the buffer neither drains into underruns nor
+// fills up into blocking writes.
+//
+static struct
+{
+ bool enabled;
+ double target;		// In sample frames.
+ double max_adjust;	// Maximum deviation of the ratio from 1.0.
+ double fill;		// Smoothed average fill level, in sample frames.
+ double integral;
+ double ratio;
+
+ // Telemetry; cur_* are read by the FPS display from the main thread.
+ volatile float cur_fill_ms;
+ volatile float cur_ppm;
+ uint64 updates;
+ double fill_sum, fill_min, fill_max;
+ double ratio_sum, ratio_min, ratio_max;
+ uint64 underruns;
+ uint64 blocked_writes;
+} RateControl;
+
+static void RateControl_Init(const MDFNGI* gi)
+{
+ const double frame_frames = (double)format.rate * (256 * 65536) / gi->fps;
+ const double max_target = std::max<double>(0, buffering.buffer_size - frame_frames);
+ double target = (double)format.rate * MDFN_GetSettingUI("sound.rate_control_time") / 1000;
+
+ memset(&RateControl, 0, sizeof(RateControl));
+ RateControl.enabled = MDFN_GetSettingB("sound.rate_control");
+ RateControl.ratio = 1.0;
+
+ if(!RateControl.enabled)
+  return;
+
+ if(target > max_target)
+ {
+  MDFN_printf(_("Warning: Rate control target is too large for the buffer size; increase \"sound.buffer_time\".\n"));
+  target = max_target;
+ }
+
+ RateControl.target = std::max<double>(1, target);
+ RateControl.max_adjust = MDFN_GetSettingUI("sound.rate_control_max") / 1000000.0;
+ RateControl.fill = RateControl.target;
+ RateControl.fill_min = 1e99;
+ RateControl.ratio_min = 1e99;
+
+ MDFNI_printf(_("Rate control target: %u sample frames(%f ms), maximum adjustment: %.0f ppm\n"), (unsigned)RateControl.target, RateControl.target * 1000 / format.rate, RateControl.max_adjust * 1000000);
+}
+
+static void RateControl_Update(const uint32 queued_before, const uint32 count)
+{
+ const uint32 queued = buffering.buffer_size - std::min<uint32>(buffering.buffer_size, Output->CanWrite(Output));
+
+ if(!queued_before)
+  RateControl.underruns++;
+
+ if(count > buffering.buffer_size - queued_before)
+  RateControl.blocked_writes++;
+
+ RateControl.fill += ((queued_before + queued) / 2.0 - RateControl.fill) / 8;
+
+ const double error = std::min<double>(1.0, std::max<double>(-1.0, (RateControl.target - RateControl.fill) / RateControl.target));
+
+ RateControl.integral = std::min<double>(RateControl.max_adjust, std::max<double>(-RateControl.max_adjust, RateControl.integral + error * RateControl.max_adjust / 128));
+ RateControl.ratio = 1.0 + std::min<double>(RateControl.max_adjust, std::max<double>(-RateControl.max_adjust, error * RateControl.max_adjust + RateControl.integral));
+ //
+ //
+ //
+ const double fill_ms = RateControl.fill * 1000 / format.rate;
+
+ RateControl.cur_fill_ms = fill_ms;
+ RateControl.cur_ppm = (RateControl.ratio - 1.0) * 1000000;
+ RateControl.updates++;
+ RateControl.fill_sum += fill_ms;
+ RateControl.fill_min = std::min<double>(RateControl.fill_min, fill_ms);
+ RateControl.fill_max = std::max<double>(RateControl.fill_max, fill_ms);
+ RateControl.ratio_sum += RateControl.ratio;
+ RateControl.ratio_min = std::min<double>(RateControl.ratio_min, RateControl.ratio);
+ RateControl.ratio_max = std::max<double>(RateControl.ratio_max, RateControl.ratio);
+}
+
+static void RateControl_Report(void)
+{
+ if(!RateControl.enabled || !RateControl.updates)
+  return;
+
+ MDFN_printf(_("Sound rate control summary:\n"));
+ MDFN_AutoIndent aind(1);
+
+ MDFN_printf(_("Buffer fill: %.2f ms average, %.2f ms min, %.2f ms max\n"), RateControl.fill_sum / RateControl.updates, RateControl.fill_min, RateControl.fill_max);
+ MDFN_printf(_("Rate adjustment: %+.1f ppm average, %+.1f ppm min, %+.1f ppm max\n"), (RateControl.ratio_sum / RateControl.updates - 1.0) * 1000000, (RateControl.ratio_min - 1.0) * 1000000, (RateControl.ratio_max - 1.0) * 1000000);
+ MDFN_printf(_("Writes: %llu, with the buffer empty: %llu, blocked: %llu\n"), (unsigned long long)RateControl.updates, (unsigned long long)RateControl.underruns, (unsigned long long)RateControl.blocked_writes);
+}
+
+double Sound_GetRateAdjust(void)
+{
+ return RateControl.ratio;
+}
+
+bool Sound_GetRateControlStatus(float* fill_ms, float* ppm)
+{
+ if(!RateControl.enabled)
+  return false;
+
+ *fill_ms = RateControl.cur_fill_ms;
+ *ppm = RateControl.cur_ppm;
+
+ return true;
+}
+
 bool Sound_NeedReInit(void)
 {
  return NeedReInit;
@@ -55,6 +170,8 @@ void Sound_Write(int16 *Buffer, int Count)
  if(!Output)
   return;
 
+ const uint32 queued_before = RateControl.enabled ? buffering.buffer_size - std::min<uint32>(buffering.buffer_size, Output->CanWrite(Output)) : 0;
+
  if(!Output->Write(Output, Buffer, Count))
  {
   //
@@ -63,6 +180,9 @@ void Sound_Write(int16 *Buffer, int Count)
   //NeedReInit = true;
   //printf("Output->Write failure? %d\n", Count);
  }
+
+ if(RateControl.enabled)
+  RateControl_Update(queued_before, Count);
 }
 
 void Sound_WriteSilence(int ms)
@@ -324,6 +444,8 @@ bool Sound_Init(MDFNGI *gi)
   MDFNI_printf(_("Latency: %u sample frames(%f ms)\n"), buffering.latency, (double)buffering.latency * 1000 / format.rate);
  }
 
+ RateControl_Init(gi);
+
  if(buffering.period_size)
  {
   //int64_t pt_test_result = ((int64_t)buffering.period_size * (1000 * 1000) / format.rate);
@@ -362,6 +484,10 @@ void Sound_Kill(void) noexcept
 {
  SoundRate = 0;
 
+ RateControl_Report();
+ RateControl.enabled = false;
+ RateControl.ratio = 1.0;
+
  if(EmuModBuffer)
  {
   free(EmuModBuffer);
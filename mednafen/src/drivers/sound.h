@@ -15,4 +15,7 @@ int16 *Sound_GetEmuModBuffer(int32 *max_size);
 
 double Sound_GetRate(void);
 
+double Sound_GetRateAdjust(void);
+bool Sound_GetRateControlStatus(float* fill_ms, float* ppm);	// Returns false if rate control is disabled.
+
 #endif
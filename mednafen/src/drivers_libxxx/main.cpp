@@ -1,4 +1,319 @@
-int main(int argc, char* argv[])
+/******************************************************************************/
+/* Mednafen - Multi-system Emulator                                           */
+/******************************************************************************/
+/* main.cpp:
+**  Copyright (C) 2021 Mednafen Team
+**
+** This program is free software; you can redistribute it and/or
+** modify it under the terms of the GNU General Public License
+** as published by the Free Software Foundation; either version 2
+** of the License, or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+//
+// Headless batch-run driver, for benchmarking and regression testing emulation cores without SDL:
+//
+//  mednafen [-frames N] [-runahead N] [-movie file.mcm] [-input hexbytes] [-force_module name] [-basedir path] [-<setting> value ...] path
+//
+// Runs N frames as fast as possible, then reports the emulation speed, per-subsystem time(with --enable-dev-build), and
+// MD5 hashes of the final frame and of all generated audio.
+//
+#include <mednafen/driver.h>
+#include <mednafen/profiler.h>
+#include <mednafen/hash/md5.h>
+#include <trio/trio.h>
+
+using namespace Mednafen;
+
+void Mednafen::MDFND_OutputNotice(MDFN_NoticeType t, const char* s) noexcept
+{
+ if(t != MDFN_NOTICE_STATUS)
+ {
+  fputs(s, stderr);
+  fputc('\n', stderr);
+  fflush(stderr);
+ }
+}
+
+void Mednafen::MDFND_OutputInfo(const char* s) noexcept
+{
+ fputs(s, stdout);
+ fflush(stdout);
+}
+
+void Mednafen::MDFND_MidSync(EmulateSpecStruct* espec, const unsigned flags)
+{
+ // Audio is picked up after MDFNI_Emulate() returns, and input is either constant or comes from a movie.
+}
+
+bool Mednafen::MDFND_CheckNeedExit(void)
+{
+ return false;
+}
+
+void Mednafen::MDFND_MediaSetNotification(uint32 drive_idx, uint32 state_idx, uint32 media_idx, uint32 orientation_idx)
+{
+
+}
+
+void Mednafen::MDFND_NetplayText(const char* text, bool NetEcho)
+{
+
+}
+
+void Mednafen::MDFND_NetplaySetHints(bool active, bool behind, uint32 local_players_mask)
+{
+
+}
+
+void Mednafen::MDFND_SetStateStatus(StateStatusStruct* status) noexcept
 {
+ delete status;
+}
+
+void Mednafen::MDFND_SetMovieStatus(StateStatusStruct* status) noexcept
+{
+ delete status;
+}
+
+static void HashAudio(md5_hasher* h, const int16* buf, const size_t count)
+{
+ uint8 tmp[512];
+
+ for(size_t i = 0; i < count; i += sizeof(tmp) / 2)
+ {
+  const size_t n = std::min<size_t>(count - i, sizeof(tmp) / 2);
+
+  for(size_t j = 0; j < n; j++)
+   MDFN_en16lsb(&tmp[j * 2], buf[i + j]);
+
+  h->process(tmp, n * 2);
+ }
+}
+
+static void HashFrame(md5_hasher* h, const MDFN_Surface* surface, const MDFN_Rect& rect, const int32* LineWidths, const bool multires)
+{
+ for(int32 y = rect.y; y < rect.y + rect.h; y++)
+ {
+  const uint32* row = surface->pix<uint32>() + y * surface->pitchinpix;
+  const int32 w = multires ? LineWidths[y] : rect.w;
+
+  h->process_scalar<uint32>(w);
+
+  for(int32 x = rect.x; x < rect.x + w; x++)
+   h->process_scalar<uint32>(row[x] & 0xFFFFFF);
+ }
+}
+
+static std::string DigestString(const md5_digest& d)
+{
+ std::string ret;
+
+ for(auto b : d)
+ {
+  char tmp[3];
+
+  trio_snprintf(tmp, sizeof(tmp), "%02x", b);
+  ret += tmp;
+ }
+
+ return ret;
+}
+
+static bool ParseHexBytes(const char* s, std::vector<uint8>* out)
+{
+ out->clear();
+
+ for(size_t i = 0; s[i]; i += 2)
+ {
+  unsigned v;
+
+  if(!s[i + 1] || trio_sscanf(std::string(s + i, 2).c_str(), "%2x", &v) != 1)
+   return false;
+
+  out->push_back(v);
+ }
+
+ return true;
+}
+
+static int Run(int argc, char* argv[])
+{
+ uint64 frames = 3600;
+ unsigned runahead = 0;
+ const char* movie_path = nullptr;
+ const char* force_module = nullptr;
+ const char* game_path = nullptr;
+ std::string basedir = ".";
+ std::vector<uint8> fixed_input;
+ std::vector<std::pair<std::string, std::string>> settings;
+
+ if(getenv("HOME"))
+  basedir = std::string(getenv("HOME")) + PSS + ".mednafen";
+
+ for(int i = 1; i < argc; i++)
+ {
+  const char* a = argv[i];
+
+  if(a[0] != '-')
+  {
+   game_path = a;
+   continue;
+  }
+
+  if((i + 1) >= argc)
+  {
+   fprintf(stderr, "Missing argument for \"%s\".\n", a);
+   return -1;
+  }
+
+  const char* v = argv[++i];
+
+  if(!strcmp(a, "-frames"))
+   frames = strtoull(v, nullptr, 10);
+  else if(!strcmp(a, "-runahead"))
+   runahead = strtoul(v, nullptr, 10);
+  else if(!strcmp(a, "-movie"))
+   movie_path = v;
+  else if(!strcmp(a, "-force_module"))
+   force_module = v;
+  else if(!strcmp(a, "-basedir"))
+   basedir = v;
+  else if(!strcmp(a, "-input"))
+  {
+   if(!ParseHexBytes(v, &fixed_input))
+   {
+    fprintf(stderr, "Bad hex input data \"%s\".\n", v);
+    return -1;
+   }
+  }
+  else
+   settings.push_back(std::make_pair(std::string(a + 1), std::string(v)));
+ }
+
+ if(!game_path)
+ {
+  fprintf(stderr, "Usage: %s [-frames N] [-runahead N] [-movie file.mcm] [-input hexbytes] [-force_module name] [-basedir path] [-<setting> value ...] path\n", argv[0]);
+  return -1;
+ }
+
+ if(!MDFNI_Init())
+  return -1;
+
+ if(!MDFNI_InitFinalize(basedir.c_str()))
+ {
+  MDFNI_Kill();
+  return -1;
+ }
+
+ for(auto const& s : settings)
+ {
+  if(!MDFNI_SetSetting(s.first, s.second))
+  {
+   MDFNI_Kill();
+   return -1;
+  }
+ }
+
+ MDFNGI* gi;
+
+ if(!(gi = MDFNI_LoadGame(force_module, &NVFS, game_path)))
+ {
+  MDFNI_Kill();
+  return -1;
+ }
+
+ //
+ // Every port gets its default device; port 1 gets the fixed input data, if any.
+ //
+ for(unsigned port = 0; port < gi->PortInfo.size(); port++)
+ {
+  const InputPortInfoStruct& pi = gi->PortInfo[port];
+  unsigned device = 0;
+
+  for(unsigned d = 0; d < pi.DeviceInfo.size(); d++)
+  {
+   if(!strcmp(pi.DeviceInfo[d].ShortName, pi.DefaultDevice))
+    device = d;
+  }
+
+  uint8* data = MDFNI_SetInput(port, device);
+
+  if(!port && data && fixed_input.size())
+   memcpy(data, &fixed_input[0], std::min<size_t>(fixed_input.size(), pi.DeviceInfo[device].IDII.InputByteSize));
+ }
+
+ if(movie_path)
+ {
+  std::string tmp = movie_path;
+
+  MDFNI_LoadMovie(&tmp[0]);
+ }
+
+ std::unique_ptr<MDFN_Surface> surface(new MDFN_Surface(nullptr, gi->fb_width, gi->fb_height, gi->fb_width, MDFN_PixelFormat::ARGB32_8888));
+ std::unique_ptr<int32[]> LineWidths(new int32[gi->fb_height]);
+ const int32 SoundBufMaxSize = 48000;
+ std::unique_ptr<int16[]> SoundBuf(new int16[SoundBufMaxSize * gi->soundchan]);
+ md5_hasher audio_hash;
+ MDFN_Rect rect = { 0, 0, 0, 0 };
+ int64 emu_ns = 0;
+ int64 audio_frames = 0;
+
+ Profiler::Reset();
+
+ for(uint64 frame = 0; frame < frames; frame++)
+ {
+  EmulateSpecStruct espec;
+
+  espec.surface = surface.get();
+  espec.LineWidths = LineWidths.get();
+  espec.VideoFormatChanged = !frame;
+  espec.SoundFormatChanged = !frame;
+  espec.SoundRate = 48000;
+  espec.SoundBuf = SoundBuf.get();
+  espec.SoundBufMaxSize = SoundBufMaxSize;
+
+  const int64 start = Profiler::Now();
+  MDFNI_Emulate(&espec);
+  MDFNI_RunAhead(&espec, runahead);
+  emu_ns += Profiler::Now() - start;
+
+  HashAudio(&audio_hash, espec.SoundBuf, espec.SoundBufSize * gi->soundchan);
+  audio_frames += espec.SoundBufSize;
+  rect = espec.DisplayRect;
+ }
+
+ md5_hasher video_hash;
+
+ HashFrame(&video_hash, surface.get(), rect, LineWidths.get(), gi->multires);
+
+ MDFN_printf(_("Frames: %llu\n"), (unsigned long long)frames);
+ MDFN_printf(_("Emulation time: %.3f s\n"), emu_ns / 1000000000.0);
+ MDFN_printf(_("Speed: %.2f frames/s\n"), (emu_ns > 0) ? (frames * 1000000000.0 / emu_ns) : 0.0);
+#ifdef MDFN_ENABLE_DEV_BUILD
+ Profiler::Report(emu_ns);
+#endif
+ MDFN_printf(_("Final frame: %dx%d, MD5 %s\n"), rect.w, rect.h, DigestString(video_hash.digest()).c_str());
+ MDFN_printf(_("Audio: %lld sample frames, MD5 %s\n"), (long long)audio_frames, DigestString(audio_hash.digest()).c_str());
+
+ MDFNI_CloseGame();
+ MDFNI_Kill();
+
  return 0;
 }
+
+int main(int argc, char* argv[])
+{
+ setlocale(LC_NUMERIC, "C");
+
+ return Run(argc, argv) ? 1 : 0;
+}
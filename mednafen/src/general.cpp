@@ -366,6 +366,29 @@ std::string MDFN_MakeFName(MakeFName_Type type, int id1, const char *cd1)
 	 ret = GeneratePath(fstring, fmap, dir);
 	}
 	break;
+
+
+  case MDFNMKF_CDAUDIO_CACHE:
+	{
+	 const std::string overpath = MDFN_GetSettingS("filesys.path_cdaudio_cache");
+
+	 if(NVFS.is_absolute_path(overpath))
+	  ret = overpath + PSS + cd1;
+	 else
+	  ret = BaseDirectory + PSS + overpath + PSS + cd1;
+	}
+	break;
+
+  case MDFNMKF_SEEKINDEX:
+	{
+	 const std::string overpath = MDFN_GetSettingS("filesys.path_seekindex");
+
+	 if(NVFS.is_absolute_path(overpath))
+	  ret = overpath + PSS + cd1;
+	 else
+	  ret = BaseDirectory + PSS + overpath + PSS + cd1;
+	}
+	break;
  }
 
  return ret;
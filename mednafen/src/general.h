@@ -26,7 +26,9 @@ typedef enum
  MDFNMKF_CHEAT_TMP,
  MDFNMKF_FIRMWARE,
  MDFNMKF_PGCONFIG,
- MDFNMKF_PMCONFIG
+ MDFNMKF_PMCONFIG,
+ MDFNMKF_CDAUDIO_CACHE,
+ MDFNMKF_SEEKINDEX
 } MakeFName_Type;
 
 std::string MDFN_MakeFName(MakeFName_Type type, int id1, const char *cd1);
@@ -432,9 +432,22 @@ struct EmulateSpecStruct
 	// before they try to handle it.
 	double soundmultiplier = 1.0;
 
+	// Fine sound output rate adjustment factor, for dynamic rate control.  Set by the driver code, from how full its sound output
+	// buffer is, to a value near 1.0; e.g. 1.0003 asks for 300ppm more sound frames per emulated second than SoundRate alone would
+	// give.  Unlike SoundRate, changing it doesn't trigger SoundFormatChanged.  Emulation modules that don't support it ignore it, and
+	// Mednafen doesn't handle it internally, so the driver code can't rely on it having any effect.
+	double SoundRateAdjust = 1.0;
+
 	// True if we want to rewind one frame.  Set by the driver code.
 	bool NeedRewind = false;
 
+	// Set by Mednafen(not the driver code) on run-ahead's speculative frames, which are emulated with SoundBuf set to NULL
+	// and then undone with a state load.  Emulation modules whose sound output carries state that StateAction() doesn't
+	// save(e.g. deltas dangling past the end of a frame, and filter state) should save it at the start of the first
+	// speculative frame, and restore it at the start of the next frame that isn't one, so that run-ahead doesn't change
+	// the sound output.
+	bool RunAheadSpeculative = false;
+
 	// Sound reversal during state rewinding is normally done in mednafen.cpp, but
         // individual system emulation code can also do it if this is set, and clear it after it's done.
         // (Also, the driver code shouldn't touch this variable)
@@ -158,6 +158,7 @@ void ArcadeCard::Write(uint32 A, uint8 V)
 
               ACRAMUsed = true;
               ACRAM[aci] = V;
+              ACRAM_Dirty.Mark(aci);
               ACAutoIncrement(port);
 	     }
              break;
@@ -271,7 +272,7 @@ void ArcadeCard::Write(uint32 A, uint8 V)
  }
 }
 
-ArcadeCard::ArcadeCard(void)
+ArcadeCard::ArcadeCard(void) : ACRAM_Dirty(sizeof(ACRAM))
 {
  ACRAMUsed = false;
  
@@ -318,7 +319,7 @@ void ArcadeCard::StateAction(StateMem *sm, const unsigned load, const bool data_
   SFVARN(AC.shift_bits, "ACShiftBits"),
   SFVARN(AC.shift_latch, "ACShift"),
   SFVARN(AC.rotate_bits, "ACRotateBits"),
-  SFPTR8(ACRAM, ACRAMUsed ? 0x200000 : 0x0),
+  SFDIRTY(&ACRAM_Dirty, SFPTR8(ACRAM, ACRAMUsed ? 0x200000 : 0x0)),
   SFEND
  };
 
@@ -353,6 +354,7 @@ void ArcadeCard::PokeRAM(uint32 Address, uint32 Length, const uint8 *Buffer)
   Address &= (1 << 21) - 1;
 
   ACRAM[Address] = *Buffer;
+  ACRAM_Dirty.Mark(Address);
   used |= ACRAM[Address];
 
   Address++;
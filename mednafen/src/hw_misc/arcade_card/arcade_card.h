@@ -53,6 +53,7 @@ class ArcadeCard
 
  bool ACRAMUsed;
  uint8 ACRAM[0x200000];
+ SFDirtyTracker ACRAM_Dirty;
 };
 
 }
@@ -19,14 +19,21 @@
  */
 
 #include <mednafen/mednafen.h>
+#include <mednafen/profiler.h>
 #include <trio/trio.h>
 #include "pce_psg.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace Mednafen
 {
 // Frequency cache cutoff optimization threshold (<= FREQC7M_COT)
 #define FREQC7M_COT	0x7 //0xA
 
+MDFN_PROFILE_ZONE(ProfPSG, "PCE_PSG::Update");
+
 void PCE_PSG::SetVolume(double new_volume)
 {
         for(int vl = 0; vl < 32; vl++)
@@ -72,6 +79,13 @@ static const int16 Phase_Filter[2][7] =
  /*   1 */ {     6,   112,   425,   641,   579,   250,    35 }, //  2048
 };
 
+// Phase_Filter, padded to 8 taps for aligned loads in FlushDeltas(); only the first 7 are ever applied.
+alignas(16) static const int32 Phase_Filter8[2][8] =
+{
+ {    35,   250,   579,   641,   425,   112,     6,     0 },
+ {     6,   112,   425,   641,   579,   250,    35,     0 },
+};
+
 INLINE void PCE_PSG::UpdateOutputSub(const int32 timestamp, psg_channel *ch, const int32 samp0, const int32 samp1)
 {
  int32 delta[2];
@@ -79,6 +93,25 @@ INLINE void PCE_PSG::UpdateOutputSub(const int32 timestamp, psg_channel *ch, con
  delta[0] = samp0 - ch->blip_prev_samp[0];
  delta[1] = samp1 - ch->blip_prev_samp[1];
 
+ if(fast_path)
+ {
+  if(!(delta[0] | delta[1]))
+   return;
+
+  if(MDFN_UNLIKELY(delta_count == DeltaQueueSize))
+   FlushDeltas();
+
+  DeltaEvent* ev = &delta_queue[delta_count++];
+
+  ev->timestamp = timestamp;
+  ev->delta[0] = delta[0];
+  ev->delta[1] = delta[1];
+
+  ch->blip_prev_samp[0] = samp0;
+  ch->blip_prev_samp[1] = samp1;
+  return;
+ }
+
  const int16* c = Phase_Filter[(timestamp >> 1) & 1];
  const int32 l = (timestamp >> 2) & 0xFFFF;
 
@@ -102,6 +135,73 @@ INLINE void PCE_PSG::UpdateOutputSub(const int32 timestamp, psg_channel *ch, con
  ch->blip_prev_samp[1] = samp1;
 }
 
+#if defined(__SSE2__)
+// Low 32 bits of each product; SSE2 lacks pmulld.
+static INLINE __m128i MulLo32(const __m128i a, const __m128i b)
+{
+ const __m128i even = _mm_mul_epu32(a, b);
+ const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+
+ return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+#endif
+
+//
+// Applies the deltas queued by UpdateOutputSub() in fast path mode; the results are identical to those of applying
+// them as they occur.
+//
+void PCE_PSG::FlushDeltas(void)
+{
+ for(unsigned i = 0; i < delta_count; i++)
+ {
+  const DeltaEvent* ev = &delta_queue[i];
+  const int32 l = (ev->timestamp >> 2) & 0xFFFF;
+#if defined(__SSE2__)
+  const int32* c = Phase_Filter8[(ev->timestamp >> 1) & 1];
+  const __m128i c0 = _mm_load_si128((const __m128i*)&c[0]);
+  const __m128i c1 = _mm_load_si128((const __m128i*)&c[4]);
+
+  for(unsigned lr = 0; lr < 2; lr++)
+  {
+   const __m128i d = _mm_set1_epi32(ev->delta[lr]);
+   int32* b = &HRBufs[lr][l];
+
+   // Taps 0-3, then 4-5, then 6; nothing past b[6] is touched, same as the exact path.
+   _mm_storeu_si128((__m128i*)&b[0], _mm_add_epi32(_mm_loadu_si128((const __m128i*)&b[0]), MulLo32(d, c0)));
+   _mm_storel_epi64((__m128i*)&b[4], _mm_add_epi32(_mm_loadl_epi64((const __m128i*)&b[4]), MulLo32(d, c1)));
+   b[6] += ev->delta[lr] * c[6];
+  }
+#else
+  const int16* c = Phase_Filter[(ev->timestamp >> 1) & 1];
+
+  for(unsigned lr = 0; lr < 2; lr++)
+  {
+   int32* b = &HRBufs[lr][l];
+
+   for(unsigned k = 0; k < 7; k++)
+    b[k] += ev->delta[lr] * c[k];
+  }
+#endif
+ }
+
+ delta_count = 0;
+}
+
+void PCE_PSG::SetFastPath(const bool enable, const double clock_rate, const double band_limit)
+{
+ FlushDeltas();
+
+ fast_path = enable;
+ accum_cot = FREQC7M_COT;
+
+ // A waveform's fundamental is clock_rate / (32 * freq_cache) Hz.
+ if(enable && band_limit > 0)
+  accum_cot = std::min<double>(8192, std::max<double>(FREQC7M_COT, ceil(clock_rate / (32 * band_limit)) - 1));
+
+ for(int ch = 0; ch < 6; ch++)
+  RecalcUOFunc(ch);
+}
+
 void PCE_PSG::UpdateOutput_Norm(const int32 timestamp, psg_channel *ch)
 {
  int sv = ch->dda;
@@ -164,7 +264,7 @@ void PCE_PSG::RecalcUOFunc(int chnum)
   ch->UpdateOutput = &PCE_PSG::UpdateOutput_Noise;
  // If the control for the channel is in waveform play mode, and the (real) playback frequency is too high, and the channel is either not the LFO modulator channel or
  // if the LFO trigger bit(which halts the LFO modulator channel's waveform incrementing when set) is clear
- else if((ch->control & 0xC0) == 0x80 && ch->freq_cache <= FREQC7M_COT && (chnum != 1 || !(lfoctrl & 0x80)) )
+ else if((ch->control & 0xC0) == 0x80 && ch->freq_cache <= accum_cot && (chnum != 1 || !(lfoctrl & 0x80)) )
   ch->UpdateOutput = UpdateOutput_Accum;
  else
   ch->UpdateOutput = &PCE_PSG::UpdateOutput_Norm;
@@ -436,6 +536,10 @@ PCE_PSG::PCE_PSG(int32* hr_l, int32* hr_r, int want_revision)
 	HRBufs[0] = hr_l;
 	HRBufs[1] = hr_r;
 
+	fast_path = false;
+	accum_cot = FREQC7M_COT;
+	delta_count = 0;
+
 	lastts = 0;
 	for(int ch = 0; ch < 6; ch++)
 	{
@@ -482,7 +586,7 @@ void PCE_PSG::Write(int32 timestamp, uint8 A, uint8 V)
      return;
     }
 
-    Update(timestamp);
+    Run(timestamp);
 
     psg_channel *ch = &channel[select];
 
@@ -648,7 +752,7 @@ void PCE_PSG::RunChannel(int chc, int32 timestamp, const bool LFO_On)
 
  ch->counter -= run_time;
 
- if(!LFO_On && ch->freq_cache <= FREQC7M_COT)
+ if(!LFO_On && ch->freq_cache <= accum_cot)
  {
   if(ch->counter <= 0)
   {
@@ -695,6 +799,13 @@ void PCE_PSG::UpdateSubNonLFO(int32 timestamp)
 
 void PCE_PSG::Update(int32 timestamp)
 {
+ Run(timestamp);
+ FlushDeltas();
+}
+
+void PCE_PSG::Run(int32 timestamp)
+{
+ MDFN_PROFILE_SCOPE(ProfPSG);
  int32 run_time = timestamp - lastts;
 
  if(vol_pending && !vol_update_counter && !vol_update_which)
@@ -785,6 +896,28 @@ void PCE_PSG::ResetTS(int32 ts_base)
   channel[chc].lastts = ts_base;
 }
 
+void PCE_PSG::SaveOutputSnapshot(OutputSnapshot* s)
+{
+ assert(!delta_count);
+
+ for(int chc = 0; chc < 6; chc++)
+ {
+  s->blip_prev_samp[chc][0] = channel[chc].blip_prev_samp[0];
+  s->blip_prev_samp[chc][1] = channel[chc].blip_prev_samp[1];
+ }
+}
+
+void PCE_PSG::LoadOutputSnapshot(const OutputSnapshot& s)
+{
+ assert(!delta_count);
+
+ for(int chc = 0; chc < 6; chc++)
+ {
+  channel[chc].blip_prev_samp[0] = s.blip_prev_samp[chc][0];
+  channel[chc].blip_prev_samp[1] = s.blip_prev_samp[chc][1];
+ }
+}
+
 void PCE_PSG::Power(const int32 timestamp)
 {
  // Not sure about power-on values, these are mostly just intuitive guesses(with some laziness thrown in).
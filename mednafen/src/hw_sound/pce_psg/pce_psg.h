@@ -134,11 +134,28 @@ class PCE_PSG
 
 	void StateAction(StateMem *sm, const unsigned load, const bool data_only);
 
+	// Output state that StateAction() doesn't cover, for undoing run-ahead's speculative frames(see
+	// EmulateSpecStruct::RunAheadSpeculative); only valid between Update() and the next Write().
+	struct OutputSnapshot
+	{
+	 int32 blip_prev_samp[6][2];
+	};
+
+	void SaveOutputSnapshot(OutputSnapshot* s);
+	void LoadOutputSnapshot(const OutputSnapshot& s);
+
         void Power(const int32 timestamp) MDFN_COLD;
         void Write(int32 timestamp, uint8 A, uint8 V);
 
 	void SetVolume(double new_volume);
 
+	// Selects between the exact synthesis path(the default), and a faster one for normal play that renders
+	// waveform-mode channels whose fundamental is above "band_limit"(Hz) as their average level, and queues
+	// output deltas(mostly DDA writes), to be applied to the high-rate buffers one by one by Update() instead
+	// of as they occur.  "clock_rate" is the rate of the timestamps passed to Write() and Update().
+	void SetFastPath(const bool enable, const double clock_rate, const double band_limit);
+
+	// Also applies any queued output deltas; call it before using the high-rate buffers' contents.
 	void Update(int32 timestamp);
 	void ResetTS(int32 ts_base = 0);
 
@@ -153,6 +170,9 @@ class PCE_PSG
 
         private:
 
+	void Run(int32 timestamp);
+	void FlushDeltas(void);
+
 	void UpdateSubLFO(int32 timestamp);
 	void UpdateSubNonLFO(int32 timestamp);
 
@@ -191,6 +211,19 @@ class PCE_PSG
         int32 dbtable_volonly[32];
 
 	int32 dbtable[32][32];
+
+	// Fast path state; see SetFastPath().
+	bool fast_path;
+	uint32 accum_cot;	// Channels with freq_cache <= this are rendered as their average level.
+
+	struct DeltaEvent
+	{
+	 int32 timestamp;
+	 int32 delta[2];
+	};
+	enum : unsigned { DeltaQueueSize = 4096 };
+	unsigned delta_count;
+	DeltaEvent delta_queue[DeltaQueueSize];
 };
 
 }
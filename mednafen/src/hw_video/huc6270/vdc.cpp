@@ -61,6 +61,31 @@ void VDC::FixTileCache(uint16 A)
   raw_pixel |= ((bitplane23 >> (x + 8)) & 1) << 3;
   tc[7 - x] = raw_pixel;
  }
+
+ spr_tile_clean[A >> 6] = false;
+}
+
+static INLINE void DecodeSpriteLine(uint8* tc, const uint16 bitplane0, const uint16 bitplane1, const uint16 bitplane2, const uint16 bitplane3)
+{
+ for(int x = 0; x < 16; x++)
+ {
+  uint32 raw_pixel = ((bitplane0 >> x) & 1);
+  raw_pixel |= ((bitplane1 >> x) & 1) << 1;
+  raw_pixel |= ((bitplane2 >> x) & 1) << 2;
+  raw_pixel |= ((bitplane3 >> x) & 1) << 3;
+  tc[15 - x] = raw_pixel;
+ }
+}
+
+void VDC::CheckFixSpriteTileCache(uint16 no)
+{
+ if(spr_tile_clean[no])
+  return;
+
+ for(int y = 0; y < 16; y++)
+  DecodeSpriteLine(spr_tile_cache[no][y], VRAM[no * 64 + y], VRAM[no * 64 + y + 16], VRAM[no * 64 + y + 32], VRAM[no * 64 + y + 48]);
+
+ spr_tile_clean[no] = true;
 }
 
 // Some virtual vdc macros to make code simpler to read
@@ -358,6 +383,7 @@ void VDC::RunDMA(int32 cycles, bool force_completion)
    if(DESR < VRAM_Size)
    {
     VRAM[DESR] = DMAReadBuffer;
+    VRAM_Dirty.Mark(DESR * sizeof(uint16));
     FixTileCache(DESR);
    }
 
@@ -1134,6 +1160,26 @@ void VDC::FetchSpriteData(void)
      SpriteList[active_sprites].pattern_data[3] = VRAM[no * 64 + (y_offset & 15) + 48];
     }
 
+    // pattern_data[] is what's latched from VRAM at fetch time(and saved in save states); pixels[] is its decoded
+    // form, copied out of the sprite tile cache so that VRAM writes between now and DrawSprites() don't affect it.
+    {
+     const uint8* tc;
+
+     CheckFixSpriteTileCache(no);
+     tc = spr_tile_cache[no][y_offset & 15];
+
+     if((MWR_cache & 0xC) == 4)
+     {
+      // 2-bitplane CG mode; the sprite uses either bitplanes 0/1, or bitplanes 2/3.
+      const unsigned shift = (SAT[i * 4 + 2] & 1) << 1;
+
+      for(unsigned px = 0; px < 16; px++)
+       SpriteList[active_sprites].pixels[px] = (tc[px] >> shift) & 0x3;
+     }
+     else
+      memcpy(SpriteList[active_sprites].pixels, tc, 16);
+    }
+
     SpriteList[active_sprites].flags |= i ? 0 : SPRF_SPRITE0;
 
     active_sprites++;
@@ -1183,10 +1229,7 @@ void VDC::DrawSprites(uint16 *target, int enabled, int boundbox_enabled)
     if(SpriteList[i].flags & SPRF_HFLIP)
      rev_x = x;
 
-    raw_pixel = (SpriteList[i].pattern_data[0] >> rev_x)  & 1;
-    raw_pixel |= ((SpriteList[i].pattern_data[1] >> rev_x) & 1) << 1;
-    raw_pixel |= ((SpriteList[i].pattern_data[2] >> rev_x) & 1) << 2;
-    raw_pixel |= ((SpriteList[i].pattern_data[3] >> rev_x) & 1) << 3;
+    raw_pixel = SpriteList[i].pixels[15 - rev_x];
 
     if (boundbox_enabled)
      pix_outline = (SpriteList[i].pattern_data[4] >> rev_x)  & 1;
@@ -1221,10 +1264,7 @@ void VDC::DrawSprites(uint16 *target, int enabled, int boundbox_enabled)
     if(SpriteList[i].flags & SPRF_HFLIP)
      rev_x = x;
 
-    raw_pixel = (SpriteList[i].pattern_data[0] >> rev_x)  & 1;
-    raw_pixel |= ((SpriteList[i].pattern_data[1] >> rev_x) & 1) << 1;
-    raw_pixel |= ((SpriteList[i].pattern_data[2] >> rev_x) & 1) << 2;
-    raw_pixel |= ((SpriteList[i].pattern_data[3] >> rev_x) & 1) << 3;
+    raw_pixel = SpriteList[i].pixels[15 - rev_x];
 
     if (boundbox_enabled)
      pix_outline = (SpriteList[i].pattern_data[4] >> rev_x)  & 1;
@@ -1423,6 +1463,7 @@ void VDC::CheckAndCommitPending(void)
    if(pending_write_addr < VRAM_Size)
    {
     VRAM[pending_write_addr] = pending_write_latch;
+    VRAM_Dirty.Mark(pending_write_addr * sizeof(uint16));
     FixTileCache(pending_write_addr);
    }
    //else
@@ -1835,7 +1876,7 @@ int32 VDC::Reset(void)
  return(CalcNextEvent());
 }
 
-VDC::VDC()
+VDC::VDC() : VRAM_Dirty(sizeof(VRAM))
 {
  SetUnlimitedSprites(false);
  SetVRAMSize(65536);
@@ -1886,6 +1927,9 @@ void VDC::StateExtra(LEPacker &sl_packer, bool load)
 
   for(int pd = 0; pd < 4; pd++)
    sl_packer ^ SpriteList[i].pattern_data[pd];
+
+  if(load)
+   DecodeSpriteLine(SpriteList[i].pixels, SpriteList[i].pattern_data[0], SpriteList[i].pattern_data[1], SpriteList[i].pattern_data[2], SpriteList[i].pattern_data[3]);
  }
 }
 
@@ -1944,7 +1988,7 @@ void VDC::StateAction(StateMem *sm, const unsigned load, const bool data_only, c
 
         SFPTR16N(SAT, 0x100, "SAT"),
 
-        SFPTR16N(VRAM, VRAM_Size, "VRAM"),
+        SFDIRTY(&VRAM_Dirty, SFPTR16N(VRAM, VRAM_Size, "VRAM")),
 
         SFVARN(DMAReadBuffer, "DMAReadBuffer"),
         SFVARN(DMAReadWrite, "DMAReadWrite"),
@@ -1992,6 +2036,14 @@ void VDC::StateAction(StateMem *sm, const unsigned load, const bool data_only, c
 	SFEND
   };
 
+  if(load)
+  {
+   if(!VRAM_PreLoad)
+    VRAM_PreLoad.reset(new uint16[65536]);
+
+   memcpy(VRAM_PreLoad.get(), VRAM, VRAM_Size * sizeof(uint16));
+  }
+
   MDFNSS_StateAction(sm, load, data_only, StateRegs, sname);
 
   if(load)
@@ -2016,7 +2068,10 @@ void VDC::StateAction(StateMem *sm, const unsigned load, const bool data_only, c
    StateExtra(sl_packer, true);
 
    for(int x = 0; x < VRAM_Size; x++)
-    FixTileCache(x);
+   {
+    if(VRAM[x] != VRAM_PreLoad[x])
+     FixTileCache(x);
+   }
   }
 }
 
@@ -39,6 +39,7 @@ typedef struct
         uint32 flags;
         uint8 palette_index;
         uint16 pattern_data[5]; // pattern_data[4] is used for special purposes
+	uint8 pixels[16];	// Decoded from pattern_data[0...3], left to right without HFLIP.
 } SPRLE;
 
 typedef struct
@@ -260,8 +261,16 @@ class VDC
 
 	int32 Run(int32 clocks, /*bool hs, bool vs,*/ uint16 *pixels, bool skip);
 
+	// True if Run(clocks) will reach the point where the next line is rendered into linebuf, by far the most
+	// expensive part of Run().
+	INLINE bool RunWillRenderLine(const int32 clocks) const
+	{
+	 return HNextEvent == HPHASE_HDW && HPhaseCounter <= clocks;
+	}
+
 
 	void FixTileCache(uint16);
+	void CheckFixSpriteTileCache(uint16 no);
 	void SetLayerEnableMask(uint64 mask);
 	void SetSprBoundBox(bool enable);
 
@@ -298,6 +307,7 @@ class VDC
 	 if(Address < VRAM_Size)
 	 {
 	  VRAM[Address] = Data;
+	  VRAM_Dirty.Mark(Address * sizeof(uint16));
 	  FixTileCache(Address);
 	 }
 	}
@@ -488,6 +498,8 @@ class VDC
         uint16 SAT[0x100];
 
         uint16 VRAM[65536]; //VRAM_Size];
+	SFDirtyTracker VRAM_Dirty;
+	std::unique_ptr<uint16[]> VRAM_PreLoad;	// VRAM before a state load, so that only the tile cache entries the load changed are refreshed.
 
 	union
 	{
@@ -495,6 +507,10 @@ class VDC
 	 uint8 bg_tile_cache[65536 / 16][8][8];
 	};
 
+	// Decoded lazily at sprite fetch time; VRAM writes only mark a tile as dirty.
+	uint8 spr_tile_cache[65536 / 64][16][16];		// Tile, y, x
+	bool spr_tile_clean[65536 / 64];
+
         uint16 DMAReadBuffer;
         bool DMAReadWrite;
         bool DMARunning;
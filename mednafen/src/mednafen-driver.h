@@ -141,6 +141,15 @@ bool MDFNI_SaveSettingsCompact(Stream* s);
 // Call multiple times after MDFNI_LoadGame() and before MDFNI_CloseGame()
 void MDFNI_Emulate(EmulateSpecStruct *espec);
 
+//
+// Run-ahead input latency reduction; call right after MDFNI_Emulate(), with the same espec.  Emulates "frames" further frames
+// without sound or movie/netplay/rewind involvement, outputs the last one's video into espec->surface(replacing the
+// DisplayRect, LineWidths, and interlace fields), then restores the emulation state to what it was before the call.
+//
+// MDFNI_Emulate() can be called with espec->skip set beforehand, since its video output is discarded.
+//
+void MDFNI_RunAhead(EmulateSpecStruct *espec, const unsigned frames);
+
 #if 0
 /* Support function for scaling multiple-horizontal-resolution frames to a single width; mostly intended for unofficial ports.
    The driver code really ought to handle multi-horizontal-resolution frames natively and properly itself, however.
@@ -186,6 +195,14 @@ void MDFNI_ToggleDIPView(void);
 
 bool MDFNI_EnableStateRewind(bool enable);
 
+// Jumps back "frames_back" recorded frames in the state rewinding history, or as close to that as the retained history allows(landing
+// on the nearest older frame).  Returns false if state rewinding isn't running or there's no history.
+bool MDFNI_SeekStateRewind(uint64 frames_back);
+
+// Prints the compression ratio and speed of each state rewinding compressor on the current state of the loaded game, and
+// on a rewind delta too if state rewinding is running.
+void MDFNI_BenchmarkStateCompression(void);
+
 bool MDFNI_StartAVRecord(const char *path, double SoundRate) MDFN_COLD;
 void MDFNI_StopAVRecord(void) MDFN_COLD;
 
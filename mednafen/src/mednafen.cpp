@@ -19,6 +19,9 @@
 
 #include <mednafen/cdrom/CDUtility.h>
 #include <mednafen/cdrom/CDInterface.h>
+#include <mednafen/cdrom/CDVerify.h>
+#include <mednafen/cdrom/CDZWriter.h>
+#include <mednafen/cdrom/CDTrace.h>
 
 #include <mednafen/string/string.h>
 #include <mednafen/string/escape.h>
@@ -33,6 +36,7 @@
 #include <mednafen/NativeVFS.h>
 
 #include <mednafen/compress/ArchiveReader.h>
+#include <mednafen/compress/BlockCompressor.h>
 
 #include <minilzo/minilzo.h>
 
@@ -95,6 +99,20 @@ static const MDFNSetting_EnumList Deinterlacer_List[] =
  { NULL, 0 },
 };
 
+static const MDFNSetting_EnumList SRWCompressor_List[] =
+{
+ { "quicklz", BlockCompressor::TYPE_QUICKLZ, "QuickLZ",
+	gettext_noop("Fast, with a reasonable compression ratio.") },
+
+ { "lzo", BlockCompressor::TYPE_LZO, "LZO",
+	gettext_noop("Slightly faster than \"quicklz\", with a somewhat worse compression ratio; for the lowest per-frame latency.") },
+
+ { "zstd", BlockCompressor::TYPE_ZSTD, "Zstandard",
+	gettext_noop("Slower, but with a much better compression ratio, especially with a trained dictionary(see \"srwdictframes\"); for keeping long rewind histories in limited memory.  Only available when Mednafen is built with an external libzstd.") },
+
+ { NULL, 0 },
+};
+
 static const char* const fname_extra = gettext_noop("See fname_format.txt for more information.  Edit at your own risk.");
 
 static const MDFNSetting MednafenSettings[] =
@@ -106,8 +124,21 @@ static const MDFNSetting MednafenSettings[] =
 
   { "srwframes", MDFNSF_NOFLAGS, gettext_noop("Number of frames to keep states for when state rewinding is enabled."), 
 	gettext_noop("WARNING: Setting this to a large value may cause excessive RAM usage in some circumstances, such as with games that stream large volumes of data off of CDs."), MDFNST_UINT, "600", "10", "99999" },
+  { "srwthread", MDFNSF_NOFLAGS, gettext_noop("Compress state rewinding data in a separate thread."), gettext_noop("Moves the XOR filtering and compression of rewind states off of the emulation thread, which reduces per-frame stalls at the cost of using an additional CPU core.  Emulation only waits for the worker thread once it's 4 states behind.  Takes effect the next time state rewinding is enabled."), MDFNST_BOOL, "0" },
+  { "srwcompressor", MDFNSF_NOFLAGS, gettext_noop("Compressor to use for state rewinding data."), gettext_noop("Takes effect the next time state rewinding is enabled."), MDFNST_ENUM, "quicklz", NULL, NULL, NULL, NULL, SRWCompressor_List },
+  { "srwdictframes", MDFNSF_NOFLAGS, gettext_noop("Number of initial states to train a compression dictionary from, for state rewinding."), gettext_noop("Only used by the \"zstd\" compressor; 0 disables dictionary training.  Takes effect the next time state rewinding is enabled."), MDFNST_UINT, "32", "0", "1024" },
+  { "srwkeyinterval", MDFNSF_NOFLAGS, gettext_noop("Number of frames between state rewinding keyframes."), gettext_noop("In addition to the per-frame history kept according to the \"srwframes\" setting, a full compressed state is kept every this many frames, so that rewinding can continue further back, in larger steps, once the per-frame history runs out.  Older keyframes are progressively thinned out to stay within the \"srwbudget\" memory budget.  0 disables keyframes.  Takes effect the next time state rewinding is enabled."), MDFNST_UINT, "0", "0", "99999" },
+  { "srwbudget", MDFNSF_NOFLAGS, gettext_noop("Memory budget, in MiB, for state rewinding history."), gettext_noop("Once the compressed state rewinding history grows past this size, keyframes and then the oldest per-frame states are discarded.  Only used when keyframes are enabled via the \"srwkeyinterval\" setting.  Takes effect the next time state rewinding is enabled."), MDFNST_UINT, "256", "1", "65536" },
 
   { "cd.image_memcache", MDFNSF_NOFLAGS, gettext_noop("Cache entire CD images in memory."), gettext_noop("Reads the entire CD image(s) into memory at startup(which will cause a small delay).  Can help obviate emulation hiccups due to emulated CD access.  May cause more harm than good on low memory systems, systems with swap enabled, and/or when the disc images in question are on a fast SSD.\n\nCaution: When using a 32-bit build of Mednafen on Windows or a 32-bit operating system, Mednafen may run out of address space(and error out, possibly in the middle of emulation) if this option is enabled when loading large disc sets(e.g. 3+ discs) via M3U files."), MDFNST_BOOL, "0" },
+  { "cd.cache_size", MDFNSF_NOFLAGS, gettext_noop("Size, in MiB, of the sector cache for CD images read from disk."), gettext_noop("Recently-read and read-ahead sectors are kept in a least-recently-used cache, so that games that seek back and forth between a few areas of the disc don't have to wait on the disc image again.  Larger values can help when the disc images are on slow or network storage.  0 keeps only a minimal 256-sector read-ahead buffer.  Has no effect when \"cd.image_memcache\" is enabled."), MDFNST_UINT, "0", "0", "1024" },
+  { "cd.audio_cache.size", MDFNSF_NOFLAGS, gettext_noop("Size, in MiB, of the decoded audio cache for compressed CD audio tracks."), gettext_noop("Audio tracks in compressed formats(e.g. Ogg Vorbis, Musepack, FLAC) are decoded on a separate thread, ahead of the emulated drive, into a least-recently-used cache, so that seeking back into an already-played part of a track(as with looping music) doesn't require decoding it again.  One minute of CD audio takes about 10MiB.  Set to 0 to disable the cache, and decode audio on demand as it's read instead."), MDFNST_UINT, "0", "0", "4096" },
+  { "cd.audio_cache.persist", MDFNSF_NOFLAGS, gettext_noop("Save decoded compressed CD audio tracks to disk."), gettext_noop("When enabled, each compressed audio file is decoded in full in the background, and saved, as raw PCM, in the directory specified by \"filesys.path_cdaudio_cache\"; on later loads, the saved data is used instead of decoding.  Files are identified by the MD5 hash of their contents, so each file is also read in full, in the background, and audio is decoded as usual until that's done.  Requires \"cd.audio_cache.size\" to be nonzero."), MDFNST_BOOL, "0" },
+  { "cd.verify", MDFNSF_NONPERSISTENT, gettext_noop("Verify CD images when loading them."), gettext_noop("Reads every sector of the disc image(s) at load time, checking the EDC of data sectors(and attempting L-EC correction of those that fail), then prints MD5 and SHA-256 hashes of each disc along with the LBAs of any unreadable or uncorrectable sectors.  Loading takes correspondingly longer."), MDFNST_BOOL, "0" },
+  { "cd.verify.threads", MDFNSF_NOFLAGS, gettext_noop("Number of EDC/L-EC checking threads used by \"cd.verify\"."), gettext_noop("0 = one per CPU.  Reading and hashing are done by separate threads regardless."), MDFNST_UINT, "0", "0", "64" },
+  { "cd.cdz_export", MDFNSF_NONPERSISTENT, gettext_noop("Path to write the loaded CD image(s) to, as a CDZ compressed disc image."), gettext_noop("Leave empty to disable.  When multiple discs are loaded, \"-2\", \"-3\", etc. are inserted before the file extension for the second disc onward.  Requires zstd compression support(--with-external-libzstd)."), MDFNST_STRING, "" },
+  { "cd.cdz_export.strip_ecc", MDFNSF_NOFLAGS, gettext_noop("Strip regenerable EDC/ECC from data sectors when writing CDZ images."), gettext_noop("Data sectors whose sync pattern, header, EDC, and ECC exactly match what would be regenerated are stored without them, and the missing parts are re-synthesized when the image is read."), MDFNST_BOOL, "1" },
+  { "cd.trace", MDFNSF_NONPERSISTENT, gettext_noop("Path to write a trace of emulated CD drive activity to."), gettext_noop("Leave empty to disable.  Every command sent to the emulated CD drive, every seek(with its distance and modelled delay), the duration of each data read, time spent waiting on the disc image, and ADPCM playback underruns are recorded to a compact binary file, and a summary is printed when the game is closed.  The file format is described in src/cdrom/CDTrace.h.  Only the PC Engine CD and PC-FX emulation support this."), MDFNST_STRING, "" },
   { "cd.m3u.recursion_limit", MDFNSF_NOFLAGS, gettext_noop("M3U recursion limit."), gettext_noop("A value of 0 effectively disables recursive loading of M3U files."), MDFNST_UINT, "9", "0", "99" },
   { "cd.m3u.disc_limit", MDFNSF_NOFLAGS, gettext_noop("M3U total number of disc images limit."), NULL, MDFNST_UINT, "25", "1", "999" },
   { "filesys.untrusted_fip_check", MDFNSF_NOFLAGS, gettext_noop("Enable untrusted file-inclusion path security check."),
@@ -122,6 +153,10 @@ static const MDFNSetting MednafenSettings[] =
   { "filesys.path_palette", MDFNSF_CAT_PATH, gettext_noop("Path to directory for custom palettes."), NULL, MDFNST_STRING, "palettes" },
   { "filesys.path_pgconfig", MDFNSF_CAT_PATH, gettext_noop("Path to directory for per-game configuration override files."), NULL, MDFNST_STRING, "pgconfig" },
   { "filesys.path_firmware", MDFNSF_CAT_PATH, gettext_noop("Path to directory for firmware."), NULL, MDFNST_STRING, "firmware" },
+  { "filesys.path_cdaudio_cache", MDFNSF_CAT_PATH, gettext_noop("Path to directory for decoded CD audio files."), gettext_noop("Used when \"cd.audio_cache.persist\" is enabled."), MDFNST_STRING, "cdaudio" },
+  { "filesys.path_seekindex", MDFNSF_CAT_PATH, gettext_noop("Path to directory for compressed file seek indexes."), gettext_noop("Used when \"filesys.seekindex\" is enabled."), MDFNST_STRING, "seekindex" },
+
+  { "filesys.seekindex", MDFNSF_NOFLAGS, gettext_noop("Save seek indexes for large compressed files in archives."), gettext_noop("Seeking within a large deflate or Zstandard-compressed file in a ZIP archive(e.g. a CD image loaded with \"cd.image_memcache\" disabled) resumes decompression from the nearest of a set of restart points recorded as the file is read, rather than from the start of the file.  When this setting is enabled, the restart points are also saved, in the directory specified by \"filesys.path_seekindex\", so that they can be reused on later loads.\n\nZstandard files in the \"seekable format\" provide their own restart points, and don't need an index."), MDFNST_BOOL, "0" },
 
   { "filesys.fname_movie", MDFNSF_CAT_PATH, gettext_noop("Format string for movie filename."), fname_extra, MDFNST_STRING, "%f.%M%p.%x" },
   { "filesys.fname_state", MDFNSF_CAT_PATH, gettext_noop("Format string for state filename."), fname_extra, MDFNST_STRING, "%f.%M%X" /*"%F.%M%p.%x"*/ },
@@ -230,6 +265,12 @@ static MDFN_PixelFormat last_pixel_format;
 static bool PrevInterlaced;
 static std::unique_ptr<Deinterlacer> deint;
 
+static bool InRunAhead = false;
+static std::unique_ptr<MemoryStream> RunAheadState;
+static uint32 RunAheadStateGen;
+static uint64 RunAheadCount;
+static int64 RunAheadSaveTime, RunAheadLoadTime;	// In microseconds.
+
 static bool FFDiscard = false; // TODO:  Setting to discard sound samples instead of increasing pitch
 
 static std::vector<CDInterface *> CDInterfaces;
@@ -395,10 +436,33 @@ static MDFN_COLD void Cleanup(void)
  Settings.ClearAllOverrides();
 }
 
+static void RunAhead_End(void)
+{
+ if(RunAheadCount)
+ {
+  MDFN_printf(_("Run-ahead state save/restore timing for module \"%s\":\n"), MDFNGameInfo->shortname);
+  {
+   MDFN_AutoIndent aind(1);
+
+   MDFN_printf(_("Rollbacks: %llu\n"), (unsigned long long)RunAheadCount);
+   MDFN_printf(_("State size: %llu bytes\n"), (unsigned long long)RunAheadState->size());
+   MDFN_printf(_("Average save time: %.1f us\n"), (double)RunAheadSaveTime / RunAheadCount);
+   MDFN_printf(_("Average restore time: %.1f us\n"), (double)RunAheadLoadTime / RunAheadCount);
+  }
+ }
+
+ RunAheadState.reset(nullptr);
+ RunAheadStateGen = 0;
+ RunAheadCount = 0;
+ RunAheadSaveTime = 0;
+ RunAheadLoadTime = 0;
+}
+
 void MDFNI_CloseGame(void)
 {
  if(MDFNGameInfo)
  {
+  RunAhead_End();
   MDFNI_NetplayDisconnect();
   //
   // Redundant with Cleanup(), but freeing up memory before
@@ -599,6 +663,7 @@ static const std::vector<FileExtensionSpecStruct> KnownCDExtensions =
  // M3U must be highest.
  { ".m3u", -40, "M3U" },
  { ".ccd", -50, "CloneCD" },
+ { ".cdz", -55, "Compressed CD image" },
  { ".cue", -60, "CUE" },
  { ".toc", -70, "cdrdao TOC" },
 };
@@ -607,12 +672,7 @@ static MDFN_COLD void OpenCD(const bool image_memcache, const uint64 affinity, c
 	VirtualFS* inside_vfs, const std::string& inside_path, std::unique_ptr<std::string> name_in)
 {
  const bool vfs_is_archive = (dynamic_cast<ArchiveReader*>(inside_vfs) != nullptr); // TODO: cleaner way of detecting archiveyness.
- //
- //
- if(vfs_is_archive && !image_memcache)
-  throw MDFN_Error(0, _("Setting \"cd.image_memcache\" must be set to \"1\" to allow loading a CD image from an archive."));
- //
- //
+
  if(!inside_vfs->test_ext(inside_path, ".m3u"))
  {
   if(file_list.size() >= m3u_disc_limit)
@@ -802,6 +862,93 @@ static MDFN_COLD void CalcDiscsLayoutMD5(std::vector<CDInterface *> *ifaces, uin
   layout_md5.finish(out_md5);
 }
 
+static MDFN_COLD void VerifyDiscs(std::vector<CDInterface *> *ifaces)
+{
+ const unsigned num_threads = MDFN_GetSettingUI("cd.verify.threads");
+
+ for(size_t i = 0; i < (*ifaces).size(); i++)
+ {
+  const int64 start_time = Time::MonoUS();
+  CDVerifyResult res;
+  std::string sha256_str;
+
+  MDFN_printf(_("Verifying disc %zu of %zu...\n"), i + 1, (*ifaces).size());
+  MDFN_AutoIndent aind(1);
+
+  CDVerify((*ifaces)[i], num_threads, &res);
+
+  for(auto b : res.sha256)
+  {
+   char tmp[3];
+
+   trio_snprintf(tmp, sizeof(tmp), "%02x", b);
+   sha256_str += tmp;
+  }
+
+  MDFN_printf(_("Sectors: %u(%u data), in %.2f seconds\n"), res.sectors, res.data_sectors, (Time::MonoUS() - start_time) / 1000000.0);
+  MDFN_printf(_("MD5:     %s\n"), md5_context::asciistr(&res.md5[0], false).c_str());
+  MDFN_printf(_("SHA-256: %s\n"), sha256_str.c_str());
+  MDFN_printf(_("Sectors corrected by L-EC: %u\n"), res.corrected);
+  MDFN_printf(_("Bad sectors: %zu\n"), res.bad_lbas.size());
+
+  if(res.bad_lbas.size())
+  {
+   const size_t max_listed = 64;
+   MDFN_AutoIndent aind_bad(1);
+
+   for(size_t j = 0; j < std::min(res.bad_lbas.size(), max_listed); j += 8)
+   {
+    std::string line;
+
+    for(size_t k = j; k < std::min<size_t>({ j + 8, res.bad_lbas.size(), max_listed }); k++)
+    {
+     char tmp[16];
+
+     trio_snprintf(tmp, sizeof(tmp), "%7d", res.bad_lbas[k]);
+     line += tmp;
+    }
+
+    MDFN_printf("%s\n", line.c_str());
+   }
+
+   if(res.bad_lbas.size() > max_listed)
+    MDFN_printf(_("...and %zu more.\n"), res.bad_lbas.size() - max_listed);
+
+   MDFN_Notify(MDFN_NOTICE_WARNING, _("Disc %zu of %zu has %zu unreadable or uncorrectable sector(s)."), i + 1, (*ifaces).size(), res.bad_lbas.size());
+  }
+
+  MDFN_printf("\n");
+ }
+}
+
+static MDFN_COLD void ExportDiscsCDZ(std::vector<CDInterface *> *ifaces, const std::string& path)
+{
+ const bool strip_ecc = MDFN_GetSettingB("cd.cdz_export.strip_ecc");
+ std::string dir_path, file_base, file_ext;
+
+ if(!BlockCompressor::IsAvailable(BlockCompressor::TYPE_ZSTD))
+  throw MDFN_Error(0, _("Setting \"cd.cdz_export\" requires zstd compression support, which was not compiled in."));
+
+ NVFS.get_file_path_components(path, &dir_path, &file_base, &file_ext);
+
+ for(size_t i = 0; i < (*ifaces).size(); i++)
+ {
+  const int64 start_time = Time::MonoUS();
+  std::string disc_path = path;
+
+  if(i)
+   disc_path = dir_path + PSS + file_base + "-" + std::to_string(i + 1) + file_ext;
+
+  MDFN_printf(_("Writing disc %zu of %zu to CDZ image \"%s\"...\n"), i + 1, (*ifaces).size(), MDFN_strhumesc(disc_path).c_str());
+  MDFN_AutoIndent aind(1);
+  FileStream fp(disc_path, FileStream::MODE_WRITE);
+
+  CDZ_Write((*ifaces)[i], &fp, strip_ecc);
+
+  MDFN_printf(_("Done, in %.2f seconds.\n"), (Time::MonoUS() - start_time) / 1000000.0);
+ }
+}
+
 static MDFN_COLD void LoadCustomPalette(VirtualFS* vfs)
 {
  if(!MDFNGameInfo->CPInfo)
@@ -1081,6 +1228,12 @@ static std::unique_ptr<RMD_Layout> MDFN_LoadCD(VirtualFS* inside_vfs, const std:
  //
  PrintDiscsLayout(&CDInterfaces);
 
+ if(MDFN_GetSettingB("cd.verify"))
+  VerifyDiscs(&CDInterfaces);
+
+ if(MDFN_GetSettingS("cd.cdz_export").size())
+  ExportDiscsCDZ(&CDInterfaces, MDFN_GetSettingS("cd.cdz_export"));
+
  {
   RMD_Drive dr;
 
@@ -1792,6 +1945,10 @@ void MDFN_MidSync(EmulateSpecStruct *espec, const unsigned flags)
  ProcessAudio(espec);
  espec->SoundBufSize_InternalProcessed = espec->SoundBufSize;
  espec->MasterCycles_InternalProcessed = espec->MasterCycles;
+
+ // Speculative frames take neither input nor time from the driver side, and mustn't be recorded into movies.
+ if(InRunAhead)
+  return;
  //
  // We could act as if flags = 0 during netplay, and call MDFND_MidSync(), but
  // we'd need to fix the kludgy driver-side code that handles sound buffer underruns.
@@ -1860,7 +2017,7 @@ void MDFNI_Emulate(EmulateSpecStruct *espec)
   ff_resampler.buffer_size((espec->SoundRate / 2) * 2);
  }
 
- // We want to record movies without any dropped video frames and without fast-forwarding sound distortion and without custom volume.
+ // We want to record movies without any dropped video frames and without fast-forwarding sound distortion and without custom volume or sound rate adjustment.
  // The same goes for WAV recording(sans the dropped video frames bit :b).
  if(qtrecorder || wavrecorder)
  {
@@ -1869,6 +2026,8 @@ void MDFNI_Emulate(EmulateSpecStruct *espec)
 
   volume_save = espec->SoundVolume;
   espec->SoundVolume = 1;
+
+  espec->SoundRateAdjust = 1;
  }
 
  if(MDFNGameInfo->TransformInput)
@@ -2005,6 +2164,88 @@ void MDFNI_Emulate(EmulateSpecStruct *espec)
   TBlur_Run(espec);
 }
 
+void MDFNI_RunAhead(EmulateSpecStruct *espec, const unsigned frames)
+{
+ if(!frames || !MDFNGameInfo->StateAction)
+  return;
+
+ if(!RunAheadState)
+  RunAheadState.reset(new MemoryStream(524288));
+
+ int64 t = Time::MonoUS();
+
+ try
+ {
+  MDFNSS_SaveSMIncremental(RunAheadState.get(), &RunAheadStateGen);
+ }
+ catch(std::exception& e)
+ {
+  MDFN_Notify(MDFN_NOTICE_ERROR, _("Run-ahead failed: %s"), e.what());
+  return;
+ }
+
+ RunAheadSaveTime += Time::MonoUS() - t;
+ //
+ //
+ //
+ InRunAhead = true;
+ CDTrace::Suspend(true);	// Speculative frames are emulated again for real, later.
+
+ try
+ {
+  for(unsigned i = 0; i < frames; i++)
+  {
+   const bool last = (i == (frames - 1));
+   EmulateSpecStruct ra;
+
+   // No sound, and video only for the last frame; the driver presents that frame in place of the one espec was
+   // emulated with.
+   ra.surface = espec->surface;
+   ra.LineWidths = espec->LineWidths;
+   ra.CustomPalette = espec->CustomPalette;
+   ra.CustomPaletteNumEntries = espec->CustomPaletteNumEntries;
+   ra.skip = last ? espec->skip : true;
+   ra.RunAheadSpeculative = true;
+
+   MDFNGameInfo->Emulate(&ra);
+
+   if(last)
+   {
+    espec->DisplayRect = ra.DisplayRect;
+    espec->InterlaceOn = ra.InterlaceOn;
+    espec->InterlaceField = ra.InterlaceField;
+   }
+  }
+ }
+ catch(std::exception& e)
+ {
+  MDFN_Notify(MDFN_NOTICE_ERROR, _("Run-ahead failed: %s"), e.what());
+ }
+
+ InRunAhead = false;
+ //
+ //
+ //
+ t = Time::MonoUS();
+
+ try
+ {
+  MDFNSS_LoadSMIncremental(RunAheadState.get());
+ }
+ catch(...)
+ {
+  CDTrace::Suspend(false);
+  throw;
+ }
+ CDTrace::Suspend(false);
+
+ RunAheadLoadTime += Time::MonoUS() - t;
+ RunAheadCount++;
+
+ if(espec->InterlaceOn && !espec->skip)
+  deint->Process(espec->surface, espec->DisplayRect, espec->LineWidths, espec->InterlaceField);
+}
+
 static void StateAction_RINP(StateMem* sm, const unsigned load, const bool data_only)
 {
  char namebuf[16][2 + 8 + 1];
@@ -2193,6 +2434,7 @@ void MDFN_DebugPrintReal(const char *file, const int line, const char *format, .
 void MDFN_DoSimpleCommand(int cmd)
 {
  MDFNGameInfo->DoSimpleCommand(cmd);
+ MDFNSS_InvalidateIncremental();
 }
 
 void MDFN_QSimpleCommand(int cmd)
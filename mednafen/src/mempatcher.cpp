@@ -95,14 +95,27 @@ static INLINE void WriteU8(uint32 addr, const uint8 val)
  //
  const size_t page = addr / PageSize;
 
+ //
+ // These writes bypass the emulation module's dirty-page tracking, so incremental save bases are invalidated; but only
+ // when the value actually changes, as periodic cheats rewrite the same values every frame.
+ //
  if(RAMInfo[page].Ptr)
  {
   const size_t offs = addr % PageSize;
 
-  RAMInfo[page].Ptr[offs] = val;
+  if(RAMInfo[page].Ptr[offs] != val)
+  {
+   MDFNSS_InvalidateIncremental();
+   RAMInfo[page].Ptr[offs] = val;
+  }
  }
  else if(MDFNGameInfo->CheatInfo.MemWrite)
+ {
+  if(!MDFNGameInfo->CheatInfo.MemRead || MDFNGameInfo->CheatInfo.MemRead(addr) != val)
+   MDFNSS_InvalidateIncremental();
+
   MDFNGameInfo->CheatInfo.MemWrite(addr, val);
+ }
 }
 
 typedef MemoryPatch CHEATF;
@@ -328,6 +328,8 @@ static void Emulate(EmulateSpecStruct *espec)
  if(espec->SoundFormatChanged)
   MDFNNES_SetSoundRate(espec->SoundRate);
 
+ MDFNNES_SetSoundRateAdjust(espec->SoundRateAdjust);
+
  NESPPU_GetDisplayRect(&espec->DisplayRect);
 
  MDFN_UpdateInput();
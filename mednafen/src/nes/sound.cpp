@@ -954,6 +954,12 @@ bool MDFNNES_SetSoundRate(double rate)
  return(true);
 }
 
+void MDFNNES_SetSoundRateAdjust(double ratio)
+{
+ if(ff)
+  ff->SetRateAdjust(ratio);
+}
+
 /* Called when a game has been loaded. */
 int MDFNSND_Init(bool IsPAL)
 {
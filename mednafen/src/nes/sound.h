@@ -30,6 +30,7 @@ void MDFNSND_StateAction(StateMem *sm, const unsigned load, const bool data_only
 void MDFNNES_SetSoundVolume(uint32 volume) MDFN_COLD;
 void MDFNNES_SetSoundMultiplier(double multiplier) MDFN_COLD;
 bool MDFNNES_SetSoundRate(double Rate) MDFN_COLD;
+void MDFNNES_SetSoundRateAdjust(double ratio);
 
 }
 
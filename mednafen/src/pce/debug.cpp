@@ -1505,6 +1505,13 @@ static const RegType Regs_CD[] =
 	{ CD_GSREG_ADPCM_HALFREACHED, 5, "Half",     "ADPCM Half-point Reached Flag", 1 },
 	{ CD_GSREG_ADPCM_ENDREACHED,  6, "End",      "ADPCM End Reached Flag",        1 },
 
+	{ 0, 0, "---CACHE---", "", 0xFFFF },
+
+	{ CD_GSREG_CACHE_HITS,        0, "Hit",      "Sector Cache Hits",             4 },
+	{ CD_GSREG_CACHE_MISSES,      0, "Mis",      "Sector Cache Misses",           4 },
+	{ CD_GSREG_CACHE_WAITMS,      1, "Wt",       "Sector Cache Miss Wait Time(ms)", 4 },
+	{ CD_GSREG_CACHE_BLOCKS,      0, "Blk",      "Sector Cache Misses That Blocked", 4 },
+
 	{ 0, 0, "-----------", "", 0xFFFF },
 
 	{ 0, 0, "", "", 0 },
@@ -1690,6 +1697,10 @@ static void PutAddressSpaceBytes(const char *name, uint32 Address, uint32 Length
 {
  PCE_InDebug++;
 
+ // "hl" pokes write directly into memory, bypassing dirty-page tracking.
+ if(hl)
+  MDFNSS_InvalidateIncremental();
+
  if(!strcmp(name, "cpu"))
  {
   while(Length--)
@@ -31,6 +31,8 @@
 #include <mednafen/hash/md5.h>
 #include <mednafen/FileStream.h>
 #include <mednafen/sound/OwlResampler.h>
+#include <mednafen/profiler.h>
+#include <mednafen/MThreading.h>
 
 #include <zlib.h>
 
@@ -47,6 +49,13 @@ static const MDFNSetting_EnumList PSGRevisionList[] =
  { NULL, 0 },
 };
 
+static const MDFNSetting_EnumList SGXRendererList[] =
+{
+ { "st", false, gettext_noop("Single-threaded"), gettext_noop("Both VDCs are run in the main emulation thread.") },
+ { "mt", true, gettext_noop("Multi-threaded"), gettext_noop("The second VDC is run in a dedicated thread, in lock-step with the first.") },
+ { NULL, 0 },
+};
+
 static std::vector<CDInterface*> *cdifs = NULL;
 
 HuC6280 HuCPU;
@@ -57,6 +66,8 @@ static PCE_PSG *psg = NULL;
 
 extern ArcadeCard *arcade_card;	// Bah, lousy globals.
 
+MDFN_PROFILE_ZONE(ProfResampler, "OwlResampler");
+
 static OwlBuffer* HRBufs[2] = { NULL, NULL };
 static RavenBuffer* ADPCMBuf = NULL;
 static RavenBuffer* CDDABufs[2] = { NULL, NULL };
@@ -64,6 +75,181 @@ static OwlResampler* HRRes = NULL;
 
 static bool SetSoundRate(double rate);
 
+//
+// Sound resampling thread(pce.resamp_thread).  Each pass through the loop in Emulate() copies the integrated high-rate
+// samples out of HRBufs and hands them to the thread, then outputs what the thread resampled on the previous pass; the
+// resampler so runs concurrently with emulation of the next pass and with the frontend's video and sound output, at
+// the cost of one pass(normally one frame) of added latency.
+//
+// The thread has its own pair of OwlBuffers holding the resampler input and state, so HRBufs can be reused by the
+// emulation thread right away.
+//
+static struct
+{
+ MThreading::Thread* thread;
+ MThreading::Sem* start;
+ MThreading::Sem* done;
+ bool exit;
+ bool pending;		// A pass has been handed to the thread and not yet waited for.
+
+ OwlBuffer* bufs[2];
+ unsigned count;
+ bool reverse;
+
+ int16* out;
+ int32 out_count;
+} ResampThread = { NULL };
+
+//
+// Sound output state that StateAction() doesn't save, as of the end of the last real frame before run-ahead's speculative
+// frames; see EmulateSpecStruct::RunAheadSpeculative.
+//
+// The sub-frame remainder of the timestamps(< 12 master clocks, left by the end of frame timestamp reset) isn't saved in
+// save states either, and it affects when the PSG and CD sound are sampled, so it's kept here too.
+//
+static struct
+{
+ bool saved;
+
+ uint32 timestamp;
+
+ OwlBuffer::Snapshot hr[2];
+ RavenBuffer::Snapshot adpcm;
+ RavenBuffer::Snapshot cdda[2];
+ PCE_PSG::OutputSnapshot psg;
+ PCECD_OutputSnapshot cd;
+} RunAheadSound;
+
+enum : int32 { ResampThreadOutSize = 65536 };
+
+static void ResampThreadPass(void)
+{
+ int32 new_sc = 0;
+
+ for(unsigned ch = 0; ch < 2; ch++)
+  new_sc = HRRes->Resample(ResampThread.bufs[ch], ResampThread.count, ResampThread.out + ch, ResampThreadOutSize, ResampThread.reverse);
+
+ ResampThread.out_count = new_sc;
+}
+
+static int ResampThreadEntry(void* data)
+{
+ for(;;)
+ {
+  MThreading::Sem_Wait(ResampThread.start);
+
+  if(ResampThread.exit)
+   break;
+
+  ResampThreadPass();
+  MThreading::Sem_Post(ResampThread.done);
+ }
+
+ return 0;
+}
+
+static void ResampThreadOutput(EmulateSpecStruct* espec)
+{
+ if(espec && espec->SoundBuf)
+ {
+  const int32 n = std::min<int32>(ResampThread.out_count, espec->SoundBufMaxSize - espec->SoundBufSize);
+
+  memcpy(espec->SoundBuf + espec->SoundBufSize * 2, ResampThread.out, n * 2 * sizeof(int16));
+  espec->SoundBufSize += n;
+ }
+}
+
+//
+// Waits for the pending pass, if any, and appends its output to the sound buffer of "espec"(discarded if NULL).
+//
+static void ResampThreadWait(EmulateSpecStruct* espec)
+{
+ if(!ResampThread.pending)
+  return;
+
+ MThreading::Sem_Wait(ResampThread.done);
+ ResampThread.pending = false;
+
+ ResampThreadOutput(espec);
+}
+
+//
+// Starts a pass on the samples copied into ResampThread.bufs; a reversed pass is done synchronously, as
+// the frontend expects the reversed sound of the frame that was just emulated.
+//
+static void ResampThreadStart(EmulateSpecStruct* espec, const unsigned count)
+{
+ ResampThread.count = count;
+ ResampThread.reverse = espec->NeedSoundReverse;
+
+ if(ResampThread.reverse)
+ {
+  MDFN_PROFILE_SCOPE(ProfResampler);
+
+  ResampThreadPass();
+  ResampThreadOutput(espec);
+ }
+ else
+ {
+  ResampThread.pending = true;
+  MThreading::Sem_Post(ResampThread.start);
+ }
+}
+
+static MDFN_COLD void ResampThreadInit(void)
+{
+ for(unsigned ch = 0; ch < 2; ch++)
+  ResampThread.bufs[ch] = new OwlBuffer();
+
+ ResampThread.out = new int16[ResampThreadOutSize * 2];
+ ResampThread.out_count = 0;
+ ResampThread.exit = false;
+ ResampThread.pending = false;
+ ResampThread.start = MThreading::Sem_Create();
+ ResampThread.done = MThreading::Sem_Create();
+ ResampThread.thread = MThreading::Thread_Create(ResampThreadEntry, NULL, "MDFN PCE Resampler");
+}
+
+static MDFN_COLD void ResampThreadKill(void)
+{
+ if(ResampThread.thread)
+ {
+  ResampThreadWait(NULL);
+
+  ResampThread.exit = true;
+  MThreading::Sem_Post(ResampThread.start);
+  MThreading::Thread_Wait(ResampThread.thread, NULL);
+  ResampThread.thread = NULL;
+ }
+
+ if(ResampThread.done)
+ {
+  MThreading::Sem_Destroy(ResampThread.done);
+  ResampThread.done = NULL;
+ }
+
+ if(ResampThread.start)
+ {
+  MThreading::Sem_Destroy(ResampThread.start);
+  ResampThread.start = NULL;
+ }
+
+ for(unsigned ch = 0; ch < 2; ch++)
+ {
+  if(ResampThread.bufs[ch])
+  {
+   delete ResampThread.bufs[ch];
+   ResampThread.bufs[ch] = NULL;
+  }
+ }
+
+ if(ResampThread.out)
+ {
+  delete[] ResampThread.out;
+  ResampThread.out = NULL;
+ }
+}
+
 static void Cleanup(void);
 
 bool PCE_ACEnabled;
@@ -76,6 +262,8 @@ static bool IsHES;
 
 // Accessed in debug.cpp
 static uint8 BaseRAM[32768]; // 8KB for PCE, 32KB for Super Grafx
+static SFDirtyTracker BaseRAM_Dirty(sizeof(BaseRAM));
+
 uint8 PCE_PeekMainRAM(uint32 A)
 {
  return BaseRAM[A & ((IsSGX ? 32768 : 8192) - 1)];
@@ -83,7 +271,9 @@ uint8 PCE_PeekMainRAM(uint32 A)
 
 void PCE_PokeMainRAM(uint32 A, uint8 V)
 {
- BaseRAM[A & ((IsSGX ? 32768 : 8192) - 1)] = V;
+ A &= (IsSGX ? 32768 : 8192) - 1;
+ BaseRAM[A] = V;
+ BaseRAM_Dirty.Mark(A);
 }
 
 
@@ -115,6 +305,7 @@ static DECLFR(BaseRAMReadSGX)
 static DECLFW(BaseRAMWriteSGX)
 {
  BaseRAM[A & 0x7FFF] = V;
+ BaseRAM_Dirty.Mark(A & 0x7FFF);
 }
 
 static DECLFR(BaseRAMRead)
@@ -125,6 +316,7 @@ static DECLFR(BaseRAMRead)
 static DECLFW(BaseRAMWrite)
 {
  BaseRAM[A & 0x1FFF] = V;
+ BaseRAM_Dirty.Mark(A & 0x1FFF);
 }
 
 static DECLFR(IORead)
@@ -446,6 +638,10 @@ static MDFN_COLD int LoadCommon(void)
  vce = new VCE(IsSGX, vram_size);
  vce->SetVDCUnlimitedSprites(MDFN_GetSettingB("pce.nospritelimit"));
  vce->SetMWRTiming(MDFN_GetSettingB("pce.mwrtiming_approx"));
+ vce->SetVDCThreaded(MDFN_GetSettingUI("pce.sgx_renderer"));
+
+ if(MDFN_GetSettingB("pce.resamp_thread"))
+  ResampThreadInit();
 
 
  if(IsSGX)
@@ -495,6 +691,8 @@ static MDFN_COLD int LoadCommon(void)
 
  PCE_Power();
 
+ RunAheadSound.saved = false;
+
  MDFNGameInfo->LayerNames = IsSGX ? "BG0\0SPR0\0BG1\0SPR1\0\0\0\0\0\0Spr Bound Box\0" : "Background\0Sprites\0\0\0\0\0\0\0\0Spr Bound Box\0";
  MDFNGameInfo->ChanNames = "PSG0\0PSG1\0PSG2\0PSG3\0PSG4\0PSG5\0";
  MDFNGameInfo->fps = (uint32)((double)7159090.90909090 / 455 / 263 * 65536 * 256);
@@ -719,6 +917,8 @@ static MDFN_COLD void Cleanup(void)
   psg = NULL;
  }
 
+ ResampThreadKill();
+
  for(unsigned ch = 0; ch < 2; ch++)
  {
   if(HRBufs[ch])
@@ -841,11 +1041,78 @@ void TestThing(unsigned count)
 }
 #endif
 
+static void SaveRunAheadSound(void)
+{
+ RunAheadSound.timestamp = HuCPU.Timestamp();
+
+ for(unsigned ch = 0; ch < 2; ch++)
+ {
+  HRBufs[ch]->SaveSnapshot(&RunAheadSound.hr[ch]);
+
+  if(CDDABufs[ch])
+   CDDABufs[ch]->SaveSnapshot(&RunAheadSound.cdda[ch]);
+ }
+
+ psg->SaveOutputSnapshot(&RunAheadSound.psg);
+
+ if(ADPCMBuf)
+ {
+  ADPCMBuf->SaveSnapshot(&RunAheadSound.adpcm);
+  PCECD_SaveOutputSnapshot(&RunAheadSound.cd);
+ }
+
+ RunAheadSound.saved = true;
+}
+
+static void LoadRunAheadSound(void)
+{
+ for(unsigned ch = 0; ch < 2; ch++)
+ {
+  HRBufs[ch]->LoadSnapshot(RunAheadSound.hr[ch]);
+
+  if(CDDABufs[ch])
+   CDDABufs[ch]->LoadSnapshot(RunAheadSound.cdda[ch]);
+ }
+
+ psg->LoadOutputSnapshot(RunAheadSound.psg);
+
+ if(ADPCMBuf)
+ {
+  ADPCMBuf->LoadSnapshot(RunAheadSound.adpcm);
+  PCECD_LoadOutputSnapshot(RunAheadSound.cd);
+ }
+
+ // Same as at the end of Emulate(), with nothing having run since.
+ {
+  const uint32 ts = RunAheadSound.timestamp;
+
+  INPUT_AdjustTS((int32)ts - (int32)HuCPU.Timestamp());
+  psg->ResetTS(ts / 3);
+  HuC_ResetTS(ts);
+
+  if(PCE_IsCD)
+   PCECD_ResetTS(ts);
+
+  vce->ResetTS(ts);
+  HuCPU.SyncAndResetTimestamp(ts);
+ }
+
+ RunAheadSound.saved = false;
+}
+
 static EmulateSpecStruct *es;
 static void Emulate(EmulateSpecStruct *espec)
 {
  es = espec;
 
+ if(espec->RunAheadSpeculative)
+ {
+  if(!RunAheadSound.saved)
+   SaveRunAheadSound();
+ }
+ else if(RunAheadSound.saved)
+  LoadRunAheadSound();
+
  espec->MasterCycles = 0;
  espec->SoundBufSize = 0;
 
@@ -896,8 +1163,18 @@ static void Emulate(EmulateSpecStruct *espec)
    if(ADPCMBuf)
     PCECD_ProcessADPCMBuffer(rsc);
 
+   // A pending pass is left alone through passes without a sound buffer(e.g. run-ahead's speculative frames), and its
+   // output goes to the next pass that has one.
+   if(ResampThread.thread && espec->SoundBuf)
+    ResampThreadWait(espec);
+
+   if(HRRes && espec->SoundBuf)
+    HRRes->SetRateAdjust(espec->SoundRateAdjust);
+
    for(unsigned ch = 0; ch < 2; ch++)
    {
+    MDFN_PROFILE_SCOPE(ProfResampler);
+
     if(HRRes)
     {
      //
@@ -951,7 +1228,13 @@ static void Emulate(EmulateSpecStruct *espec)
 
 #endif
 
-    if(espec->SoundBuf && HRRes)
+    if(espec->SoundBuf && HRRes && ResampThread.thread)
+    {
+     memcpy(ResampThread.bufs[ch]->Buf(), HRBufs[ch]->Buf(), rsc * sizeof(int32));
+     HRBufs[ch]->ResampleSkipped(rsc);
+     new_sc = 0;
+    }
+    else if(espec->SoundBuf && HRRes)
     {
      //printf("%04x\n", rsc);
      new_sc = HRRes->Resample(HRBufs[ch], rsc, espec->SoundBuf + (espec->SoundBufSize * 2) + ch, espec->SoundBufMaxSize - espec->SoundBufSize, espec->NeedSoundReverse);
@@ -963,6 +1246,9 @@ static void Emulate(EmulateSpecStruct *espec)
     }
    }
 
+   if(espec->SoundBuf && HRRes && ResampThread.thread)
+    ResampThreadStart(espec, rsc);
+
    espec->NeedSoundReverse = false;
 
    if(ADPCMBuf)
@@ -1009,7 +1295,7 @@ static void StateAction(StateMem *sm, const unsigned load, const bool data_only)
 {
  SFORMAT StateRegs[] =
  {
-  SFPTR8(BaseRAM, IsSGX? 32768 : 8192),
+  SFDIRTY(&BaseRAM_Dirty, SFPTR8(BaseRAM, IsSGX? 32768 : 8192)),
   SFVAR(PCE_TimestampBase),
   SFVAR(bBRAMEnabled),
 
@@ -1125,11 +1411,17 @@ static const MDFNSetting PCESettings[] =
   { "pce.mwrtiming_approx", MDFNSF_NOFLAGS, gettext_noop("Approximate MWR VRAM access timing during active display"), 
 					 gettext_noop("WARNING: This is an approximation, and is not accurate; sprite prefetch during HBLANK is not simulated either."), MDFNST_BOOL, "0" },
 
+  { "pce.resamp_thread", MDFNSF_NOFLAGS, gettext_noop("Resample sound in a separate thread."), gettext_noop("Sound resampling is done in a dedicated thread, concurrently with emulation of the next frame, which reduces the time taken to emulate each frame at the cost of one frame of additional sound latency.  If you have only one CPU with one physical CPU core, leave this disabled for better performance."), MDFNST_BOOL, "0" },
+
+  { "pce.sgx_renderer", MDFNSF_NOFLAGS, gettext_noop("SuperGrafx VDC renderer."), gettext_noop("Has no effect outside of SuperGrafx emulation.  If you have only one CPU with one physical CPU core, select the single-threaded renderer for better performance."), MDFNST_ENUM, "st", NULL, NULL, NULL, NULL, SGXRendererList },
+
   { "pce.cdbios", MDFNSF_EMU_STATE | MDFNSF_CAT_PATH, gettext_noop("Path to the CD BIOS"), NULL, MDFNST_STRING, "syscard3.pce" },
   { "pce.gecdbios", MDFNSF_EMU_STATE | MDFNSF_CAT_PATH, gettext_noop("Path to the GE CD BIOS"), gettext_noop("Games Express CD Card BIOS (Unlicensed)"), MDFNST_STRING, "gecard.pce" },
 
   { "pce.psgrevision", MDFNSF_NOFLAGS, gettext_noop("Select PSG revision."), gettext_noop("WARNING: HES playback will always use the \"huc6280a\" revision if this setting is set to \"match\", since HES playback is always done with SuperGrafx emulation enabled."), MDFNST_ENUM, "match", NULL, NULL, NULL, NULL, PSGRevisionList  },
 
+  { "pce.psg_fast", MDFNSF_NOFLAGS, gettext_noop("Use faster, approximate PSG sound synthesis."), gettext_noop("Waveform channels playing at frequencies above what the output sound rate can represent are synthesized as their average level instead of being stepped through, and channel output changes(such as DDA sample writes) are queued, and applied to the output buffer in a separate loop at the end of each frame rather than as they occur.  The audible result is the same aside from the removal of inaudible ultrasonic content and its aliasing."), MDFNST_BOOL, "0" },
+
   { "pce.cdpsgvolume", MDFNSF_NOFLAGS, gettext_noop("PSG volume when playing a CD game."), gettext_noop("Setting this volume control too high may cause sample clipping."), MDFNST_UINT, "62", "0", "200", NULL, CDSettingChanged },
   { "pce.cddavolume", MDFNSF_NOFLAGS, gettext_noop("CD-DA volume."), gettext_noop("Setting this volume control too high may cause sample clipping."), MDFNST_UINT, "100", "0", "200", NULL, CDSettingChanged },
   { "pce.adpcmvolume", MDFNSF_NOFLAGS, gettext_noop("ADPCM volume."), gettext_noop("Setting this volume control too high may cause sample clipping."), MDFNST_UINT, "100", "0", "200", NULL, CDSettingChanged },
@@ -1201,6 +1493,8 @@ static const FileExtensionSpecStruct KnownExtensions[] =
 
 static bool SetSoundRate(double rate)
 {
+ ResampThreadWait(NULL);
+
  if(HRRes)
  {
   delete HRRes;
@@ -1211,9 +1505,16 @@ static bool SetSoundRate(double rate)
  {
   HRRes = new OwlResampler(PCE_MASTER_CLOCK / 12, rate, MDFN_GetSettingF("pce.resamp_rate_error"), 20, MDFN_GetSettingUI("pce.resamp_quality"));
   for(unsigned i = 0; i < 2; i++)
+  {
    HRRes->ResetBufResampState(HRBufs[i]);
+
+   if(ResampThread.bufs[i])
+    HRRes->ResetBufResampState(ResampThread.bufs[i]);
+  }
  }
 
+ psg->SetFastPath(MDFN_GetSettingB("pce.psg_fast"), PCE_MASTER_CLOCK / 3, rate / 2);
+
  return(true);
 }
 
@@ -83,8 +83,10 @@
 #include <mednafen/mednafen.h>
 #include <mednafen/cdrom/CDInterface.h>
 #include <mednafen/cdrom/scsicd.h>
+#include <mednafen/cdrom/CDTrace.h>
 #include <mednafen/sound/okiadpcm.h>
 #include <mednafen/cdrom/SimpleFIFO.h>
+#include <mednafen/profiler.h>
 #include <trio/trio.h>
 
 using namespace Mednafen;
@@ -97,6 +99,8 @@ namespace MDFN_IEN_PCE
 
 //#define PCECD_DEBUG
 
+MDFN_PROFILE_ZONE(ProfCD, "PCECD_Run");
+
 static void (*IRQCB)(bool asserted);
 
 // Settings:
@@ -163,6 +167,8 @@ typedef struct
 } ADPCM_t;
 
 static ADPCM_t ADPCM;
+static bool ADPCM_TraceUnderrun;	// Playback has caught up with the write address; only for CDTrace.
+static SFDirtyTracker ADPCM_RAM_Dirty(0x10000);
 
 typedef struct
 {
@@ -297,6 +303,26 @@ uint32 PCECD_GetRegister(const unsigned int id, char *special, const uint32 spec
   case CD_GSREG_ADPCM_ENDREACHED:
 	value = ADPCM.EndReached;
 	break;
+
+  case CD_GSREG_CACHE_HITS:
+  case CD_GSREG_CACHE_MISSES:
+  case CD_GSREG_CACHE_WAITMS:
+  case CD_GSREG_CACHE_BLOCKS:
+	{
+	 CDInterface::CacheStats stats;
+
+	 SCSICD_GetCacheStats(&stats);
+
+	 if(id == CD_GSREG_CACHE_HITS)
+	  value = stats.hits;
+	 else if(id == CD_GSREG_CACHE_MISSES)
+	  value = stats.misses;
+	 else if(id == CD_GSREG_CACHE_BLOCKS)
+	  value = stats.blocks;
+	 else
+	  value = stats.wait_us / 1000;
+	}
+	break;
  }
 
  return(value);
@@ -325,6 +351,7 @@ void ADPCM_PokeRAM(uint32 Address, uint32 Length, const uint8 *Buffer)
  {
   Address &= 0xFFFF;
   ADPCM.RAM[Address] = *Buffer;
+  ADPCM_RAM_Dirty.Mark(Address);
   Address++;
   Buffer++;
  }
@@ -450,6 +477,7 @@ void PCECD_Init(const PCECD_Settings *settings, void (*irqcb)(bool), double mast
 	ADPCM.integrate_accum = 0;
 	ADPCM.lp1p_fstate = 0;
 	memset(ADPCM.lp2p_fstate, 0, sizeof(ADPCM.lp2p_fstate));
+	ADPCM_TraceUnderrun = false;	// SCSICD_Init() may (re)start the trace.
 
 	lastts = 0;
 
@@ -509,6 +537,7 @@ int32 PCECD_Power(uint32 timestamp)
         ADPCM.Addr = 0;
         ADPCM.ReadAddr = 0;
         ADPCM.WriteAddr = 0;
+	ADPCM_TraceUnderrun = false;
         ADPCM.LengthCount = 0;
         ADPCM.LastCmd = 0;
 
@@ -1009,8 +1038,58 @@ static const uint8 ADPCM_Filter[64][ADPCM_Filter_NumConvolutions] =
 
 // TODO: ADPCM_UpdateOutput() function here(for power and ADPCM state reset stuuuuffff).  timestamp_ex(timestamp << 16) as a parameter?
 
+//
+// Nibbles played by ADPCM_PB_Run() are collected here along with their output timing, and decoded and added to ADPCMBuf
+// a block at a time by ADPCM_PB_Output(), instead of one at a time between the playback timing and fetch logic.
+//
+enum : unsigned { ADPCM_PB_BlockSize = 256 };
+
+struct ADPCM_PB_Block
+{
+ unsigned count;
+ uint8 nibbles[ADPCM_PB_BlockSize];
+ uint16 synthtime[ADPCM_PB_BlockSize];	// & 0xFFFF
+ uint8 synthtime_phase[ADPCM_PB_BlockSize];	// Index into ADPCM_Filter.
+};
+
+static NO_INLINE void ADPCM_PB_Output(ADPCM_PB_Block* pb)
+{
+ uint16 samples[ADPCM_PB_BlockSize];
+
+ MSM5205.DecodeBlock(pb->nibbles, pb->count, samples);
+
+ if(ADPCMBuf)
+ {
+  // MSM5205 internal DAC is only 10 bits, so chop the lower 2 bits off the 12-bit result unless requested otherwise.
+  const uint16 mask = ADPCMExtraPrecision ? 0xFFF : 0xFFC;
+  const int32 volume = ADPCMTotalVolume;
+  int32 last_pcm = ADPCM.last_pcm;
+
+  for(unsigned i = 0; i < pb->count; i++)
+  {
+   const int32 pcm = (((samples[i] & mask) - 2048) * volume) >> 12;
+   const int32 delta = pcm - last_pcm;
+   const uint8* sf = ADPCM_Filter[pb->synthtime_phase[i]];
+   int32* tb = &ADPCMBuf[pb->synthtime[i]];
+
+   for(unsigned c = 0; c < ADPCM_Filter_NumConvolutions; c++)
+    tb[c] += (delta * sf[c]);
+
+   last_pcm = pcm;
+  }
+
+  ADPCM.last_pcm = last_pcm;
+ }
+
+ pb->count = 0;
+}
+
 static INLINE void ADPCM_PB_Run(int32 basetime, int32 run_time)
 {
+ ADPCM_PB_Block pb;
+
+ pb.count = 0;
+
  ADPCM.bigdiv -= ((int64)run_time << 16);
 
  while(ADPCM.bigdiv <= 0)
@@ -1039,6 +1118,16 @@ static INLINE void ADPCM_PB_Run(int32 basetime, int32 run_time)
      ADPCM.Playing = false;
    }
 
+   if(MDFN_UNLIKELY(CDTrace::Active))
+   {
+    const bool underrun = (ADPCM.ReadAddr == ADPCM.WriteAddr);
+
+    if(underrun && !ADPCM_TraceUnderrun)
+     CDTrace::ADPCMUnderrun(ADPCM.ReadAddr);
+
+    ADPCM_TraceUnderrun = underrun;
+   }
+
    ADPCM.PlayBuffer = ADPCM.RAM[ADPCM.ReadAddr];
    ADPCM.ReadAddr = (ADPCM.ReadAddr + 1) & 0xFFFF;
 
@@ -1073,38 +1162,20 @@ static INLINE void ADPCM_PB_Run(int32 basetime, int32 run_time)
 #else
   if(ADPCM.Playing)
   {
-   int32 pcm;
-   uint8 nibble;
-
-   nibble = (ADPCM.PlayBuffer >> (ADPCM.PlayNibble ^ 4)) & 0x0F;
-
-   if(ADPCMExtraPrecision)
-    pcm = MSM5205.Decode(nibble) - 2048;
-   else
-    pcm = (MSM5205.Decode(nibble) &~3) - 2048;	// Chop lower 2 bits off 12-bit result, MSM5205 internal DAC is only 10 bits.
+   pb.nibbles[pb.count] = (ADPCM.PlayBuffer >> (ADPCM.PlayNibble ^ 4)) & 0x0F;
+   pb.synthtime[pb.count] = synthtime & 0xFFFF;
+   pb.synthtime_phase[pb.count] = synthtime_phase_int;
 
    ADPCM.PlayNibble ^= 4;
 
-   pcm = (pcm * ADPCMTotalVolume) >> 12;
-
-   //
-   //
-   //
-   if(ADPCMBuf)
-   {
-    int32 delta = pcm - ADPCM.last_pcm;
-    const uint8* sf = ADPCM_Filter[synthtime_phase_int];
-    int32* tb = &ADPCMBuf[synthtime & 0xFFFF];
-
-    for(unsigned c = 0; c < ADPCM_Filter_NumConvolutions; c++)
-    {
-     tb[c] += (delta * sf[c]);
-    }
-    ADPCM.last_pcm = pcm;
-   }
+   if(++pb.count == ADPCM_PB_BlockSize)
+    ADPCM_PB_Output(&pb);
   }
 #endif
  }
+
+ if(pb.count)
+  ADPCM_PB_Output(&pb);
 }
 
 #if 0
@@ -1196,6 +1267,7 @@ static INLINE void ADPCM_Run(const int32 clocks, const int32 timestamp)
    if(!(ADPCM.LastCmd & 0x10) && ADPCM.LengthCount < 0x1FFFF)
     ADPCM.LengthCount++;
 
+   ADPCM_RAM_Dirty.Mark(ADPCM.WriteAddr);
    ADPCM.RAM[ADPCM.WriteAddr++] = ADPCM.WritePendingValue;
    ADPCM.WritePending = 0;
   }
@@ -1250,6 +1322,7 @@ static INLINE void ADPCM_Run(const int32 clocks, const int32 timestamp)
 // fact that reading and writing can change the next potential event,
 MDFN_FASTCALL int32 PCECD_Run(uint32 in_timestamp)
 {
+ MDFN_PROFILE_SCOPE(ProfCD);
  int32 clocks = in_timestamp - lastts;
  int32 running_ts = lastts;
 
@@ -1310,7 +1383,7 @@ static void ADPCM_StateAction(StateMem *sm, const unsigned load, const bool data
 
  SFORMAT StateRegs[] =
  {
-        SFPTR8(ADPCM.RAM, 0x10000),
+        SFDIRTY(&ADPCM_RAM_Dirty, SFPTR8(ADPCM.RAM, 0x10000)),
 
         SFVAR(ADPCM.bigdiv),
         SFVAR(ADPCM.Addr),
@@ -1359,6 +1432,22 @@ static void ADPCM_StateAction(StateMem *sm, const unsigned load, const bool data
  }
 }
 
+void PCECD_SaveOutputSnapshot(PCECD_OutputSnapshot* s)
+{
+ s->last_pcm = ADPCM.last_pcm;
+ s->integrate_accum = ADPCM.integrate_accum;
+ s->lp1p_fstate = ADPCM.lp1p_fstate;
+ memcpy(s->lp2p_fstate, ADPCM.lp2p_fstate, sizeof(s->lp2p_fstate));
+}
+
+void PCECD_LoadOutputSnapshot(const PCECD_OutputSnapshot& s)
+{
+ ADPCM.last_pcm = s.last_pcm;
+ ADPCM.integrate_accum = s.integrate_accum;
+ ADPCM.lp1p_fstate = s.lp1p_fstate;
+ memcpy(ADPCM.lp2p_fstate, s.lp2p_fstate, sizeof(ADPCM.lp2p_fstate));
+}
+
 void PCECD_StateAction(StateMem *sm, const unsigned load, const bool data_only)
 {
 	SFORMAT StateRegs[] =
@@ -31,6 +31,11 @@ enum
  CD_GSREG_ADPCM_PLAYING,
  CD_GSREG_ADPCM_HALFREACHED,
  CD_GSREG_ADPCM_ENDREACHED,
+
+ CD_GSREG_CACHE_HITS,	// RO
+ CD_GSREG_CACHE_MISSES,	// RO
+ CD_GSREG_CACHE_WAITMS,	// RO
+ CD_GSREG_CACHE_BLOCKS,	// RO
 };
 
 uint32 PCECD_GetRegister(const unsigned int id, char *special, const uint32 special_len);
@@ -54,6 +59,19 @@ MDFN_FASTCALL int32 PCECD_Write(uint32 timestamp, uint32, uint8 data) MDFN_WARN_
 
 void PCECD_StateAction(StateMem *sm, const unsigned load, const bool data_only);
 
+// ADPCM output state that PCECD_StateAction() doesn't cover, for undoing run-ahead's speculative frames(see
+// EmulateSpecStruct::RunAheadSpeculative); only valid between PCECD_ProcessADPCMBuffer() and the next PCECD_Run().
+struct PCECD_OutputSnapshot
+{
+ int32 last_pcm;
+ int32 integrate_accum;
+ int64 lp1p_fstate;
+ int64 lp2p_fstate[3];
+};
+
+void PCECD_SaveOutputSnapshot(PCECD_OutputSnapshot* s);
+void PCECD_LoadOutputSnapshot(const PCECD_OutputSnapshot& s);
+
 void ADPCM_PeekRAM(uint32 Address, uint32 Length, uint8 *Buffer);
 void ADPCM_PokeRAM(uint32 Address, uint32 Length, const uint8 *Buffer);
 
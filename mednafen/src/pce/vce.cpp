@@ -31,6 +31,7 @@
 #include "debug.h"
 #include "pcecd.h"
 #include <trio/trio.h>
+#include <mednafen/profiler.h>
 
 extern bool DebugHSyncFlag;
 extern bool DebugVSyncFlag;
@@ -40,14 +41,18 @@ extern void InitScanLine(uint32 y);
 namespace MDFN_IEN_PCE
 {
 
+MDFN_PROFILE_ZONE(ProfCPU, "HuC6280::Run");
+MDFN_PROFILE_ZONE(ProfVideo, "VCE::SyncSub/VDC::Run");
+
 static const int vce_ratios[4] = { 4, 3, 2, 2 };
 
 static MDFN_FASTCALL NO_INLINE int32 Sync(const int32 timestamp);
 
+template<unsigned chip>
 static void IRQChange_Hook(bool newstatus)
 {
  extern VCE *vce; //HORRIBLE
- vce->IRQChangeCheck();
+ vce->VDCIRQChanged(chip);
 }
 
 bool VCE::WS_Hook(int32 vdc_cycles)
@@ -144,7 +149,7 @@ VCE::VCE(const bool want_sgfx, const uint32 vram_size)
  for(unsigned chip = 0; chip < chip_count; chip++)
  {
   vdc[chip].SetVRAMSize(vram_size);
-  vdc[chip].SetIRQHook(IRQChange_Hook);
+  vdc[chip].SetIRQHook(chip ? IRQChange_Hook<1> : IRQChange_Hook<0>);
   vdc[chip].SetWSHook(MDFN_IEN_PCE::WS_Hook);
   vdc[chip].SetLayerEnableMask(0x3);
  }
@@ -163,6 +168,19 @@ VCE::VCE(const bool want_sgfx, const uint32 vram_size)
  #endif
 
  SetShowHorizOS(false);
+
+ vdc_thread = NULL;
+ vdc_thread_wakeup = NULL;
+ vdc_thread_done_wakeup = NULL;
+ vdc_thread_req = 0;
+ vdc_thread_done = 0;
+ vdc_thread_sleeping = false;
+ vdc_thread_main_sleeping = false;
+ vdc_thread_exit = false;
+ vdc_thread_clocks = 0;
+ vdc_thread_event = 0;
+ vdc_thread_irq_defer = false;
+ vdc_thread_irq_pending[0] = vdc_thread_irq_pending[1] = false;
 }
 
 void VCE::SetVDCUnlimitedSprites(const bool nospritelimit)
@@ -178,7 +196,121 @@ void VCE::SetMWRTiming(const bool mwr_switch)
 
 VCE::~VCE()
 {
+ SetVDCThreaded(false);
+}
+
+//
+// SuperGrafx VDC thread.  vdc[1].Run() is handed off for each chunk of SyncSub() in which it'll render a line, and the
+// emulation thread runs vdc[0] meanwhile and then waits for it to finish before continuing, so the two VDCs never see
+// register writes, DMA, or state loads out of order relative to each other.  IRQ line changes are deferred until both
+// are done, so the IRQ is checked with the same VDC state as when running them serially.
+//
+// Each side busy-waits briefly for the other, then sleeps on a semaphore; the sleeping flags are checked by the other
+// side after publishing its counter, so a wakeup can't be lost(at worst there's a spurious one, which is harmless).
+//
+enum { VDCThreadSpinCount = 1 << 11 };
+
+int VCE::VDCThreadEntry(void* data)
+{
+ VCE* const vce_p = (VCE*)data;
+ uint32 last_req = vce_p->vdc_thread_req.load(std::memory_order_acquire);
+
+ for(;;)
+ {
+  uint32 req;
+  unsigned spins = 0;
 
+  while((req = vce_p->vdc_thread_req.load(std::memory_order_acquire)) == last_req)
+  {
+   if(++spins >= VDCThreadSpinCount)
+   {
+    vce_p->vdc_thread_sleeping.store(true);
+
+    if(vce_p->vdc_thread_req.load() == last_req)
+     MThreading::Sem_Wait(vce_p->vdc_thread_wakeup);
+
+    vce_p->vdc_thread_sleeping.store(false);
+    spins = 0;
+   }
+  }
+  last_req = req;
+
+  if(vce_p->vdc_thread_exit)
+   break;
+
+  vce_p->vdc_thread_event = vce_p->vdc[1].Run(vce_p->vdc_thread_clocks, vce_p->pixel_buffer[1], vce_p->skipframe);
+  vce_p->vdc_thread_done.store(req);
+
+  if(vce_p->vdc_thread_main_sleeping.load())
+   MThreading::Sem_Post(vce_p->vdc_thread_done_wakeup);
+ }
+
+ return 0;
+}
+
+void VCE::SetVDCThreaded(const bool threaded)
+{
+ if(threaded && sgfx && !vdc_thread)
+ {
+  vdc_thread_exit = false;
+  vdc_thread_sleeping = false;
+  vdc_thread_main_sleeping = false;
+  vdc_thread_done = vdc_thread_req.load();
+  vdc_thread_wakeup = MThreading::Sem_Create();
+  vdc_thread_done_wakeup = MThreading::Sem_Create();
+  vdc_thread = MThreading::Thread_Create(VDCThreadEntry, this, "MDFN SuperGrafx VDC");
+ }
+ else if(!threaded && vdc_thread)
+ {
+  vdc_thread_exit = true;
+  vdc_thread_req.fetch_add(1);
+  MThreading::Sem_Post(vdc_thread_wakeup);
+  MThreading::Thread_Wait(vdc_thread, NULL);
+  vdc_thread = NULL;
+
+  MThreading::Sem_Destroy(vdc_thread_done_wakeup);
+  vdc_thread_done_wakeup = NULL;
+  MThreading::Sem_Destroy(vdc_thread_wakeup);
+  vdc_thread_wakeup = NULL;
+ }
+}
+
+void VCE::RunVDCsThreaded(const int32 div_clocks)
+{
+ const uint32 req = vdc_thread_req.load(std::memory_order_relaxed) + 1;
+ unsigned spins = 0;
+
+ vdc_thread_irq_defer = true;
+ vdc_thread_clocks = div_clocks;
+ vdc_thread_req.store(req);
+
+ if(vdc_thread_sleeping.load())
+  MThreading::Sem_Post(vdc_thread_wakeup);
+
+ child_event[0] = vdc[0].Run(div_clocks, pixel_buffer[0], skipframe);
+
+ while(vdc_thread_done.load(std::memory_order_acquire) != req)
+ {
+  if(++spins >= VDCThreadSpinCount)
+  {
+   vdc_thread_main_sleeping.store(true);
+
+   if(vdc_thread_done.load() != req)
+    MThreading::Sem_Wait(vdc_thread_done_wakeup);
+
+   vdc_thread_main_sleeping.store(false);
+   spins = 0;
+  }
+ }
+
+ child_event[1] = vdc_thread_event;
+ vdc_thread_irq_defer = false;
+
+ if(vdc_thread_irq_pending[0] || vdc_thread_irq_pending[1])
+ {
+  vdc_thread_irq_pending[0] = vdc_thread_irq_pending[1] = false;
+  IRQChangeCheck();
+ }
 }
 
 void VCE::Reset(const int32 timestamp)
@@ -283,7 +415,10 @@ bool VCE::RunPartial(void)
   cd_event = 0x3FFFFFFF;
 
  ws_counter = 0;
- HuCPU.Run();
+ {
+  MDFN_PROFILE_SCOPE(ProfCPU);
+  HuCPU.Run();
+ }
 
  if(!skipframe)
  {
@@ -375,9 +510,14 @@ INLINE void VCE::SyncSub(int32 clocks)
 
   if(div_clocks > 0)
   {
-   child_event[0] = vdc[0].Run(div_clocks, pixel_buffer[0], skipframe);
-   if(TA_SuperGrafx)
-    child_event[1] = vdc[1].Run(div_clocks, pixel_buffer[1], skipframe);
+   if(TA_SuperGrafx && vdc_thread && vdc[1].RunWillRenderLine(div_clocks))
+    RunVDCsThreaded(div_clocks);
+   else
+   {
+    child_event[0] = vdc[0].Run(div_clocks, pixel_buffer[0], skipframe);
+    if(TA_SuperGrafx)
+     child_event[1] = vdc[1].Run(div_clocks, pixel_buffer[1], skipframe);
+   }
 
    if(!skipframe)
    {
@@ -642,6 +782,7 @@ INLINE int32 VCE::SyncReal(const int32 timestamp)
  if(cd_event <= 0)
   cd_event = PCECD_Run(timestamp);
 
+ MDFN_PROFILE_SCOPE(ProfVideo);
 #ifdef MDFN_PCE_VCE_AWESOMEMODE
  if(sgfx)
   SyncSub<true, true>(clocks);
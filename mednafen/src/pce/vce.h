@@ -20,6 +20,9 @@
 
 #include "huc6280.h"
 #include <mednafen/hw_video/huc6270/vdc.h>
+#include <mednafen/MThreading.h>
+
+#include <atomic>
 
 namespace MDFN_IEN_PCE
 {
@@ -36,6 +39,9 @@ class VCE final
 	void SetShowHorizOS(bool show);
 	void SetLayerEnableMask(uint64 mask);
 
+	// SuperGrafx only: run the second VDC in its own thread, in lock-step with the first.
+	void SetVDCThreaded(const bool threaded) MDFN_COLD;
+
 	void StateAction(StateMem *sm, const unsigned load, const bool data_only);
 
 	void SetPixelFormat(const MDFN_PixelFormat &format, const uint8* CustomColorMap, const uint32 CustomColorMapLen);
@@ -200,6 +206,15 @@ class VCE final
 
         void IRQChangeCheck(void);
 
+	// Called via the VDCs' IRQ hooks; while the VDCs run on separate threads, the check is deferred until both are done.
+	INLINE void VDCIRQChanged(const unsigned chip)
+	{
+	 if(vdc_thread_irq_defer)
+	  vdc_thread_irq_pending[chip] = true;
+	 else
+	  IRQChangeCheck();
+	}
+
         bool WS_Hook(int32 vdc_cycles);
 
 	void SetCDEvent(const int32 cycles);
@@ -216,6 +231,22 @@ class VCE final
 	template<bool TA_SuperGrafx, bool TA_AwesomeMode>
 	void SyncSub(int32 clocks);
 
+	void RunVDCsThreaded(const int32 div_clocks);
+	static int VDCThreadEntry(void* data);
+
+	MThreading::Thread* vdc_thread;
+	MThreading::Sem* vdc_thread_wakeup;
+	MThreading::Sem* vdc_thread_done_wakeup;
+	std::atomic_uint_least32_t vdc_thread_req;	// Incremented by the emulation thread to start a Run() of vdc[1].
+	std::atomic_uint_least32_t vdc_thread_done;	// Set to vdc_thread_req by the VDC thread when that Run() is done.
+	std::atomic_bool vdc_thread_sleeping;
+	std::atomic_bool vdc_thread_main_sleeping;
+	bool vdc_thread_exit;
+	int32 vdc_thread_clocks;
+	int32 vdc_thread_event;
+	bool vdc_thread_irq_defer;
+	bool vdc_thread_irq_pending[2];
+
         void FixPCache(int entry);
         void SetVCECR(uint8 V);
 
@@ -25,6 +25,19 @@
 #include <mednafen/cputest/cputest.h>
 #include <trio/trio.h>
 
+#ifdef HAVE_SSE2_INTRINSICS
+ #include <emmintrin.h>
+#endif
+
+#if defined(ARCH_X86) && defined(HAVE_SSE2_INTRINSICS) && defined(__GNUC__)
+ #include <immintrin.h>
+ #define PCEFAST_MIX_AVX2 1
+#endif
+
+#ifdef HAVE_NEON_INTRINSICS
+ #include <arm_neon.h>
+#endif
+
 namespace MDFN_IEN_PCE_FAST
 {
 
@@ -32,6 +45,7 @@ static uint32 systemColorMap32[2][512];	// 0 = normal, 1 = strip colorburst
 static uint32 amask;    // Alpha channel maskaroo
 static uint32 userle; // User layer enable.
 static uint32 cputest_flags;
+static unsigned mix_simd;
 static uint32 disabled_layer_color;
 
 static bool unlimited_sprites;
@@ -990,9 +1004,176 @@ static NO_INLINE void DrawSprites(vdc_t *vdc, const int32 end, uint16 *spr_lineb
  }
 }
 
+//
+// Vectorized line mixers, used for 32bpp targets; each handles the largest multiple of 8 pixels that fits in "count",
+// and returns how many pixels it handled, leaving the remainder to the scalar loops below.
+//
+enum
+{
+ MIX_SIMD_NONE = 0,
+ MIX_SIMD_SSE2,
+ MIX_SIMD_AVX2,
+ MIX_SIMD_NEON
+};
+
+#if defined(HAVE_SSE2_INTRINSICS)
+static uint32 MixBGSPR_SSE2(const uint32 count, const uint8* MDFN_RESTRICT bg_linebuf, const uint16* MDFN_RESTRICT spr_linebuf, uint32* MDFN_RESTRICT target)
+{
+ const __m128i zero = _mm_setzero_si128();
+ const __m128i bg_cmask = _mm_set1_epi16(0x00F);
+ const __m128i spr_cmask = _mm_set1_epi16(0x1FF);
+ alignas(16) uint16 pixels[8];
+ uint32 x;
+
+ for(x = 0; (x + 8) <= count; x += 8)
+ {
+  const __m128i bg = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)&bg_linebuf[x]), zero);
+  const __m128i spr = _mm_loadu_si128((const __m128i*)&spr_linebuf[x]);
+  // Sprite pixel wins when the BG pixel is transparent, or when the sprite has priority.
+  const __m128i sel = _mm_or_si128(_mm_cmpeq_epi16(_mm_and_si128(bg, bg_cmask), zero), _mm_srai_epi16(spr, 15));
+
+  _mm_store_si128((__m128i*)pixels, _mm_or_si128(_mm_and_si128(sel, _mm_and_si128(spr, spr_cmask)), _mm_andnot_si128(sel, bg)));
+
+  for(unsigned i = 0; i < 8; i++)
+   target[x + i] = vce.color_table_cache[pixels[i]];
+ }
+
+ return x;
+}
+#endif
+
+#if defined(PCEFAST_MIX_AVX2)
+static __attribute__((target("avx2"))) uint32 MixBGSPR_AVX2(const uint32 count, const uint8* MDFN_RESTRICT bg_linebuf, const uint16* MDFN_RESTRICT spr_linebuf, uint32* MDFN_RESTRICT target)
+{
+ const __m256i zero = _mm256_setzero_si256();
+ const __m256i bg_cmask = _mm256_set1_epi32(0x00F);
+ const __m256i spr_cmask = _mm256_set1_epi32(0x1FF);
+ uint32 x;
+
+ for(x = 0; (x + 8) <= count; x += 8)
+ {
+  const __m256i bg = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&bg_linebuf[x]));
+  const __m256i spr = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)&spr_linebuf[x]));	// Sign-extended, so the priority bit fills the upper half.
+  const __m256i sel = _mm256_or_si256(_mm256_cmpeq_epi32(_mm256_and_si256(bg, bg_cmask), zero), _mm256_srai_epi32(spr, 31));
+  const __m256i pixels = _mm256_blendv_epi8(bg, _mm256_and_si256(spr, spr_cmask), sel);
+
+  _mm256_storeu_si256((__m256i*)&target[x], _mm256_i32gather_epi32((const int*)vce.color_table_cache, pixels, 4));
+ }
+
+ return x;
+}
+
+static __attribute__((target("avx2"))) uint32 MixBGOnly_AVX2(const uint32 count, const uint8* MDFN_RESTRICT bg_linebuf, uint32* MDFN_RESTRICT target)
+{
+ uint32 x;
+
+ for(x = 0; (x + 8) <= count; x += 8)
+ {
+  const __m256i pixels = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&bg_linebuf[x]));
+
+  _mm256_storeu_si256((__m256i*)&target[x], _mm256_i32gather_epi32((const int*)vce.color_table_cache, pixels, 4));
+ }
+
+ return x;
+}
+
+static __attribute__((target("avx2"))) uint32 MixSPROnly_AVX2(const uint32 count, const uint16* MDFN_RESTRICT spr_linebuf, uint32* MDFN_RESTRICT target)
+{
+ const __m256i spr_cmask = _mm256_set1_epi32(0x0FF);
+ const __m256i spr_or = _mm256_set1_epi32(0x100);
+ uint32 x;
+
+ for(x = 0; (x + 8) <= count; x += 8)
+ {
+  const __m256i spr = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)&spr_linebuf[x]));
+  const __m256i pixels = _mm256_or_si256(_mm256_and_si256(spr, spr_cmask), spr_or);
+
+  _mm256_storeu_si256((__m256i*)&target[x], _mm256_i32gather_epi32((const int*)vce.color_table_cache, pixels, 4));
+ }
+
+ return x;
+}
+#endif
+
+#if defined(HAVE_NEON_INTRINSICS)
+static uint32 MixBGSPR_NEON(const uint32 count, const uint8* MDFN_RESTRICT bg_linebuf, const uint16* MDFN_RESTRICT spr_linebuf, uint32* MDFN_RESTRICT target)
+{
+ const uint16x8_t bg_cmask = vdupq_n_u16(0x00F);
+ const uint16x8_t spr_cmask = vdupq_n_u16(0x1FF);
+ alignas(16) uint16 pixels[8];
+ uint32 x;
+
+ for(x = 0; (x + 8) <= count; x += 8)
+ {
+  const uint16x8_t bg = vmovl_u8(vld1_u8(&bg_linebuf[x]));
+  const uint16x8_t spr = vld1q_u16(&spr_linebuf[x]);
+  const uint16x8_t sel = vorrq_u16(vceqq_u16(vandq_u16(bg, bg_cmask), vdupq_n_u16(0)), vreinterpretq_u16_s16(vshrq_n_s16(vreinterpretq_s16_u16(spr), 15)));
+
+  vst1q_u16(pixels, vbslq_u16(sel, vandq_u16(spr, spr_cmask), bg));
+
+  for(unsigned i = 0; i < 8; i++)
+   target[x + i] = vce.color_table_cache[pixels[i]];
+ }
+
+ return x;
+}
+#endif
+
+static INLINE uint32 MixBGSPR_SIMD(const uint32 count, const uint8* MDFN_RESTRICT bg_linebuf, const uint16* MDFN_RESTRICT spr_linebuf, uint32* MDFN_RESTRICT target)
+{
+ switch(mix_simd)
+ {
+#if defined(HAVE_SSE2_INTRINSICS)
+  case MIX_SIMD_SSE2: return MixBGSPR_SSE2(count, bg_linebuf, spr_linebuf, target);
+#endif
+#if defined(PCEFAST_MIX_AVX2)
+  case MIX_SIMD_AVX2: return MixBGSPR_AVX2(count, bg_linebuf, spr_linebuf, target);
+#endif
+#if defined(HAVE_NEON_INTRINSICS)
+  case MIX_SIMD_NEON: return MixBGSPR_NEON(count, bg_linebuf, spr_linebuf, target);
+#endif
+ }
+
+ return 0;
+}
+
+// Plain palette lookups; only worth vectorizing with a gather instruction.
+static INLINE uint32 MixBGOnly_SIMD(const uint32 count, const uint8* MDFN_RESTRICT bg_linebuf, uint32* MDFN_RESTRICT target)
+{
+#if defined(PCEFAST_MIX_AVX2)
+ if(mix_simd == MIX_SIMD_AVX2)
+  return MixBGOnly_AVX2(count, bg_linebuf, target);
+#endif
+
+ return 0;
+}
+
+static INLINE uint32 MixSPROnly_SIMD(const uint32 count, const uint16* MDFN_RESTRICT spr_linebuf, uint32* MDFN_RESTRICT target)
+{
+#if defined(PCEFAST_MIX_AVX2)
+ if(mix_simd == MIX_SIMD_AVX2)
+  return MixSPROnly_AVX2(count, spr_linebuf, target);
+#endif
+
+ return 0;
+}
+
 template<typename T>
-static void MixBGSPR(const uint32 count, const uint8*  MDFN_RESTRICT bg_linebuf, const uint16*  MDFN_RESTRICT spr_linebuf, T* MDFN_RESTRICT target)
+static void MixBGSPR(uint32 count, const uint8*  MDFN_RESTRICT bg_linebuf, const uint16*  MDFN_RESTRICT spr_linebuf, T* MDFN_RESTRICT target)
 {
+ if(sizeof(T) == 4)
+ {
+  const uint32 done = MixBGSPR_SIMD(count, bg_linebuf, spr_linebuf, (uint32*)target);
+
+  if(done == count)
+   return;
+
+  count -= done;
+  bg_linebuf += done;
+  spr_linebuf += done;
+  target += done;
+ }
+
 #ifdef ARCH_X86
  bg_linebuf += count;
  spr_linebuf += count;
@@ -1061,15 +1242,33 @@ static void MixBGSPR(const uint32 count, const uint8*  MDFN_RESTRICT bg_linebuf,
 }
 
 template<typename T>
-static void MixBGOnly(const uint32 count, const uint8* MDFN_RESTRICT bg_linebuf, T* MDFN_RESTRICT target)
+static void MixBGOnly(uint32 count, const uint8* MDFN_RESTRICT bg_linebuf, T* MDFN_RESTRICT target)
 {
+ if(sizeof(T) == 4)
+ {
+  const uint32 done = MixBGOnly_SIMD(count, bg_linebuf, (uint32*)target);
+
+  count -= done;
+  bg_linebuf += done;
+  target += done;
+ }
+
  for(unsigned int x = 0; x < count; x++)
   target[x] = vce.color_table_cache[bg_linebuf[x]];
 }
 
 template<typename T>
-static void MixSPROnly(const uint32 count, const uint16* MDFN_RESTRICT spr_linebuf, T* MDFN_RESTRICT target)
+static void MixSPROnly(uint32 count, const uint16* MDFN_RESTRICT spr_linebuf, T* MDFN_RESTRICT target)
 {
+ if(sizeof(T) == 4)
+ {
+  const uint32 done = MixSPROnly_SIMD(count, spr_linebuf, (uint32*)target);
+
+  count -= done;
+  spr_linebuf += done;
+  target += done;
+ }
+
  for(unsigned int x = 0; x < count; x++)
   target[x] = vce.color_table_cache[(spr_linebuf[x] | 0x100) & 0x1FF];
 }
@@ -1590,9 +1789,23 @@ void VDC_Init(const bool sgx)
  VDC_TotalChips = sgx ? 2 : 1;
 
  cputest_flags = 0;
+ mix_simd = MIX_SIMD_NONE;
+#if defined(HAVE_NEON_INTRINSICS)
+ mix_simd = MIX_SIMD_NEON;
+#endif
 #ifdef ARCH_X86
  cputest_flags = cputest_get_flags();
 
+ #if defined(PCEFAST_MIX_AVX2)
+ if(cputest_flags & CPUTEST_FLAG_AVX2)
+  mix_simd = MIX_SIMD_AVX2;
+ else
+ #endif
+ #if defined(HAVE_SSE2_INTRINSICS)
+ if((cputest_flags & (CPUTEST_FLAG_SSE2 | CPUTEST_FLAG_SSE2SLOW)) == CPUTEST_FLAG_SSE2)
+  mix_simd = MIX_SIMD_SSE2;
+ #endif
+
  // ZF undefined schmundefined.
  for(unsigned i = 0; i < 65536; i = ((i + 1) & 0x800F) + (((i & 0xF) == 0xF) << 15))
  {
@@ -257,6 +257,7 @@ static void Emulate(EmulateSpecStruct *espec)
  if(espec->SoundFormatChanged)
   SoundBox_SetSoundRate(espec->SoundRate);
 
+ SoundBox_SetSoundRateAdjust(espec->SoundRateAdjust);
 
  KING_StartFrame(fx_vdc_chips, espec);	//espec->surface, &espec->DisplayRect, espec->LineWidths, espec->skip);
 
@@ -280,6 +280,12 @@ bool SoundBox_SetSoundRate(uint32 rate)
  return(true);
 }
 
+void SoundBox_SetSoundRateAdjust(double ratio)
+{
+ if(FXres)
+  FXres->SetRateAdjust(ratio);
+}
+
 static void Cleanup(void)
 {
  if(pce_psg)
@@ -28,6 +28,7 @@ namespace MDFN_IEN_PCFX
 {
 
 bool SoundBox_SetSoundRate(uint32 rate);
+void SoundBox_SetSoundRateAdjust(double ratio);
 int32 SoundBox_Flush(const v810_timestamp_t timestamp, v810_timestamp_t* new_base_timestamp, int16 *SoundBuf, const int32 MaxSoundFrames, const bool reverse);
 void SoundBox_Write(uint32 A, uint16 V, const v810_timestamp_t timestamp);
 void SoundBox_Init(bool arg_EmulateBuggyCodec, bool arg_ResetAntiClickEnabled) MDFN_COLD;
@@ -0,0 +1,83 @@
+/******************************************************************************/
+/* Mednafen - Multi-system Emulator                                           */
+/******************************************************************************/
+/* profiler.cpp:
+**  Copyright (C) 2021 Mednafen Team
+**
+** This program is free software; you can redistribute it and/or
+** modify it under the terms of the GNU General Public License
+** as published by the Free Software Foundation; either version 2
+** of the License, or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "mednafen.h"
+#include "profiler.h"
+
+namespace Mednafen
+{
+
+namespace Profiler
+{
+
+Scope* Current = nullptr;
+int64 LastSwitch = 0;
+
+// Constant-initialized, so zones constructed during static initialization of other translation units are safe.
+static Zone* Head = nullptr;
+static Zone** Tail = &Head;
+
+Zone::Zone(const char* zname) : name(zname), ns(0), calls(0), next(nullptr)
+{
+ *Tail = this;
+ Tail = &next;
+}
+
+Zone* GetZones(void)
+{
+ return Head;
+}
+
+void Reset(void)
+{
+ for(Zone* z = Head; z; z = z->next)
+ {
+  z->ns = 0;
+  z->calls = 0;
+ }
+}
+
+void Report(const int64 wall_ns)
+{
+ int64 total_ns = 0;
+
+ for(Zone* z = Head; z; z = z->next)
+  total_ns += z->ns;
+
+ MDFN_printf(_("Profile:\n"));
+ {
+  MDFN_AutoIndent aind(1);
+
+  for(Zone* z = Head; z; z = z->next)
+  {
+   if(!z->calls)
+    continue;
+
+   MDFN_printf(_("%-24s %10.3f ms  %6.2f%%  %12llu calls  %8.1f ns/call\n"), z->name, z->ns / 1000000.0, (wall_ns > 0) ? (100.0 * z->ns / wall_ns) : 0.0, (unsigned long long)z->calls, (double)z->ns / z->calls);
+  }
+
+  MDFN_printf(_("%-24s %10.3f ms  %6.2f%%\n"), _("(other)"), (wall_ns - total_ns) / 1000000.0, (wall_ns > 0) ? (100.0 * (wall_ns - total_ns) / wall_ns) : 0.0);
+ }
+}
+
+}
+
+}
@@ -0,0 +1,107 @@
+/******************************************************************************/
+/* Mednafen - Multi-system Emulator                                           */
+/******************************************************************************/
+/* profiler.h:
+**  Copyright (C) 2021 Mednafen Team
+**
+** This program is free software; you can redistribute it and/or
+** modify it under the terms of the GNU General Public License
+** as published by the Free Software Foundation; either version 2
+** of the License, or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef __MDFN_PROFILER_H
+#define __MDFN_PROFILER_H
+
+#include <chrono>
+
+namespace Mednafen
+{
+
+//
+// Crude wall-clock profiler for emulation code.  Time is charged exclusively: while a nested scope is active, its
+// enclosing scope's zone isn't charged.  Only usable from the emulation thread.
+//
+// Zones and scopes compile to nothing unless MDFN_ENABLE_DEV_BUILD is defined.
+//
+namespace Profiler
+{
+ struct Zone
+ {
+  Zone(const char* zname);
+
+  const char* const name;
+  int64 ns;
+  uint64 calls;
+  Zone* next;
+ };
+
+ class Scope;
+
+ extern Scope* Current;
+ extern int64 LastSwitch;
+
+ static INLINE int64 Now(void)
+ {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+ }
+
+ class Scope
+ {
+  public:
+
+  INLINE Scope(Zone& z) : zone(&z), parent(Current)
+  {
+   const int64 now = Now();
+
+   if(parent)
+    parent->zone->ns += now - LastSwitch;
+
+   LastSwitch = now;
+   Current = this;
+   zone->calls++;
+  }
+
+  INLINE ~Scope()
+  {
+   const int64 now = Now();
+
+   zone->ns += now - LastSwitch;
+   LastSwitch = now;
+   Current = parent;
+  }
+
+  private:
+  Scope(const Scope&);
+  Scope& operator=(const Scope&);
+
+  Zone* zone;
+  Scope* parent;
+ };
+
+ Zone* GetZones(void);	// Linked list, in registration order.
+ void Reset(void);
+
+ // Prints each zone that was entered since the last Reset(), with its share of "wall_ns".
+ void Report(const int64 wall_ns);
+}
+
+#ifdef MDFN_ENABLE_DEV_BUILD
+ #define MDFN_PROFILE_ZONE(var, name) static Mednafen::Profiler::Zone var(name)
+ #define MDFN_PROFILE_SCOPE(var) Mednafen::Profiler::Scope MDFN_profile_scope_##var(var)
+#else
+ #define MDFN_PROFILE_ZONE(var, name)
+ #define MDFN_PROFILE_SCOPE(var)
+#endif
+
+}
+#endif
@@ -471,10 +471,7 @@ bool PS_CDC::DecodeSubQ(uint8 *subpw)
 {
  uint8 tmp_q[0xC];
 
- memset(tmp_q, 0, 0xC);
-
- for(int i = 0; i < 96; i++)
-  tmp_q[i >> 3] |= ((subpw[i] & 0x40) >> 6) << (7 - (i & 7));
+ subq_deinterleave(subpw, tmp_q);
 
  if((tmp_q[0] & 0xF) == 1)
  {
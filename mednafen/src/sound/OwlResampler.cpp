@@ -36,6 +36,16 @@
  #include <xmmintrin.h>
 #endif
 
+#if defined(ARCH_X86) && defined(__GNUC__)
+ // Avoid spurious warnings about the _mm512_undefined_*() used internally by some GCC 12 AVX-512 intrinsics.
+ #pragma GCC diagnostic push
+ #pragma GCC diagnostic ignored "-Wuninitialized"
+ #pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+ #include <immintrin.h>
+ #pragma GCC diagnostic pop
+ #define OWLRESAMP_AVX_INTRINSICS 1
+#endif
+
 namespace Mednafen
 {
 
@@ -54,6 +64,7 @@ OwlBuffer::OwlBuffer()
 
  InputIndex = 0;
  InputPhase = 0;
+ RateAdjustAccum = 0;
 
  debias = 0;
 }
@@ -183,10 +194,34 @@ static int32 ProcessLoop(unsigned count, int32 a, int32* b, int32* exmix0 = NULL
  return(a);
 }
 
+#ifdef OWLRESAMP_AVX_INTRINSICS
+ #include "OwlResampler_avx.inc"
+#endif
+
 void OwlBuffer::ResampleSkipped(unsigned count)
 {
- memmove(HRBuf, &HRBuf[count], HRBUF_OVERFLOW_PADDING * sizeof(HRBuf[0]));
- memset(&HRBuf[HRBUF_OVERFLOW_PADDING], 0, count * sizeof(HRBuf[0]));
+ memmove(Buf(), Buf() + count, HRBUF_OVERFLOW_PADDING * sizeof(HRBuf[0]));
+ memset(Buf() + HRBUF_OVERFLOW_PADDING, 0, count * sizeof(HRBuf[0]));
+}
+
+//
+// Between passes, everything in the buffer past the overflow area is zero, and the leftover area and resampler state
+// are only touched by OwlResampler::Resample().
+//
+void OwlBuffer::SaveSnapshot(Snapshot* s)
+{
+ memcpy(s->overflow, Buf(), sizeof(s->overflow));
+ s->accum = accum;
+ s->filter_state[0] = filter_state[0];
+ s->filter_state[1] = filter_state[1];
+}
+
+void OwlBuffer::LoadSnapshot(const Snapshot& s)
+{
+ memcpy(Buf(), s.overflow, sizeof(s.overflow));
+ accum = s.accum;
+ filter_state[0] = s.filter_state[0];
+ filter_state[1] = s.filter_state[1];
 }
 
 void OwlBuffer::Integrate(unsigned count, unsigned lp_shift, unsigned hp_shift, RavenBuffer* mixin0, RavenBuffer* mixin1)
@@ -203,6 +238,32 @@ void OwlBuffer::Integrate(unsigned count, unsigned lp_shift, unsigned hp_shift,
  }
  else
  {
+#ifdef OWLRESAMP_AVX_INTRINSICS
+  const int cpuext = cputest_get_flags();
+
+ #ifdef OWLRESAMP_AVX512
+  if(cpuext & CPUTEST_FLAG_AVX512)
+  {
+   if(mixin0 && mixin1)
+    accum = Integrate_AVX512<2>(count, accum, Buf(), mixin0->Buf(), mixin1->Buf());
+   else if(mixin0)
+    accum = Integrate_AVX512<1>(count, accum, Buf(), mixin0->Buf(), NULL);
+   else
+    accum = Integrate_AVX512<0>(count, accum, Buf(), NULL, NULL);
+  }
+  else
+ #endif
+  if(cpuext & CPUTEST_FLAG_AVX2)
+  {
+   if(mixin0 && mixin1)
+    accum = Integrate_AVX2<2>(count, accum, Buf(), mixin0->Buf(), mixin1->Buf());
+   else if(mixin0)
+    accum = Integrate_AVX2<1>(count, accum, Buf(), mixin0->Buf(), NULL);
+   else
+    accum = Integrate_AVX2<0>(count, accum, Buf(), NULL, NULL);
+  }
+  else
+#endif
   if(mixin0 && mixin1)
    accum = ProcessLoop<2, true, 3, false, false, true>(count, accum, Buf(), mixin0->Buf(), mixin1->Buf());
   else if(mixin0)
@@ -265,6 +326,22 @@ void RavenBuffer::Finish(unsigned count)
  memset(&BB[OwlBuffer::HRBUF_OVERFLOW_PADDING], 0, count * sizeof(BB[0]));
 }
 
+void RavenBuffer::SaveSnapshot(Snapshot* s)
+{
+ memcpy(s->overflow, BB, sizeof(s->overflow));
+ s->accum = accum;
+ s->filter_state[0] = filter_state[0];
+ s->filter_state[1] = filter_state[1];
+}
+
+void RavenBuffer::LoadSnapshot(const Snapshot& s)
+{
+ memcpy(BB, s.overflow, sizeof(s.overflow));
+ accum = s.accum;
+ filter_state[0] = s.filter_state[0];
+ filter_state[1] = s.filter_state[1];
+}
+
 static INLINE void DoMAC(float *wave, float *coeffs, int32 count, int32 *accum_output)
 {
  float acc[4] = { 0, 0, 0, 0 };
@@ -318,6 +395,14 @@ enum
 #else
  #warning "Compiling without AVX inline assembly."
 #endif
+
+#ifdef OWLRESAMP_AVX_INTRINSICS
+ SIMD_FMA_16X,
+#endif
+
+#ifdef OWLRESAMP_AVX512
+ SIMD_AVX512_16X,
+#endif
 #elif defined(HAVE_SSE_INTRINSICS)
  SIMD_SSE_16X,
 #elif defined(HAVE_ALTIVEC_INTRINSICS)
@@ -354,6 +439,9 @@ NO_INLINE int32 OwlResampler::T_Resample(OwlBuffer* in, const uint32 in_count, i
         uint32 InputIndex = in->InputIndex;
 	OwlBuffer::I32_F_Pudding* InSamps = in->BufPudding() - in->leftover;
 	int32 leftover;
+	const int64 adjust_step = RateAdjustStep;
+	const int64 adjust_unit = (int64)FracGCD << 32;
+	int64 adjust_accum = in->RateAdjustAccum;
 
 	if(MDFN_UNLIKELY(InputPhase >= NumPhases))
 	{
@@ -388,6 +476,18 @@ NO_INLINE int32 OwlResampler::T_Resample(OwlBuffer* in, const uint32 in_count, i
 		break;
 #endif
 
+#ifdef OWLRESAMP_AVX_INTRINSICS
+	  case SIMD_FMA_16X:
+		DoMAC_FMA_16X(wave, coeffs, coeff_count, I32Out);
+		break;
+#endif
+
+#ifdef OWLRESAMP_AVX512
+	  case SIMD_AVX512_16X:
+		DoMAC_AVX512_16X(wave, coeffs, coeff_count, I32Out);
+		break;
+#endif
+
 #elif defined(HAVE_SSE_INTRINSICS)
 	case SIMD_SSE_16X:
 		DoMAC_SSE_16X(wave, coeffs, coeff_count, I32Out);
@@ -408,6 +508,24 @@ NO_INLINE int32 OwlResampler::T_Resample(OwlBuffer* in, const uint32 in_count, i
 
          InputPhase = PInfos[InputPhase].Next;
          InputIndex += PInfos[InputPhase].Step;
+
+	 if(MDFN_UNLIKELY(adjust_step != 0))
+	 {
+	  adjust_accum += adjust_step;
+
+	  if(adjust_accum >= adjust_unit || adjust_accum <= -adjust_unit)
+	  {
+	   const int64 slip = adjust_accum / adjust_unit * FracGCD;
+	   const int64 pos = (int64)InputIndex * NumPhases + PhaseFrac[InputPhase] + slip;
+
+	   if(MDFN_LIKELY(pos >= 0))	// Otherwise, wait until we're further into the buffer.
+	   {
+	    InputIndex = pos / NumPhases;
+	    InputPhase = FracPhase[pos % NumPhases];
+	    adjust_accum -= slip * ((int64)1 << 32);
+	   }
+	  }
+	 }
         }
 
 #if defined(ARCH_X86) && defined(HAVE_INLINEASM_AVX)
@@ -489,16 +607,26 @@ NO_INLINE int32 OwlResampler::T_Resample(OwlBuffer* in, const uint32 in_count, i
 	in->leftover = leftover;
 	in->InputPhase = InputPhase;
 	in->InputIndex = InputIndex;
+	in->RateAdjustAccum = adjust_accum;
 
 	return count;
 }
 
+void OwlResampler::SetRateAdjust(double ratio)
+{
+ ratio = std::min<double>(1.01, std::max<double>(0.99, ratio));
+
+ // Input position advance per output sample is Ratio_Dividend / ratio, in units of 1/NumPhases input samples.
+ RateAdjustStep = (int64)floor(0.5 + (Ratio_Dividend / ratio - Ratio_Dividend) * 4294967296.0);
+}
+
 void OwlResampler::ResetBufResampState(OwlBuffer* buf)
 {
  memset(buf->HRBuf, 0, sizeof(buf->HRBuf[0]) * OwlBuffer::HRBUF_LEFTOVER_PADDING);
  buf->leftover = NumCoeffs;
  buf->InputIndex = 0;
  buf->InputPhase = 0;
+ buf->RateAdjustAccum = 0;
  buf->debias = 0;
 }
 
@@ -606,6 +734,26 @@ OwlResampler::OwlResampler(double input_rate, double output_rate, double rate_er
   Ratio_Dividend = findo_i;
   Ratio_Divisor = NumPhases;
 
+  PhaseFrac.resize(NumPhases);
+  FracPhase.assign(NumPhases, 0);
+
+  for(unsigned int i = 0; i < NumPhases; i++)
+  {
+   PhaseFrac[i] = ((uint64)i * findo_i) % NumPhases;
+   FracPhase[PhaseFrac[i]] = i;
+  }
+
+  FracGCD = NumPhases;
+  for(uint32 a = findo_i % NumPhases; a; )
+  {
+   const uint32 t = FracGCD % a;
+
+   FracGCD = a;
+   a = t;
+  }
+
+  RateAdjustStep = 0;
+
   MDFN_printf("Phases: %d, Output rate: %f, %d %d\n", NumPhases, input_rate * ratio, Ratio_Dividend, Ratio_Divisor);
 
   MDFN_printf("Desired maximum rate error: %.10f, Actual rate error: %.10f\n", rate_error, fabs((double)input_rate / output_rate * ratio - 1));
@@ -666,6 +814,26 @@ OwlResampler::OwlResampler(double input_rate, double output_rate, double rate_er
   abort();	// The sky is falling AAAAAAAAAAAAA
  }
  #ifdef ARCH_X86
+ #ifdef OWLRESAMP_AVX512
+ else if(cpuext & CPUTEST_FLAG_AVX512)
+ {
+  SIMDTypeString = "AVX-512 (intrinsics)";
+
+  // AVX-512 loop granularity is 16 MACs.
+  NumCoeffs = (NumCoeffs + 0xF) &~ 0xF;
+  Resample_ = &OwlResampler::T_Resample<SIMD_AVX512_16X>;
+ }
+ #endif
+ #ifdef OWLRESAMP_AVX_INTRINSICS
+ else if(cpuext & CPUTEST_FLAG_FMA3)
+ {
+  SIMDTypeString = "FMA (intrinsics)";
+
+  // FMA loop granularity is 16 MACs.
+  NumCoeffs = (NumCoeffs + 0xF) &~ 0xF;
+  Resample_ = &OwlResampler::T_Resample<SIMD_FMA_16X>;
+ }
+ #endif
  #ifdef HAVE_INLINEASM_AVX
  else if((cpuext & CPUTEST_FLAG_AVX) && (NumCoeffs + 0xF) >= 32)
  {
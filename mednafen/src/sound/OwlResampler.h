@@ -40,6 +40,20 @@ class OwlBuffer
 
  void StateAction(StateMem* sm, const unsigned load, const bool data_only, const char* sname_prefix, const unsigned scount);
 
+ //
+ // The state changed by a pass that ends with ResampleSkipped() rather than OwlResampler::Resample(); lets emulation modules
+ // undo run-ahead's speculative frames(see EmulateSpecStruct::RunAheadSpeculative), which StateAction() doesn't cover.
+ //
+ struct Snapshot
+ {
+  int32 overflow[HRBUF_OVERFLOW_PADDING];
+  int32 accum;
+  int64 filter_state[2];
+ };
+
+ void SaveSnapshot(Snapshot* s);
+ void LoadSnapshot(const Snapshot& s);
+
  INLINE void GetDebugInfo(int32* leftover_out, uint32* inputindex_out, uint32* inputphase_out)
  {
   *leftover_out = leftover;
@@ -64,6 +78,10 @@ class OwlBuffer
  // Current input phase
  uint32 InputPhase;
 
+ // Fractional input position owed by OwlResampler::SetRateAdjust(), in 32.32 fixed-point units of 1/NumPhases input samples.
+ // Not saved in save states.
+ int64 RateAdjustAccum;
+
  // DC bias removal filter thingy
  int64 debias;
 
@@ -85,6 +103,17 @@ class RavenBuffer
  void Process(unsigned count, bool integrate = true, uint32 lp_shift = 0);
  void Finish(unsigned count);
 
+ // See OwlBuffer::Snapshot.
+ struct Snapshot
+ {
+  int32 overflow[OwlBuffer::HRBUF_OVERFLOW_PADDING];
+  int32 accum;
+  int64 filter_state[2];
+ };
+
+ void SaveSnapshot(Snapshot* s);
+ void LoadSnapshot(const Snapshot& s);
+
  friend class OwlBuffer;
 
  private:
@@ -118,6 +147,13 @@ class OwlResampler
 	}
 	void ResetBufResampState(OwlBuffer* buf);
 
+	// Fine adjustment of the output rate, for dynamic rate control; "ratio" is the factor to scale the number of output samples
+	// per input sample by, clamped to [0.99, 1.01].  Takes effect on the next Resample(), and is cheap enough to call every frame.
+	//
+	// Done by nudging the input position of each buffer by whole multiples of 1/NumPhases of an input sample as the error
+	// accumulates, rather than rebuilding the filter, so a ratio of exactly 1.0 leaves the output unaffected.
+	void SetRateAdjust(double ratio);
+
 	// Get the InputRate / OutputRate ratio, expressed as a / b
 	void GetRatio(int32 *a, int32 *b)
 	{
@@ -156,6 +192,15 @@ class OwlResampler
 	};
 
 	std::vector<PhaseInfo> PInfos;
+
+	// Fractional part of the input position at each phase, in units of 1/NumPhases input samples, and the phase for each
+	// such fraction(only multiples of FracGCD occur).  For SetRateAdjust().
+	std::vector<uint32> PhaseFrac;
+	std::vector<uint32> FracPhase;
+	uint32 FracGCD;
+
+	// Per output sample, in the units of OwlBuffer::RateAdjustAccum; 0 if not adjusting.
+	int64 RateAdjustStep;
 	std::vector<float> CoeffsBuffer;
 	std::vector<int32> IntermediateBuffer; //int32 boobuf[8192];
 
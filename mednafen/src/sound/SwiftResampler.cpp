@@ -87,6 +87,8 @@ template<size_t align_mask>
 INLINE uint32 SwiftResampler::ResampLoop(int16* in, int32* out, uint32 max, void (*MAC_Function)(const int16* wave, const int16* coeffs, int32 count, int32* accum_output))
 {
  uint32 count = 0;
+ const int64 adjust_step = RateAdjustStep;
+ const int64 adjust_unit = (int64)FracGCD << 32;
 
  while(InputIndex < max)
  {
@@ -102,6 +104,24 @@ INLINE uint32 SwiftResampler::ResampLoop(int16* in, int32* out, uint32 max, void
 
   InputPhase = PhaseNext[InputPhase];
   InputIndex += PhaseStep[InputPhase];
+
+  if(MDFN_UNLIKELY(adjust_step != 0))
+  {
+   RateAdjustAccum += adjust_step;
+
+   if(RateAdjustAccum >= adjust_unit || RateAdjustAccum <= -adjust_unit)
+   {
+    const int64 slip = RateAdjustAccum / adjust_unit * FracGCD;
+    const int64 pos = (int64)InputIndex * NumPhases + PhaseFrac[InputPhase] + slip;
+
+    if(MDFN_LIKELY(pos >= 0))	// Otherwise, wait until we're further into the buffer.
+    {
+     InputIndex = pos / NumPhases;
+     InputPhase = FracPhase[pos % NumPhases];
+     RateAdjustAccum -= slip * ((int64)1 << 32);
+    }
+   }
+  }
  }
 
  return count;
@@ -218,6 +238,14 @@ void SwiftResampler::SetVolume(double newvolume)
  SoundVolume = (int32)(newvolume * 256);
 }
 
+void SwiftResampler::SetRateAdjust(double ratio)
+{
+ ratio = std::min<double>(1.01, std::max<double>(0.99, ratio));
+
+ // Input position advance per output sample is Ratio_Dividend / ratio, in units of 1/NumPhases input samples.
+ RateAdjustStep = (int64)floor(0.5 + (Ratio_Dividend / ratio - Ratio_Dividend) * 4294967296.0);
+}
+
 SwiftResampler::SwiftResampler(double input_rate, double output_rate, double rate_error, double hp_tc, int quality)
 {
  //
@@ -400,6 +428,24 @@ SwiftResampler::SwiftResampler(double input_rate, double output_rate, double rat
   Ratio_Dividend = findo_i;
   Ratio_Divisor = NumPhases;
 
+  PhaseFrac.reset(new uint32[NumPhases]);
+  FracPhase.reset(new uint32[NumPhases]());
+
+  for(unsigned int i = 0; i < NumPhases; i++)
+  {
+   PhaseFrac[i] = ((uint64)i * findo_i) % NumPhases;
+   FracPhase[PhaseFrac[i]] = i;
+  }
+
+  FracGCD = NumPhases;
+  for(uint32 a = findo_i % NumPhases; a; )
+  {
+   const uint32 t = FracGCD % a;
+
+   FracGCD = a;
+   a = t;
+  }
+
   MDFN_printf("Phases: %d, Output rate: %f, %d %d\n", NumPhases, input_rate * ratio, Ratio_Dividend, Ratio_Divisor);
 
   MDFN_printf("Desired rate error: %.10f, Actual rate error: %.10f\n", rate_error, fabs((double)input_rate / output_rate * ratio - 1));
@@ -603,6 +649,8 @@ SwiftResampler::SwiftResampler(double input_rate, double output_rate, double rat
 
  InputIndex = 0;
  InputPhase = 0;
+ RateAdjustStep = 0;
+ RateAdjustAccum = 0;
 
  debias = 0;
 
@@ -39,6 +39,10 @@ class SwiftResampler
 	 return (this->*SwiftResampler::Resample_)(in, out, maxoutlen, inlen, leftover);
 	}
 
+	// Fine adjustment of the output rate, for dynamic rate control; "ratio" is the factor to scale the number of output samples
+	// per input sample by, clamped to [0.99, 1.01].  Works as OwlResampler::SetRateAdjust() does.
+	void SetRateAdjust(double ratio);
+
 	// Get the InputRate / OutputRate ratio, expressed as a / b
 	INLINE void GetRatio(int32 *a, int32 *b)
 	{
@@ -78,6 +82,16 @@ class SwiftResampler
 	// Incrementor for InputIndex.  In the FIR loop, after updating InputPhase:  InputIndex += PhaseStep[InputPhase]
 	std::unique_ptr<uint32[]> PhaseStep;
 
+	// Fractional part of the input position at each phase, in units of 1/NumPhases input samples, and the phase for each
+	// such fraction(only multiples of FracGCD occur).  For SetRateAdjust().
+	std::unique_ptr<uint32[]> PhaseFrac;
+	std::unique_ptr<uint32[]> FracPhase;
+	uint32 FracGCD;
+
+	// In 32.32 fixed-point units of 1/NumPhases input samples; the step is per output sample, 0 if not adjusting.
+	int64 RateAdjustStep;
+	int64 RateAdjustAccum;
+
 	// One pointer for each phase in each possible alignment
 	std::unique_ptr<int16*[]> FIR_Coeffs;
 
@@ -46,6 +46,60 @@ const int OKIADPCM_StepIndexDeltas[16] =
  -1, -1, -1, -1, 2, 4, 6, 8
 };
 
+// OKIADPCM_StepIndexDeltas applied to each step size index, clamped to 0...48, for branch-free step adaptation.
+const uint8 OKIADPCM_NextStepSizeIndex[49][16] =
+{
+ /*  0 */ {  0,  0,  0,  0,  2,  4,  6,  8,  0,  0,  0,  0,  2,  4,  6,  8 },
+ /*  1 */ {  0,  0,  0,  0,  3,  5,  7,  9,  0,  0,  0,  0,  3,  5,  7,  9 },
+ /*  2 */ {  1,  1,  1,  1,  4,  6,  8, 10,  1,  1,  1,  1,  4,  6,  8, 10 },
+ /*  3 */ {  2,  2,  2,  2,  5,  7,  9, 11,  2,  2,  2,  2,  5,  7,  9, 11 },
+ /*  4 */ {  3,  3,  3,  3,  6,  8, 10, 12,  3,  3,  3,  3,  6,  8, 10, 12 },
+ /*  5 */ {  4,  4,  4,  4,  7,  9, 11, 13,  4,  4,  4,  4,  7,  9, 11, 13 },
+ /*  6 */ {  5,  5,  5,  5,  8, 10, 12, 14,  5,  5,  5,  5,  8, 10, 12, 14 },
+ /*  7 */ {  6,  6,  6,  6,  9, 11, 13, 15,  6,  6,  6,  6,  9, 11, 13, 15 },
+ /*  8 */ {  7,  7,  7,  7, 10, 12, 14, 16,  7,  7,  7,  7, 10, 12, 14, 16 },
+ /*  9 */ {  8,  8,  8,  8, 11, 13, 15, 17,  8,  8,  8,  8, 11, 13, 15, 17 },
+ /* 10 */ {  9,  9,  9,  9, 12, 14, 16, 18,  9,  9,  9,  9, 12, 14, 16, 18 },
+ /* 11 */ { 10, 10, 10, 10, 13, 15, 17, 19, 10, 10, 10, 10, 13, 15, 17, 19 },
+ /* 12 */ { 11, 11, 11, 11, 14, 16, 18, 20, 11, 11, 11, 11, 14, 16, 18, 20 },
+ /* 13 */ { 12, 12, 12, 12, 15, 17, 19, 21, 12, 12, 12, 12, 15, 17, 19, 21 },
+ /* 14 */ { 13, 13, 13, 13, 16, 18, 20, 22, 13, 13, 13, 13, 16, 18, 20, 22 },
+ /* 15 */ { 14, 14, 14, 14, 17, 19, 21, 23, 14, 14, 14, 14, 17, 19, 21, 23 },
+ /* 16 */ { 15, 15, 15, 15, 18, 20, 22, 24, 15, 15, 15, 15, 18, 20, 22, 24 },
+ /* 17 */ { 16, 16, 16, 16, 19, 21, 23, 25, 16, 16, 16, 16, 19, 21, 23, 25 },
+ /* 18 */ { 17, 17, 17, 17, 20, 22, 24, 26, 17, 17, 17, 17, 20, 22, 24, 26 },
+ /* 19 */ { 18, 18, 18, 18, 21, 23, 25, 27, 18, 18, 18, 18, 21, 23, 25, 27 },
+ /* 20 */ { 19, 19, 19, 19, 22, 24, 26, 28, 19, 19, 19, 19, 22, 24, 26, 28 },
+ /* 21 */ { 20, 20, 20, 20, 23, 25, 27, 29, 20, 20, 20, 20, 23, 25, 27, 29 },
+ /* 22 */ { 21, 21, 21, 21, 24, 26, 28, 30, 21, 21, 21, 21, 24, 26, 28, 30 },
+ /* 23 */ { 22, 22, 22, 22, 25, 27, 29, 31, 22, 22, 22, 22, 25, 27, 29, 31 },
+ /* 24 */ { 23, 23, 23, 23, 26, 28, 30, 32, 23, 23, 23, 23, 26, 28, 30, 32 },
+ /* 25 */ { 24, 24, 24, 24, 27, 29, 31, 33, 24, 24, 24, 24, 27, 29, 31, 33 },
+ /* 26 */ { 25, 25, 25, 25, 28, 30, 32, 34, 25, 25, 25, 25, 28, 30, 32, 34 },
+ /* 27 */ { 26, 26, 26, 26, 29, 31, 33, 35, 26, 26, 26, 26, 29, 31, 33, 35 },
+ /* 28 */ { 27, 27, 27, 27, 30, 32, 34, 36, 27, 27, 27, 27, 30, 32, 34, 36 },
+ /* 29 */ { 28, 28, 28, 28, 31, 33, 35, 37, 28, 28, 28, 28, 31, 33, 35, 37 },
+ /* 30 */ { 29, 29, 29, 29, 32, 34, 36, 38, 29, 29, 29, 29, 32, 34, 36, 38 },
+ /* 31 */ { 30, 30, 30, 30, 33, 35, 37, 39, 30, 30, 30, 30, 33, 35, 37, 39 },
+ /* 32 */ { 31, 31, 31, 31, 34, 36, 38, 40, 31, 31, 31, 31, 34, 36, 38, 40 },
+ /* 33 */ { 32, 32, 32, 32, 35, 37, 39, 41, 32, 32, 32, 32, 35, 37, 39, 41 },
+ /* 34 */ { 33, 33, 33, 33, 36, 38, 40, 42, 33, 33, 33, 33, 36, 38, 40, 42 },
+ /* 35 */ { 34, 34, 34, 34, 37, 39, 41, 43, 34, 34, 34, 34, 37, 39, 41, 43 },
+ /* 36 */ { 35, 35, 35, 35, 38, 40, 42, 44, 35, 35, 35, 35, 38, 40, 42, 44 },
+ /* 37 */ { 36, 36, 36, 36, 39, 41, 43, 45, 36, 36, 36, 36, 39, 41, 43, 45 },
+ /* 38 */ { 37, 37, 37, 37, 40, 42, 44, 46, 37, 37, 37, 37, 40, 42, 44, 46 },
+ /* 39 */ { 38, 38, 38, 38, 41, 43, 45, 47, 38, 38, 38, 38, 41, 43, 45, 47 },
+ /* 40 */ { 39, 39, 39, 39, 42, 44, 46, 48, 39, 39, 39, 39, 42, 44, 46, 48 },
+ /* 41 */ { 40, 40, 40, 40, 43, 45, 47, 48, 40, 40, 40, 40, 43, 45, 47, 48 },
+ /* 42 */ { 41, 41, 41, 41, 44, 46, 48, 48, 41, 41, 41, 41, 44, 46, 48, 48 },
+ /* 43 */ { 42, 42, 42, 42, 45, 47, 48, 48, 42, 42, 42, 42, 45, 47, 48, 48 },
+ /* 44 */ { 43, 43, 43, 43, 46, 48, 48, 48, 43, 43, 43, 43, 46, 48, 48, 48 },
+ /* 45 */ { 44, 44, 44, 44, 47, 48, 48, 48, 44, 44, 44, 44, 47, 48, 48, 48 },
+ /* 46 */ { 45, 45, 45, 45, 48, 48, 48, 48, 45, 45, 45, 45, 48, 48, 48, 48 },
+ /* 47 */ { 46, 46, 46, 46, 48, 48, 48, 48, 46, 46, 46, 46, 48, 48, 48, 48 },
+ /* 48 */ { 47, 47, 47, 47, 48, 48, 48, 48, 47, 47, 47, 47, 48, 48, 48, 48 },
+};
+
 const int32 OKIADPCM_DeltaTable[49][16] =
 {
  #ifndef OKIADPCM_GENERATE_DELTATABLE
@@ -34,6 +34,7 @@ typedef enum
 
 MDFN_HIDE extern const int OKIADPCM_StepSizes[49];
 MDFN_HIDE extern const int OKIADPCM_StepIndexDeltas[16];
+MDFN_HIDE extern const uint8 OKIADPCM_NextStepSizeIndex[49][16];
 MDFN_HIDE extern const int32 OKIADPCM_DeltaTable[49][16];
 
 template <OKIADPCM_Chip CHIP_TYPE> 
@@ -82,13 +83,7 @@ class OKIADPCM_Decoder
  {
   int32 ret = OKIADPCM_DeltaTable[StepSizeIndex][nibble];
 
-  StepSizeIndex += OKIADPCM_StepIndexDeltas[nibble];
-
-  if(StepSizeIndex < 0)
-   StepSizeIndex = 0;
-
-  if(StepSizeIndex > 48)
-   StepSizeIndex = 48;
+  StepSizeIndex = OKIADPCM_NextStepSizeIndex[StepSizeIndex][nibble];
 
   return(ret);
  }
@@ -113,6 +108,32 @@ class OKIADPCM_Decoder
   return(CurSample);
  }
 
+ // Equivalent to calling Decode() on each of "count" nibbles in turn, storing the results in "out", but faster for
+ // long runs.
+ INLINE void DecodeBlock(const uint8* nibbles, const uint32 count, uint16* out)
+ {
+  int32 cs = CurSample;
+  int32 ssi = StepSizeIndex;
+
+  for(uint32 i = 0; i < count; i++)
+  {
+   const uint8 nibble = nibbles[i];
+
+   cs += OKIADPCM_DeltaTable[ssi][nibble];
+   ssi = OKIADPCM_NextStepSizeIndex[ssi][nibble];
+
+   if(CHIP_TYPE == OKIADPCM_MSM5205)
+    cs &= 0xFFF;
+   else if(CHIP_TYPE == OKIADPCM_MSM5218)
+    cs = std::min<int32>(0xFFF, std::max<int32>(0, cs));
+
+   out[i] = cs;
+  }
+
+  CurSample = cs;
+  StepSizeIndex = ssi;
+ }
+
  private:
  int32 CurSample;
  int32 StepSizeIndex;
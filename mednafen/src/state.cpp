@@ -50,6 +50,8 @@ struct StateMem
  Stream* st = nullptr;
  bool svbe = false;	// State variable data is stored big-endian(for normal-path state loading only).
  int fuzz = MDFNSS_FUZZ_DISABLED;
+ bool incremental = false;	// MDFNSS_SaveSMIncremental()
+ uint32 inc_base = 0;		// 0 if the incremental save needs to save everything.
 
  std::map<std::string, StateSectionMapEntry> secmap; // For loads
 
@@ -300,23 +302,89 @@ static void ReadStateChunk(Stream *st, const SFORMAT *sf, const char* sname, uin
  }
 }
 
+uint32 SFDirtyTracker::Generation = 1;
+static uint32 IncInvalidGen = 1;
+
+void MDFNSS_InvalidateIncremental(void)
+{
+ IncInvalidGen = SFDirtyTracker::Generation;
+}
+
+//
+// Writes only the dirty pages of a dirty-tracked variable, seeking over the rest, which are left as-is from the previous
+// incremental save.
+//
+static void IncWriteChunk(StateMem* sm, SFDirtyTracker* dt, const uint8* p, const uint32 bytesize)
+{
+ Stream* const st = sm->st;
+ const uint64 start_pos = st->tell();
+
+ if(dt->last_pos != start_pos || dt->last_size != bytesize)
+ {
+  //
+  // State layout has changed since the previous incremental save, so nothing following this point in any stream can
+  // be trusted.  This has to be done even when saving everything, otherwise streams saved with the old layout would be
+  // considered valid again once the layout changes back.
+  //
+  MDFNSS_InvalidateIncremental();
+  sm->inc_base = 0;
+ }
+ else if((start_pos + bytesize) > st->size())
+  sm->inc_base = 0;
+
+ dt->last_pos = start_pos;
+ dt->last_size = bytesize;
+
+ if(!sm->inc_base)
+ {
+  st->write(p, bytesize);
+  return;
+ }
+
+ uint32 offs = 0;
+
+ while(offs < bytesize)
+ {
+  const bool dirty = dt->IsDirty(offs, sm->inc_base);
+  uint32 run_len = 0;
+
+  do
+  {
+   run_len += std::min<uint32>(SFDirtyTracker::PageSize, bytesize - (offs + run_len));
+  } while((offs + run_len) < bytesize && dt->IsDirty(offs + run_len, sm->inc_base) == dirty);
+
+  if(dirty)
+   st->write(p + offs, run_len);
+  else
+   st->seek(run_len, SEEK_CUR);
+
+  offs += run_len;
+ }
+}
+
 //
 // Fast raw chunk reader/writer.
 //
 template<bool load>
-static void FastRWChunk(Stream *st, const SFORMAT *sf)
+static void FastRWChunk(StateMem* sm, const SFORMAT *sf)
 {
+ Stream* const st = sm->st;
+
  while(sf->size || sf->name)	// Size can sometimes be zero, so also check for the text name.  These two should both be zero only at the end of a struct.
  {
   if(!sf->size || !sf->data)
   {
+   // Still record the layout of zero-sized dirty-tracked variables, so that IncWriteChunk() notices when they come back.
+   if(!load && sf->dirty && sm->incremental)
+    IncWriteChunk(sm, sf->dirty, nullptr, 0);
+
    sf++;
    continue;
   }
 
   if(sf->size == ~0U)		/* Link to another struct.	*/
   {
-   FastRWChunk<load>(st, (const SFORMAT *)sf->data);
+   FastRWChunk<load>(sm, (const SFORMAT *)sf->data);
 
    sf++;
    continue;
@@ -343,6 +411,8 @@ static void FastRWChunk(Stream *st, const SFORMAT *sf)
   {
    if(load)
     st->read((void*)p, bytesize);
+   else if(sf->dirty && sm->incremental)
+    IncWriteChunk(sm, sf->dirty, (const uint8*)p, bytesize);
    else
     st->write((void*)p, bytesize);
   } while(p += repstride, repcount--);
@@ -381,7 +451,7 @@ bool MDFNSS_StateAction(StateMem *sm, const unsigned load, const bool data_only,
     if(memcmp(sname_canary + 32, SSFastCanary, 8))
      throw MDFN_Error(0, _("Section canary is a zombie AAAAAAAAAAGH!"));
 
-    FastRWChunk<true>(st, sf);
+    FastRWChunk<true>(sm, sf);
    }
    else
    {
@@ -390,7 +460,7 @@ bool MDFNSS_StateAction(StateMem *sm, const unsigned load, const bool data_only,
     memcpy(sname_canary + 32, SSFastCanary, 8);
     st->write(sname_canary, 32 + 8);
 
-    FastRWChunk<false>(st, sf);
+    FastRWChunk<false>(sm, sf);
    }
   }
   else
@@ -585,6 +655,47 @@ void MDFNSS_SaveSM(Stream *st, bool data_only, const MDFN_Surface *surface, cons
 	}
 }
 
+void MDFNSS_SaveSMIncremental(Stream* st, uint32* gen)
+{
+	if(!MDFNGameInfo->StateAction)
+	{
+	 throw MDFN_Error(0, _("Module \"%s\" doesn't support save states."), MDFNGameInfo->shortname);
+	}
+
+	StateMem sm(st);
+
+	sm.incremental = true;
+	sm.inc_base = (*gen >= IncInvalidGen) ? *gen : 0;
+	*gen = 0;	// In case of error.
+
+	st->rewind();
+	MDFN_StateAction(&sm, 0, true);
+	sm.ThrowDeferred();
+
+	if(st->size() > st->tell())
+	 st->truncate(st->tell());
+
+	*gen = SFDirtyTracker::Generation++;
+}
+
+void MDFNSS_LoadSMIncremental(Stream* st)
+{
+	if(!MDFNGameInfo->StateAction)
+	{
+	 throw MDFN_Error(0, _("Module \"%s\" doesn't support save states."), MDFNGameInfo->shortname);
+	}
+
+	//
+	// Every page written since the state was saved has been marked with a newer generation, so restoring it leaves all
+	// incremental save bases valid.
+	//
+	StateMem sm(st);
+
+	st->rewind();
+	MDFN_StateAction(&sm, MEDNAFEN_VERSION_NUMERIC, true);
+	sm.ThrowDeferred();
+}
+
 void MDFNSS_LoadSM(Stream *st, bool data_only, const int fuzz)
 {
 	if(!MDFNGameInfo->StateAction)
@@ -592,6 +703,8 @@ void MDFNSS_LoadSM(Stream *st, bool data_only, const int fuzz)
 	 throw MDFN_Error(0, _("Module \"%s\" doesn't support save states."), MDFNGameInfo->shortname);
 	}
 
+	MDFNSS_InvalidateIncremental();
+
 	if(MDFN_LIKELY(data_only))
 	{
 	 StateMem sm(st);
@@ -659,6 +772,7 @@ void MDFNSS_LoadInternal(Stream* st, void (*safunc)(StateMem*, const unsigned, c
  if(!MDFNGameInfo->StateAction)
   throw MDFN_Error(0, _("Module \"%s\" doesn't support save states."), MDFNGameInfo->shortname);
  //
+ MDFNSS_InvalidateIncremental();
  StateMem sm(st);
  safunc(&sm, MEDNAFEN_VERSION_NUMERIC, true);
  sm.ThrowDeferred();
@@ -59,12 +59,79 @@ enum : int
 void MDFNSS_SaveSM(Stream *st, bool data_only = false, const MDFN_Surface *surface = (MDFN_Surface *)NULL, const MDFN_Rect *DisplayRect = (MDFN_Rect*)NULL, const int32 *LineWidths = (int32*)NULL);
 void MDFNSS_LoadSM(Stream *st, bool data_only = false, const int fuzz = MDFNSS_FUZZ_DISABLED);
 
+//
+// Like MDFNSS_SaveSM() with data_only == true, but saves over the existing contents of "st", starting at position 0, and
+// skips copying the pages of dirty-tracked state variables(see SFDirtyTracker) that haven't been written to since the
+// previous call with the same "st".
+//
+// "*gen" should be 0 for a newly-created stream, and must otherwise be the value that the previous call with "st" stored
+// into it; "st" must not have been modified in the meantime.
+//
+// throws exceptions on errors.
+//
+void MDFNSS_SaveSMIncremental(Stream* st, uint32* gen);
+
+//
+// Loads a state saved with MDFNSS_SaveSMIncremental(), without the MDFNSS_InvalidateIncremental() that MDFNSS_LoadSM() does; for
+// rolling back speculative emulation, so only valid if "st" was the most recent incremental save made with any stream.
+//
+// throws exceptions on errors.
+//
+void MDFNSS_LoadSMIncremental(Stream* st);
+
+//
+// Forces the next MDFNSS_SaveSMIncremental() call with any stream to save everything; call this after any change to
+// dirty-tracked memory that bypasses SFDirtyTracker::Mark(), such as a power toggle, reset, or cheat application.
+//
+// Loading a save state calls this internally.
+//
+void MDFNSS_InvalidateIncremental(void);
+
 void MDFNSS_CheckStates(void);
 
 // For emulation modules' internal use.
 void MDFNSS_SaveInternal(Stream* st, void (*safunc)(StateMem*, const unsigned, const bool));
 void MDFNSS_LoadInternal(Stream* st, void (*safunc)(StateMem*, const unsigned, const bool));
 
+//
+// Dirty-page tracking for large state variables(e.g. RAM), so that MDFNSS_SaveSMIncremental() only needs to copy pages that
+// have changed.
+//
+// The emulation module calls Mark() on every write to the memory(excepting power/reset and state loading), and attaches
+// the tracker to the variable's SFORMAT entry with SFDIRTY().
+//
+class SFDirtyTracker
+{
+ public:
+
+ enum : uint32 { PageShift = 10 };
+ enum : uint32 { PageSize = 1U << PageShift };
+
+ SFDirtyTracker(const uint32 max_bytesize) : page_gen((max_bytesize + PageSize - 1) >> PageShift, 0)
+ {
+
+ }
+
+ INLINE void Mark(const uint32 offset)
+ {
+  page_gen[offset >> PageShift] = Generation;
+ }
+
+ INLINE bool IsDirty(const uint32 offset, const uint32 base_gen) const
+ {
+  return page_gen[offset >> PageShift] > base_gen;
+ }
+
+ static uint32 Generation;
+
+ // Stream position and size of the variable in the most recent incremental save, used to detect state layout changes.
+ uint64 last_pos = ~(uint64)0;
+ uint32 last_size = 0;
+
+ private:
+ std::vector<uint32> page_gen;
+};
+
 struct SFORMAT
 {
 	//
@@ -101,6 +168,7 @@ struct SFORMAT
 	FORM form;
 	uint32 repcount;
 	uint32 repstride;
+	SFDirtyTracker* dirty;	// Optional; see SFDIRTY().
 };
 
 static INLINE int8* SF_FORCE_A8(int8* p) { return p; }
@@ -156,6 +224,7 @@ static INLINE SFORMAT SFBASE_(IT* const iv, uint32 icount, const uint32 totalcou
   ret.type = sizeof(T);
  }
  ret.form = form;
+ ret.dirty = nullptr;
 
  return ret;
 }
@@ -206,6 +275,20 @@ static INLINE SFORMAT SFCONDVAR_(const bool cond, const SFORMAT sf)
  #define SFCONDVAR(cond, x, ...) SFCONDVAR_(cond, SFVAR(x, ## __VA_ARGS__))
 #endif
 
+//
+// Attaches a dirty-page tracker to a (non-repeating) variable, e.g.:
+//	SFDIRTY(&BaseRAM_Dirty, SFPTR8(BaseRAM, 8192)),
+//
+static INLINE SFORMAT SFDIRTY_(SFDirtyTracker* const dt, SFORMAT sf)
+{
+ assert(!sf.repcount);
+ sf.dirty = dt;
+
+ return sf;
+}
+
+#define SFDIRTY(dt, sf) SFDIRTY_((dt), sf)
+
 static_assert(sizeof(double) == 8, "sizeof(double) != 8");
 
 #define SFPTR8N(x, ...)		SFBASE_(SF_FORCE_A8(x), __VA_ARGS__)
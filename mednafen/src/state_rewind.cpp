@@ -23,13 +23,12 @@
 #include "state.h"
 #include "movie.h"
 #include "state_rewind.h"
+#include "netplay.h"
 
 #include <mednafen/MemoryStream.h>
-#include <mednafen/quicklz/quicklz.h>
-
-#if QLZ_COMPRESSION_LEVEL != 0
- #error "State rewinding code untested with QLZ_COMPRESSION_LEVEL != 0"
-#endif
+#include <mednafen/MThreading.h>
+#include <mednafen/Time.h>
+#include <mednafen/compress/BlockCompressor.h>
 
 namespace Mednafen
 {
@@ -40,24 +39,353 @@ struct StateMemPacket
 	uint32 uncompressed_len = 0;
 };
 
+//
+// Every "srwkeyinterval" recorded frames, the current state is also compressed on its own(without the XOR filter) and
+// kept as a keyframe, so that history older than the delta ring can still be reached.  Keyframes are thinned out, oldest
+// first, to keep the total memory used by the rewind history under "srwbudget".
+//
+// A std::list is used so that erasing keyframes doesn't invalidate the packet pointers held by pending compression jobs.
+//
+struct KeyFrame
+{
+	uint64 frame;
+	StateMemPacket packet;
+};
+
 static bool Active = false;
 static bool Enabled = false;
 static std::vector<StateMemPacket> bcs;
 static size_t bcs_pos;
+static std::list<KeyFrame> keyframes;
+static uint32 KeyInterval;
+static uint64 Budget;
+static uint64 HistoryBytes;	// Compressed size of everything in bcs and keyframes; protected by Worker.mutex while the worker thread exists.
 
 static uint32 SRW_AllocHint;
 static std::unique_ptr<MemoryStream> ss_prev;
+static uint32 ss_prev_gen;
+static uint64 RecFrame;		// Number of the recorded frame held in ss_prev.
+
+//
+// The XOR filter and compressor are run over the save state in chunks of this size, rather than over the
+// whole save state in one go, so that the previous state chunk, the current state chunk, the compressor's hash table,
+// and the output all stay resident in L2 cache.
+//
+// QuickLZ(level 0, non-streaming) clears its 64KiB hash table on every call, so don't make this much smaller.
+//
+// Each compressed chunk is stored with its compressed size prepended, as a 32-bit little-endian value.
+//
+enum : uint32 { ChunkSize = 65536 };
+
+//
+// Selected with "srwcompressor".  Compression only happens on one thread at a time(the worker thread, if it exists), and
+// decompression only once all compression jobs are finished.
+//
+static std::unique_ptr<BlockCompressor> Comp;
+static unsigned CompType;
+static uint32 DictStatesLeft;	// Number of states left to sample for Comp's dictionary; only accessed from the compressing thread.
+
+static struct
+{
+ int64 peak_us;
+ int64 total_us;
+ uint64 frames;
+} Cost;
+
+//
+// Scratch buffer used by the worker thread while it's busy, and by the emulation thread otherwise.
+//
+alignas(16) static uint8 xor_scratch[ChunkSize];
+
+//
+// When "srwthread" is enabled, the emulation thread only saves the current state, and the XOR filtering and compression
+// of the previous state(and of keyframes) is handed off to a worker thread.  Jobs are processed strictly in order, and at
+// most MaxPendingJobs may be outstanding, which bounds both memory usage and how long the emulation thread can end up waiting.
+//
+struct CompressJob
+{
+ MemoryStream* src = nullptr;	// Not owned, unless it's "retire".
+ MemoryStream* ref = nullptr;	// Not owned, may be null; the emulation thread doesn't free or modify "src" and "ref" until the job is finished.
+ std::unique_ptr<MemoryStream> retire;	// Handed to PutSpare() once the job is finished.
+ uint32 retire_gen = 0;
+ StateMemPacket* smp = nullptr;
+};
+
+enum : unsigned { MaxPendingJobs = 4 };
 
-static union
+static struct
 {
- char compress[QLZ_SCRATCH_COMPRESS];
- char decompress[QLZ_SCRATCH_DECOMPRESS];
-} qlz_scratch;
+ MThreading::Thread* thread = nullptr;
+ MThreading::Mutex* mutex = nullptr;
+ MThreading::Sem* work_sem = nullptr;
+ MThreading::Sem* done_sem = nullptr;
+
+ // Protected by mutex.
+ CompressJob jobs[MaxPendingJobs];
+ unsigned job_read_pos = 0;
+ unsigned job_write_pos = 0;
+ bool exit = false;
+ std::string error;
+
+ // Only accessed from the emulation thread.
+ unsigned in_flight = 0;
+} Worker;
+
+//
+// The most recently retired state buffer, and its MDFNSS_SaveSMIncremental() generation, kept around so that the next
+// save only needs to copy memory that has changed since.  Protected by Worker.mutex while the worker thread exists.
+//
+static std::unique_ptr<MemoryStream> ss_spare;
+static uint32 ss_spare_gen;
+
+static void PutSpare(std::unique_ptr<MemoryStream> ms, const uint32 gen) noexcept
+{
+ if(Worker.mutex)
+  MThreading::Mutex_Lock(Worker.mutex);
+
+ std::swap(ss_spare, ms);
+ ss_spare_gen = gen;
+
+ if(Worker.mutex)
+  MThreading::Mutex_Unlock(Worker.mutex);
+
+ // Previous spare, if any, is freed here outside of the lock.
+}
+
+static std::unique_ptr<MemoryStream> TakeSpare(uint32* gen) noexcept
+{
+ std::unique_ptr<MemoryStream> ret;
+
+ if(Worker.mutex)
+  MThreading::Mutex_Lock(Worker.mutex);
+
+ ret = std::move(ss_spare);
+ *gen = ss_spare_gen;
+
+ if(Worker.mutex)
+  MThreading::Mutex_Unlock(Worker.mutex);
+
+ return ret;
+}
+
+//
+// Locks Worker.mutex for the lifetime of the object, if the worker thread exists.
+//
+class HistoryLock
+{
+ public:
+ HistoryLock()
+ {
+  if(Worker.mutex)
+   MThreading::Mutex_Lock(Worker.mutex);
+ }
+
+ ~HistoryLock()
+ {
+  if(Worker.mutex)
+   MThreading::Mutex_Unlock(Worker.mutex);
+ }
+};
+
+//
+// Must be called with HistoryLock held; returns the old data, so it can be freed outside of the lock.
+//
+static std::unique_ptr<MemoryStream> SetPacket(StateMemPacket* smp, std::unique_ptr<MemoryStream> data, const uint32 uncompressed_len)
+{
+ if(smp->data)
+  HistoryBytes -= smp->data->size();
+
+ if(data)
+  HistoryBytes += data->size();
+
+ std::swap(smp->data, data);
+ smp->uncompressed_len = uncompressed_len;
+
+ return data;
+}
+
+static void ClearPacket(StateMemPacket* smp)
+{
+ std::unique_ptr<MemoryStream> old;
+ {
+  HistoryLock lock;
+  old = SetPacket(smp, nullptr, 0);
+ }
+}
+
+static std::unique_ptr<MemoryStream> DoXORCompress(MemoryStream* src, MemoryStream* ref);
+
+static void DoJob(CompressJob* job)
+{
+ std::unique_ptr<MemoryStream> data = DoXORCompress(job->src, job->ref);
+ {
+  HistoryLock lock;
+  data = SetPacket(job->smp, std::move(data), job->src->size());
+ }
+}
+
+static int WorkerThreadEntry(void*)
+{
+ for(;;)
+ {
+  CompressJob job;
+
+  MThreading::Sem_Wait(Worker.work_sem);
+
+  MThreading::Mutex_Lock(Worker.mutex);
+  if(Worker.exit)
+  {
+   MThreading::Mutex_Unlock(Worker.mutex);
+   break;
+  }
+  job = std::move(Worker.jobs[Worker.job_read_pos]);
+  Worker.job_read_pos = (Worker.job_read_pos + 1) % MaxPendingJobs;
+  MThreading::Mutex_Unlock(Worker.mutex);
+
+  try
+  {
+   DoJob(&job);
+  }
+  catch(std::exception& e)
+  {
+   MThreading::Mutex_Lock(Worker.mutex);
+   try
+   {
+    if(Worker.error.empty())
+     Worker.error = e.what();
+   }
+   catch(...)
+   {
+    fprintf(stderr, "State rewinding worker thread error: %s\n", e.what());
+   }
+   MThreading::Mutex_Unlock(Worker.mutex);
+  }
+
+  if(job.retire)
+   PutSpare(std::move(job.retire), job.retire_gen);
+
+  MThreading::Sem_Post(Worker.done_sem);
+ }
+
+ return 0;
+}
+
+//
+// Waits for the oldest outstanding job to finish, and throws any error the worker thread encountered.
+//
+static void WaitJob(void)
+{
+ std::string error;
+
+ MThreading::Sem_Wait(Worker.done_sem);
+ Worker.in_flight--;
+
+ MThreading::Mutex_Lock(Worker.mutex);
+ std::swap(error, Worker.error);
+ MThreading::Mutex_Unlock(Worker.mutex);
+
+ if(!error.empty())
+  throw MDFN_Error(0, "%s", error.c_str());
+}
+
+static void WaitAllJobs(void)
+{
+ while(Worker.in_flight)
+  WaitJob();
+}
+
+static void QueueJob(CompressJob job)
+{
+ while(Worker.in_flight >= MaxPendingJobs)
+  WaitJob();
+
+ MThreading::Mutex_Lock(Worker.mutex);
+ {
+  Worker.jobs[Worker.job_write_pos] = std::move(job);
+  Worker.job_write_pos = (Worker.job_write_pos + 1) % MaxPendingJobs;
+ }
+ MThreading::Mutex_Unlock(Worker.mutex);
+
+ Worker.in_flight++;
+ MThreading::Sem_Post(Worker.work_sem);
+}
+
+static void StartWorker(void)
+{
+ Worker.mutex = MThreading::Mutex_Create();
+ Worker.work_sem = MThreading::Sem_Create();
+ Worker.done_sem = MThreading::Sem_Create();
+ Worker.job_read_pos = 0;
+ Worker.job_write_pos = 0;
+ Worker.exit = false;
+ Worker.error.clear();
+ Worker.in_flight = 0;
+
+ Worker.thread = MThreading::Thread_Create(WorkerThreadEntry, nullptr, "MDFN State Rewind");
+}
+
+static void StopWorker(void) noexcept
+{
+ if(Worker.thread)
+ {
+  while(Worker.in_flight)
+  {
+   MThreading::Sem_Wait(Worker.done_sem);
+   Worker.in_flight--;
+  }
+
+  MThreading::Mutex_Lock(Worker.mutex);
+  Worker.exit = true;
+  MThreading::Mutex_Unlock(Worker.mutex);
+  MThreading::Sem_Post(Worker.work_sem);
+
+  try
+  {
+   MThreading::Thread_Wait(Worker.thread, nullptr);
+  }
+  catch(std::exception& e)
+  {
+   MDFN_Notify(MDFN_NOTICE_ERROR, _("State rewinding error: %s"), e.what());
+  }
+  Worker.thread = nullptr;
+ }
+
+ for(CompressJob& job : Worker.jobs)
+  job = CompressJob();
+
+ Worker.error.clear();
+
+ if(Worker.done_sem)
+ {
+  MThreading::Sem_Destroy(Worker.done_sem);
+  Worker.done_sem = nullptr;
+ }
+
+ if(Worker.work_sem)
+ {
+  MThreading::Sem_Destroy(Worker.work_sem);
+  Worker.work_sem = nullptr;
+ }
+
+ if(Worker.mutex)
+ {
+  MThreading::Mutex_Destroy(Worker.mutex);
+  Worker.mutex = nullptr;
+ }
+}
 
 static void Cleanup(void)
 {
+ StopWorker();
+ Comp.reset(nullptr);
  bcs.clear();
+ keyframes.clear();
+ HistoryBytes = 0;
  ss_prev.reset(nullptr);
+ ss_prev_gen = 0;
+ ss_spare.reset(nullptr);
+ ss_spare_gen = 0;
+ RecFrame = 0;
 }
 
 void MDFNSRW_Begin(void) noexcept
@@ -71,10 +399,21 @@ void MDFNSRW_Begin(void) noexcept
   {
    bcs.resize(std::max<size_t>(3, MDFN_GetSettingUI("srwframes")) - 1);
    bcs_pos = 0;
-   memset(&qlz_scratch, 0, sizeof(qlz_scratch));
+   KeyInterval = MDFN_GetSettingUI("srwkeyinterval");
+   // Without keyframes, "srwframes" alone bounds the history.
+   Budget = KeyInterval ? (MDFN_GetSettingUI("srwbudget") << 20) : ~(uint64)0;
+   HistoryBytes = 0;
+   RecFrame = 0;
+   CompType = MDFN_GetSettingI("srwcompressor");
+   Comp.reset(BlockCompressor::Create(CompType));
+   DictStatesLeft = MDFN_GetSettingUI("srwdictframes");
+   memset(&Cost, 0, sizeof(Cost));
 
    SRW_AllocHint = 8192;
 
+   if(MDFN_GetSettingB("srwthread"))
+    StartWorker();
+
    Active = true;
   }
   catch(std::exception &e)
@@ -90,6 +429,9 @@ void MDFNSRW_End(void) noexcept
 {
  if(Active)
  {
+  if(Cost.frames)
+   MDFN_printf(_("State rewinding(%s): %llu frames recorded, average cost %lld us/frame, peak cost %lld us/frame.\n"), BlockCompressor::GetName(CompType), (unsigned long long)Cost.frames, (long long)(Cost.total_us / Cost.frames), (long long)Cost.peak_us);
+
   Cleanup();
 
   Active = false;
@@ -101,31 +443,216 @@ bool MDFNSRW_IsRunning(void) noexcept
  return Active;
 }
 
-static INLINE void DoXORFilter(MemoryStream* prev, MemoryStream* cur) noexcept
+//
+// Compresses "src" XOR "ref", one chunk at a time; "src" and "ref" are left unmodified, so that "src" can be
+// reused for an incremental save later.  "ref" may be null, for keyframes.
+//
+static std::unique_ptr<MemoryStream> DoXORCompress(MemoryStream* src, MemoryStream* ref)
 {
- MDFN_FastMemXOR(prev->map(), cur->map(), std::min(prev->size(), cur->size()));
-}
+ const uint32 uncompressed_len = src->size();
+ const uint32 xor_len = ref ? std::min<uint64>(uncompressed_len, ref->size()) : 0;
+ const uint32 num_chunks = (uncompressed_len + ChunkSize - 1) / ChunkSize;
+ const uint64 max_compressed_len = (uint64)num_chunks * (4 + Comp->MaxCompressedSize(ChunkSize));
+ std::unique_ptr<MemoryStream> tmp_buf(new MemoryStream(max_compressed_len, -1));
+ const uint8* const pp = src->map();
+ const uint8* const cp = ref ? ref->map() : nullptr;
+ uint8* const dp = tmp_buf->map();
+ uint64 dst_len = 0;
 
+ for(uint32 offs = 0; offs < uncompressed_len; offs += ChunkSize)
+ {
+  const uint32 chunk_len = std::min<uint32>(ChunkSize, uncompressed_len - offs);
+  uint32 clen;
 
-static INLINE std::unique_ptr<MemoryStream> DoCompress(MemoryStream* data)
-{
- const uint32 uncompressed_len = data->size();
- const uint32 max_compressed_len = (uncompressed_len + 400);
- std::unique_ptr<MemoryStream> tmp_buf(new MemoryStream(max_compressed_len, -1));
- uint32 dst_len;
+  memcpy(xor_scratch, pp + offs, chunk_len);
+
+  if(offs < xor_len)
+   MDFN_FastMemXOR(xor_scratch, cp + offs, std::min<uint32>(chunk_len, xor_len - offs));
+
+  if(DictStatesLeft)
+   Comp->AddDictionarySample(xor_scratch, chunk_len);
+
+  clen = Comp->Compress(xor_scratch, chunk_len, dp + dst_len + 4);
+  MDFN_en32lsb(dp + dst_len, clen);
+  dst_len += 4 + clen;
+ }
+
+ if(DictStatesLeft && !--DictStatesLeft)
+  Comp->TrainDictionary();
 
- dst_len = qlz_compress(data->map(), (char*)tmp_buf->map(), uncompressed_len, qlz_scratch.compress);
  tmp_buf->truncate(dst_len);
  tmp_buf->shrink_to_fit();
 
  return tmp_buf;
 }
 
+//
+// Inverse of DoXORCompress(); decompresses "smp" one chunk at a time, XORing each chunk with "ref"(if not null).
+//
+static std::unique_ptr<MemoryStream> DoDecompressXOR(const StateMemPacket* smp, MemoryStream* ref)
+{
+ const uint32 uncompressed_len = smp->uncompressed_len;
+ const uint32 xor_len = ref ? std::min<uint64>(uncompressed_len, ref->size()) : 0;
+ const uint64 compressed_len = smp->data->size();
+ std::unique_ptr<MemoryStream> ret(new MemoryStream(uncompressed_len, -1));
+ const uint8* const sp = smp->data->map();
+ const uint8* const cp = ref ? ref->map() : nullptr;
+ uint8* const dp = ret->map();
+ uint64 src_offs = 0;
+
+ for(uint32 offs = 0; offs < uncompressed_len; offs += ChunkSize)
+ {
+  const uint32 chunk_len = std::min<uint32>(ChunkSize, uncompressed_len - offs);
+  uint32 clen;
+
+  if((compressed_len - src_offs) < 4 || (clen = MDFN_de32lsb(sp + src_offs)) > (compressed_len - src_offs - 4))
+   throw MDFN_Error(0, _("Compressed state data is truncated."));
+
+  Comp->Decompress(sp + src_offs + 4, clen, dp + offs, chunk_len);
+  src_offs += 4 + clen;
+
+  if(offs < xor_len)
+   MDFN_FastMemXOR(dp + offs, cp + offs, std::min<uint32>(chunk_len, xor_len - offs));
+ }
+
+ return ret;
+}
+
+//
+// Number of consecutive deltas, going back from ss_prev, that are available in the ring.
+//
+static size_t CountDeltas(void)
+{
+ size_t ret = 0;
+
+ while(ret < bcs.size() && bcs[(bcs_pos + bcs.size() - 1 - ret) % bcs.size()].data)
+  ret++;
+
+ return ret;
+}
+
+//
+// Must only be called with no jobs outstanding.
+//
+static void ClearDeltas(void)
+{
+ for(StateMemPacket& smp : bcs)
+  ClearPacket(&smp);
+
+ bcs_pos = 0;
+}
+
+static void PruneKeyFrames(void)
+{
+ while(keyframes.size() && keyframes.back().frame > RecFrame)
+ {
+  ClearPacket(&keyframes.back().packet);
+  keyframes.pop_back();
+ }
+}
+
+//
+// Replaces ss_prev with the state from keyframe "kf".
+//
+static void LoadKeyFrame(const KeyFrame& kf)
+{
+ std::unique_ptr<MemoryStream> tmp = DoDecompressXOR(&kf.packet, nullptr);
+
+ std::swap(ss_prev, tmp);
+ PutSpare(std::move(tmp), ss_prev_gen);
+ ss_prev_gen = 0;
+ RecFrame = kf.frame;
+}
+
+//
+// Replaces ss_prev with the state from the most recent delta.
+//
+static void PopDelta(void)
+{
+ StateMemPacket* smp = &bcs[(bcs_pos + bcs.size() - 1) % bcs.size()];
+ std::unique_ptr<MemoryStream> tmp = DoDecompressXOR(smp, ss_prev.get());
+
+ ClearPacket(smp);
+ bcs_pos = (bcs_pos + bcs.size() - 1) % bcs.size();
+ //
+ std::swap(ss_prev, tmp);
+ PutSpare(std::move(tmp), ss_prev_gen);
+ ss_prev_gen = 0;
+ RecFrame--;
+}
+
+//
+// Throws away history until it fits in the memory budget.  Keyframes go first, picking the one whose removal leaves the smallest
+// gap between its neighbours relative to its age, so that older history gets progressively sparser; the newest keyframe, and the
+// oldest if others are left, are kept for as long as possible.  After that, the oldest deltas are dropped.
+//
+// Packets still waiting on the worker thread are never touched.
+//
+static void TrimHistory(void)
+{
+ std::list<KeyFrame> garbage;
+ HistoryLock lock;
+
+ while(HistoryBytes > Budget && keyframes.size() > 1)
+ {
+  auto victim = keyframes.end();
+  double victim_score = 0;
+
+  for(auto it = keyframes.begin(); std::next(it) != keyframes.end(); ++it)
+  {
+   if(!it->packet.data)
+    continue;
+
+   const double age = RecFrame - it->frame + 1;
+   double score;
+
+   if(it == keyframes.begin())
+    score = HUGE_VAL;
+   else
+    score = (std::next(it)->frame - std::prev(it)->frame) / age;
+
+   if(victim == keyframes.end() || score < victim_score)
+   {
+    victim = it;
+    victim_score = score;
+   }
+  }
+
+  if(victim == keyframes.end())
+   break;
+
+  HistoryBytes -= victim->packet.data->size();
+  garbage.splice(garbage.end(), keyframes, victim);
+ }
+
+ //
+ // Pending jobs may be writing to the newest Worker.in_flight slots, so only look at the rest.
+ //
+ for(size_t i = 0; HistoryBytes > Budget && i + Worker.in_flight < bcs.size(); i++)
+ {
+  StateMemPacket* smp = &bcs[(bcs_pos + i) % bcs.size()];
+
+  if(smp->data)
+  {
+   std::unique_ptr<MemoryStream> old = SetPacket(smp, nullptr, 0);
+   garbage.emplace_back();
+   garbage.back().packet.data = std::move(old);
+  }
+ }
+
+ // "garbage" is freed here, inside of the lock, but that's rare enough not to matter.
+}
+
 //
 //
 //
 static bool DoRewind(void)
 {
+ //
+ // The most recent compressed state, and ss_prev itself, may still be in use by the worker thread.
+ //
+ WaitAllJobs();
+
  //
  // No save states available.
  //
@@ -139,22 +666,24 @@ static bool DoRewind(void)
  MDFNSS_LoadSM(ss_prev.get(), true);
 
  //
- // If a compressed state exists, decompress it.
+ // If a compressed state exists, decompress it; otherwise, fall back to the newest older keyframe.
  //
- StateMemPacket* smp = &bcs[(bcs_pos + bcs.size() - 1) % bcs.size()];
-
- if(smp->data)
+ if(bcs[(bcs_pos + bcs.size() - 1) % bcs.size()].data)
+  PopDelta();
+ else
  {
-  std::unique_ptr<MemoryStream> tmp(new MemoryStream(smp->uncompressed_len, -1));
-  qlz_decompress((char*)smp->data->map(), tmp->map(), qlz_scratch.decompress);
-  smp->data.reset(nullptr);
-  bcs_pos = (bcs_pos + bcs.size() - 1) % bcs.size();
-  //
-  DoXORFilter(tmp.get(), ss_prev.get());
-  //
-  ss_prev = std::move(tmp);
+  for(auto it = keyframes.rbegin(); it != keyframes.rend(); ++it)
+  {
+   if(it->frame < RecFrame && it->packet.data)
+   {
+    LoadKeyFrame(*it);
+    break;
+   }
+  }
  }
 
+ PruneKeyFrames();
+
  return true;
 }
 
@@ -163,12 +692,20 @@ static bool DoRewind(void)
 //
 static void DoRecord(void)
 {
+ const int64 start_time = Time::MonoUS();
  //
  // Save current state
  //
- std::unique_ptr<MemoryStream> ss_cur(new MemoryStream(SRW_AllocHint));
+ uint32 ss_cur_gen;
+ std::unique_ptr<MemoryStream> ss_cur = TakeSpare(&ss_cur_gen);
 
- MDFNSS_SaveSM(ss_cur.get(), true);
+ if(!ss_cur)
+ {
+  ss_cur.reset(new MemoryStream(SRW_AllocHint));
+  ss_cur_gen = 0;
+ }
+
+ MDFNSS_SaveSMIncremental(ss_cur.get(), &ss_cur_gen);
 
  SRW_AllocHint = std::max<uint32>(SRW_AllocHint, ss_cur->size());
 
@@ -177,19 +714,61 @@ static void DoRecord(void)
  //
  if(ss_prev)
  {
-  DoXORFilter(ss_prev.get(), ss_cur.get());
-
   //printf("Compress: %zu\n", ss_prev->size());
+  CompressJob job;
 
-  bcs[bcs_pos].data = DoCompress(ss_prev.get());
-  bcs[bcs_pos].uncompressed_len = ss_prev->size();
+  job.src = ss_prev.get();
+  job.ref = ss_cur.get();
+  job.retire = std::move(ss_prev);
+  job.retire_gen = ss_prev_gen;
+  job.smp = &bcs[bcs_pos];
+
+  if(Worker.thread)
+   QueueJob(std::move(job));
+  else
+  {
+   DoJob(&job);
+   PutSpare(std::move(job.retire), job.retire_gen);
+  }
   bcs_pos = (bcs_pos + 1) % bcs.size();
+  RecFrame++;
+ }
+
+ //
+ // Compress the current state on its own as a keyframe, if it's time to.
+ //
+ if(KeyInterval && !(RecFrame % KeyInterval) && (!keyframes.size() || keyframes.back().frame != RecFrame))
+ {
+  CompressJob job;
+
+  keyframes.emplace_back();
+  keyframes.back().frame = RecFrame;
+
+  job.src = ss_cur.get();
+  job.smp = &keyframes.back().packet;
+
+  if(Worker.thread)
+   QueueJob(std::move(job));
+  else
+   DoJob(&job);
  }
 
+ TrimHistory();
+
  //
  // Make current state previous for next time.
  //
  ss_prev = std::move(ss_cur);
+ ss_prev_gen = ss_cur_gen;
+
+ //
+ // Update cost counters.
+ //
+ const int64 cost_us = Time::MonoUS() - start_time;
+
+ Cost.peak_us = std::max<int64>(Cost.peak_us, cost_us);
+ Cost.total_us += cost_us;
+ Cost.frames++;
 }
 
 bool MDFNSRW_Frame(bool rewind) noexcept
@@ -231,4 +810,174 @@ bool MDFNI_EnableStateRewind(bool enable)
  return Active;
 }
 
+bool MDFNI_SeekStateRewind(uint64 frames_back)
+{
+ if(!Active)
+  return false;
+
+ if(MDFNnetplay)
+ {
+  MDFN_Notify(MDFN_NOTICE_STATUS, _("Can't rewind during netplay."));
+  return false;
+ }
+
+ try
+ {
+  WaitAllJobs();
+
+  if(!ss_prev)
+   return false;
+
+  const uint64 target = RecFrame - std::min<uint64>(RecFrame, frames_back);
+  const uint64 delta_reach = RecFrame - CountDeltas();
+  const KeyFrame* kf = nullptr;
+
+  //
+  // Use the deltas if they reach back far enough, otherwise the newest keyframe at or before the target; failing both, go
+  // back as far as the history allows.
+  //
+  if(target < delta_reach)
+  {
+   for(auto it = keyframes.rbegin(); it != keyframes.rend(); ++it)
+   {
+    if(it->packet.data && (it->frame <= target || !kf || it->frame < kf->frame))
+    {
+     kf = &*it;
+
+     if(it->frame <= target)
+      break;
+    }
+   }
+
+   if(kf && kf->frame >= delta_reach)
+    kf = nullptr;
+  }
+
+  if(kf)
+  {
+   LoadKeyFrame(*kf);
+   ClearDeltas();
+  }
+  else
+  {
+   while(RecFrame > target && RecFrame > delta_reach)
+    PopDelta();
+  }
+
+  PruneKeyFrames();
+
+  ss_prev->rewind();
+  MDFNSS_LoadSM(ss_prev.get(), true);
+ }
+ catch(std::exception &e)
+ {
+  MDFNSRW_End();
+
+  MDFN_Notify(MDFN_NOTICE_ERROR, _("State rewinding error: %s"), e.what());
+
+  return false;
+ }
+
+ return true;
+}
+
+//
+// Compresses and decompresses "data" in ChunkSize chunks with "bc" repeatedly for a while, and prints the results.
+//
+static void BenchmarkCompressor(const unsigned type, const char* what, const std::vector<uint8>& data)
+{
+ std::unique_ptr<BlockCompressor> bc(BlockCompressor::Create(type));
+ const uint32 num_chunks = (data.size() + ChunkSize - 1) / ChunkSize;
+ std::vector<uint8> cbuf((size_t)num_chunks * bc->MaxCompressedSize(ChunkSize));
+ std::vector<uint32> clens(num_chunks);
+ std::vector<uint8> dbuf(data.size());
+ uint64 csize = 0;
+ int64 ctime = 0, dtime = 0;
+ uint32 iterations = 0;
+
+ do
+ {
+  int64 t = Time::MonoUS();
+
+  csize = 0;
+  for(uint32 i = 0; i < num_chunks; i++)
+  {
+   const uint32 offs = i * ChunkSize;
+
+   clens[i] = bc->Compress(&data[offs], std::min<size_t>(ChunkSize, data.size() - offs), &cbuf[csize]);
+   csize += clens[i];
+  }
+  ctime += Time::MonoUS() - t;
+
+  t = Time::MonoUS();
+  for(uint32 i = 0, coffs = 0; i < num_chunks; coffs += clens[i], i++)
+  {
+   const uint32 offs = i * ChunkSize;
+
+   bc->Decompress(&cbuf[coffs], clens[i], &dbuf[offs], std::min<size_t>(ChunkSize, data.size() - offs));
+  }
+  dtime += Time::MonoUS() - t;
+
+  iterations++;
+ } while((ctime + dtime) < 500000 && iterations < 10000);
+
+ if(dbuf != data)
+  throw MDFN_Error(0, _("%s round trip mismatch."), what);
+
+ MDFN_printf(_("%-8s %-9s %10zu -> %10llu bytes, ratio %6.2f:1, compress %8.1f MB/s, decompress %8.1f MB/s\n"), what,
+	BlockCompressor::GetName(type), data.size(), (unsigned long long)(csize + 4 * num_chunks), (double)data.size() / std::max<uint64>(1, csize + 4 * num_chunks),
+	(double)data.size() * iterations / std::max<int64>(1, ctime), (double)data.size() * iterations / std::max<int64>(1, dtime));
+}
+
+void MDFNI_BenchmarkStateCompression(void)
+{
+ try
+ {
+  std::vector<uint8> full;
+  std::vector<uint8> delta;
+  //
+  {
+   MemoryStream st(SRW_AllocHint ? SRW_AllocHint : 65536);
+
+   MDFNSS_SaveSM(&st, true);
+   full.assign(st.map(), st.map() + st.size());
+  }
+
+  if(Active)
+  {
+   WaitAllJobs();
+
+   if(ss_prev)
+   {
+    delta = full;
+    MDFN_FastMemXOR(&delta[0], ss_prev->map(), std::min<uint64>(delta.size(), ss_prev->size()));
+   }
+  }
+
+  MDFN_printf(_("State compression benchmark:\n"));
+  MDFN_AutoIndent aind(1);
+
+  for(unsigned type = 0; type < BlockCompressor::TYPE__COUNT; type++)
+  {
+   if(!BlockCompressor::IsAvailable(type))
+   {
+    MDFN_printf(_("%s: not available.\n"), BlockCompressor::GetName(type));
+    continue;
+   }
+
+   BenchmarkCompressor(type, _("State"), full);
+
+   if(delta.size())
+    BenchmarkCompressor(type, _("Delta"), delta);
+  }
+
+  if(!delta.size())
+   MDFN_printf(_("Enable state rewinding to also benchmark rewind deltas.\n"));
+ }
+ catch(std::exception& e)
+ {
+  MDFN_Notify(MDFN_NOTICE_ERROR, _("State compression benchmark error: %s"), e.what());
+ }
+}
+
 }
@@ -32,6 +32,10 @@
 #include <mednafen/sound/SwiftResampler.h>
 #include <mednafen/sound/OwlResampler.h>
 #include <mednafen/sound/WAVRecord.h>
+#include <mednafen/cputest/cputest.h>
+#include <mednafen/mempatcher.h>
+#include <mednafen/cdrom/dvdisaster.h>
+#include <mednafen/cdrom/lec.h>
 
 #ifdef WIN32
  #include <mednafen/win32-common.h>
@@ -175,6 +179,92 @@ void MDFNI_RunOwlResamplerTest(void)
  }
 }
 
+//
+// Reports the time taken by OwlResampler::Resample(), per output sample, and OwlBuffer::Integrate(), per input sample,
+// with each of the SIMD kernels the CPU supports, by masking the detected CPU features.
+//
+void MDFNI_RunOwlResamplerBenchmark(void)
+{
+ const int detected_flags = cputest_get_flags();
+ const int avx_flags = CPUTEST_FLAG_AVX | CPUTEST_FLAG_AVX2 | CPUTEST_FLAG_FMA3 | CPUTEST_FLAG_AVX512;
+ static const struct
+ {
+  const char* name;
+  int clear_flags;
+ } variants[] =
+ {
+  { "None", ~0 },
+  { "SSE", CPUTEST_FLAG_AVX | CPUTEST_FLAG_AVX2 | CPUTEST_FLAG_FMA3 | CPUTEST_FLAG_AVX512 },
+  { "AVX", CPUTEST_FLAG_AVX2 | CPUTEST_FLAG_FMA3 | CPUTEST_FLAG_AVX512 },
+  { "FMA/AVX2", CPUTEST_FLAG_AVX512 },
+  { "AVX-512", 0 },
+ };
+ const double irate = 1789772.72727272;
+ const double rate_error = 0.00004;
+ const int32 orate = 48000;
+ const uint32 inlen = 32768;
+ const uint32 iterations = (uint32)(irate * 10 / inlen);
+ std::unique_ptr<float[]> noise(new float[inlen]);
+ std::unique_ptr<int32[]> deltas(new int32[inlen]);
+ std::unique_ptr<int16[]> obuf(new int16[65536 * 2]);
+ std::unique_ptr<OwlBuffer> ibuf(new OwlBuffer());
+ std::unique_ptr<RavenBuffer> mixbuf(new RavenBuffer());
+
+ TestRandInit();
+ for(uint32 i = 0; i < inlen; i++)
+ {
+  noise[i] = (int32)TestRand() >> 9;
+  deltas[i] = (int32)TestRand() >> 20;
+  mixbuf->Buf()[i] = (int32)TestRand() >> 18;
+ }
+
+ for(auto const& v : variants)
+ {
+  if(v.clear_flags != ~0 && (avx_flags & ~v.clear_flags & ~detected_flags))
+   continue;
+
+  cputest_force_flags(detected_flags & ~v.clear_flags);
+
+  for(int quality = 3; quality <= 5; quality += 2)
+  {
+   std::unique_ptr<OwlResampler> res(new OwlResampler(irate, orate, rate_error, 0, quality));
+   uint64 out_count = 0;
+   int64 resample_time = 0;
+
+   res->ResetBufResampState(ibuf.get());
+
+   for(uint32 i = 0; i < iterations; i++)
+   {
+    memcpy(ibuf->Buf(), noise.get(), inlen * sizeof(float));
+
+    const int64 st = Time::MonoUS();
+    out_count += res->Resample(ibuf.get(), inlen, &obuf[0], 65536);
+    resample_time += Time::MonoUS() - st;
+   }
+
+   printf("%-8s Resample, quality %d, %s: %.2f ns/output sample\n", v.name, quality, res->GetSIMDType(), (double)resample_time * 1000 / out_count);
+  }
+
+  for(unsigned mix = 0; mix < 2; mix++)
+  {
+   int64 integrate_time = 0;
+
+   for(uint32 i = 0; i < iterations; i++)
+   {
+    memcpy(ibuf->Buf(), deltas.get(), inlen * sizeof(int32));
+
+    const int64 st = Time::MonoUS();
+    ibuf->Integrate(inlen, 0, 0, mix ? mixbuf.get() : NULL);
+    integrate_time += Time::MonoUS() - st;
+   }
+
+   printf("%-8s Integrate, %u mixed: %.3f ns/input sample\n", v.name, mix, (double)integrate_time * 1000 / ((uint64)iterations * inlen));
+  }
+ }
+
+ cputest_force_flags(detected_flags);
+}
+
 static void TestMTStreamReader(void)
 {
  for(uint32 pzb = 0; pzb < 256; pzb = (pzb * 3) + 1)
@@ -1265,6 +1355,91 @@ static void TestMemoryStream(void)
  printf("MemoryStream test done.\n");
 }
 
+static uint8 IncStateTest_RAM[4096];
+static SFDirtyTracker IncStateTest_RAM_Dirty(sizeof(IncStateTest_RAM));
+
+static void IncStateTest_StateAction(StateMem* sm, const unsigned load, const bool data_only)
+{
+ SFORMAT StateRegs[] =
+ {
+  SFDIRTY(&IncStateTest_RAM_Dirty, SFPTR8(IncStateTest_RAM, sizeof(IncStateTest_RAM))),
+  SFEND
+ };
+
+ MDFNSS_StateAction(sm, load, data_only, StateRegs, "MAIN");
+}
+
+//
+// Cheat writes bypass dirty-page tracking, so those that change memory must force the next incremental save to save
+// everything.  Borrows the demo module's MDFNGI(for its empty cheat info), with the state action replaced.
+//
+static void TestIncrementalStateCheats(void)
+{
+ const MDFNGI* demo_gi = NULL;
+
+ for(auto const* sys : MDFNSystems)
+ {
+  if(!strcmp(sys->shortname, "demo"))
+   demo_gi = sys;
+ }
+
+ if(!demo_gi)
+  return;
+
+ MDFNGI gi(*demo_gi);
+ MDFNGI* const prev_gi = MDFNGameInfo;
+
+ gi.StateAction = IncStateTest_StateAction;
+ MDFNGameInfo = &gi;
+
+ MDFNMP_Init(1024, sizeof(IncStateTest_RAM) / 1024);
+ MDFNMP_AddRAM(sizeof(IncStateTest_RAM), 0, IncStateTest_RAM);
+
+ for(unsigned i = 0; i < sizeof(IncStateTest_RAM); i++)
+  IncStateTest_RAM[i] = i ^ (i >> 8);
+
+ MemoryStream inc;
+ uint32 inc_gen = 0;
+
+ MDFNSS_SaveSMIncremental(&inc, &inc_gen);
+ {
+  MemoryPatch patch;
+
+  patch.addr = 0x923;
+  patch.val = 0x5A;
+  patch.length = 1;
+  patch.type = 'R';
+  patch.status = true;
+
+  MDFNI_AddCheat(patch);
+  MDFNMP_ApplyPeriodicCheats();
+ }
+ assert(IncStateTest_RAM[0x923] == 0x5A);
+ MDFNSS_SaveSMIncremental(&inc, &inc_gen);
+
+ MemoryStream full;
+ uint32 full_gen = 0;
+
+ MDFNSS_SaveSMIncremental(&full, &full_gen);
+ assert(inc.size() == full.size() && !memcmp(inc.map(), full.map(), full.size()));
+
+ //
+ // Rewriting the same value every frame mustn't force full saves; shown by an untracked write to another page not
+ // making it into the next incremental save.
+ //
+ MDFNMP_ApplyPeriodicCheats();
+ IncStateTest_RAM[0x123]++;
+ MDFNSS_SaveSMIncremental(&inc, &inc_gen);
+ MDFNSS_SaveSMIncremental(&full, &(full_gen = 0));
+ assert(inc.size() == full.size() && memcmp(inc.map(), full.map(), full.size()));
+
+ MDFN_FlushGameCheats(true);
+ MDFNMP_Kill();
+ MDFNGameInfo = prev_gi;
+
+ printf("Incremental state cheat test done.\n");
+}
+
 static void TestStreamMisc(void)
 {
  const uint8 td[5] = { 'J', 'E', 'L', 'L', 'O' };
@@ -1284,6 +1459,70 @@ static void TestStreamMisc(void)
  assert(tmp == "SECRETEJELLO");
 }
 
+static void TestLEC(void)
+{
+ //
+ // Slicing-by-8 EDC against a bitwise CRC, at every length and alignment.
+ //
+ {
+  uint8 buf[2352 + 8];
+
+  for(auto& b : buf)
+   b = TestRand();
+
+  for(unsigned offs = 0; offs < 8; offs++)
+  {
+   uint32 crc = 0;
+
+   for(unsigned len = 0; len <= 2352; len++)
+   {
+    assert(EDCCrc32(buf + offs, len) == crc);
+
+    crc ^= buf[offs + len];
+    for(unsigned bit = 0; bit < 8; bit++)
+     crc = (crc >> 1) ^ ((crc & 1) ? 0xD8018001 : 0);
+   }
+  }
+ }
+
+ //
+ // SIMD P/Q parity against the scalar path.
+ //
+ {
+  const bool prev_simd = lec_set_simd(true);
+
+  for(unsigned i = 0; i < 1024; i++)
+  {
+   uint8 sector[2][2352];
+   const uint32 adr = TestRand() % (75 * 60 * 100);
+
+   for(unsigned j = 0; j < 2352; j++)
+    sector[0][j] = (i & 1) ? TestRand() : ((j & 0xF) ? 0x00 : 0xFF);
+
+   memcpy(sector[1], sector[0], 2352);
+
+   for(unsigned mode = 0; mode < 2; mode++)
+   {
+    for(unsigned simd = 0; simd < 2; simd++)
+    {
+     lec_set_simd(simd);
+
+     if(mode)
+      lec_encode_mode2_form1_sector(adr, sector[simd]);
+     else
+      lec_encode_mode1_sector(adr, sector[simd]);
+    }
+
+    assert(!memcmp(sector[0], sector[1], 2352));
+   }
+  }
+
+  lec_set_simd(prev_simd);
+ }
+
+ printf("LEC test done.\n");
+}
+
 void MDFNI_RunExpensiveTests(const char* dirpath)
 {
  TestRandInit();
@@ -1293,6 +1532,8 @@ void MDFNI_RunExpensiveTests(const char* dirpath)
  TestMemoryStream();
  //
  TestStreamMisc();
+ //
+ TestIncrementalStateCheats();
  //TestMTStreamReader();
 
  Testsnhex();
@@ -1314,6 +1555,8 @@ void MDFNI_RunExpensiveTests(const char* dirpath)
 
  TestZLInflate();
 
+ TestLEC();
+
  //
  //ThreadTest();
  //